@@ -0,0 +1,99 @@
+#ifndef AABB_H
+#define AABB_H
+//==============================================================================================
+// Originally written in 2016 by Peter Shirley <ptrshrl@gmail.com>
+//
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+
+template <typename T>
+class basic_aabb {
+  public:
+    using interval = basic_interval<T>;
+
+    interval x, y, z;
+
+    basic_aabb() {} // The default AABB is empty, since intervals are empty by default.
+
+    basic_aabb(const interval& x, const interval& y, const interval& z)
+      : x(x), y(y), z(z) {}
+
+    basic_aabb(const basic_vec3<T>& a, const basic_vec3<T>& b) {
+        // Treat the two points a and b as extrema for the bounding box, so we don't require a
+        // particular minimum/maximum coordinate order.
+
+        x = (a[0] <= b[0]) ? interval(a[0], b[0]) : interval(b[0], a[0]);
+        y = (a[1] <= b[1]) ? interval(a[1], b[1]) : interval(b[1], a[1]);
+        z = (a[2] <= b[2]) ? interval(a[2], b[2]) : interval(b[2], a[2]);
+    }
+
+    basic_aabb(const basic_aabb& box0, const basic_aabb& box1) {
+        x = interval(box0.x, box1.x);
+        y = interval(box0.y, box1.y);
+        z = interval(box0.z, box1.z);
+    }
+
+    const interval& axis_interval(int n) const {
+        if (n == 1) return y;
+        if (n == 2) return z;
+        return x;
+    }
+
+    basic_vec3<T> center() const {
+        return basic_vec3<T>(T(0.5)*(x.min + x.max), T(0.5)*(y.min + y.max), T(0.5)*(z.min + z.max));
+    }
+
+    bool hit(const basic_ray<T>& r, interval ray_t) const {
+        const basic_vec3<T>& ray_orig = r.origin();
+        const basic_vec3<T>& ray_dir  = r.direction();
+
+        for (int axis = 0; axis < 3; axis++) {
+            const interval& ax = axis_interval(axis);
+            const T adinv = T(1) / ray_dir[axis];
+
+            auto t0 = (ax.min - ray_orig[axis]) * adinv;
+            auto t1 = (ax.max - ray_orig[axis]) * adinv;
+
+            if (t0 < t1) {
+                if (t0 > ray_t.min) ray_t.min = t0;
+                if (t1 < ray_t.max) ray_t.max = t1;
+            } else {
+                if (t1 > ray_t.min) ray_t.min = t1;
+                if (t0 < ray_t.max) ray_t.max = t0;
+            }
+
+            if (ray_t.max <= ray_t.min)
+                return false;
+        }
+        return true;
+    }
+
+    int longest_axis() const {
+        // Returns the index of the longest axis of the bounding box.
+
+        if (x.size() > y.size())
+            return x.size() > z.size() ? 0 : 2;
+        else
+            return y.size() > z.size() ? 1 : 2;
+    }
+
+    static const basic_aabb empty, universe;
+};
+
+template <typename T>
+const basic_aabb<T> basic_aabb<T>::empty
+    = basic_aabb<T>(basic_interval<T>::empty, basic_interval<T>::empty, basic_interval<T>::empty);
+template <typename T>
+const basic_aabb<T> basic_aabb<T>::universe
+    = basic_aabb<T>(basic_interval<T>::universe, basic_interval<T>::universe, basic_interval<T>::universe);
+
+using aabb = basic_aabb<double>;
+
+
+#endif
@@ -0,0 +1,146 @@
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+// The million-sphere scene built with one heap allocation per sphere, material and BVH node,
+// against the same scene packed into an arena. Every allocation goes through the counting
+// operator new below. Reports build time, allocations and heap in use, trace throughput for
+// two frames (the second reuses the frame arena), and teardown time. Both builds draw the
+// same random numbers, so their images must match.
+//
+//   make allocations && ./allocations [count] [width] [spp]
+
+#include "rtweekend.h"
+
+#include "arena.h"
+#include "scenes.h"
+
+#include <chrono>
+#include <cstdio>
+#include <malloc.h>
+#include <new>
+#include <numeric>
+#include <vector>
+
+
+// Allocation hook: counts calls into the global operator new. operator new[] forwards here.
+static size_t allocation_count = 0;
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void* operator new(size_t size) {
+    allocation_count++;
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+#pragma GCC diagnostic pop
+
+
+static size_t heap_in_use() {
+    // Bytes malloc has handed out, including its per-allocation overhead and mmapped blocks.
+    auto info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+}
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+struct run_result {
+    std::vector<color> image;
+    double build_seconds, teardown_seconds;
+    size_t build_allocations, build_bytes, arena_bytes;
+    double frame_seconds[2];
+    size_t frame_allocations[2];
+    long long rays;
+};
+
+
+run_result run(bool use_arena, int count, int width, int spp) {
+    run_result result;
+    auto heap_before = heap_in_use();
+    auto allocations_before = allocation_count;
+    auto start = std::chrono::steady_clock::now();
+
+    std::unique_ptr<arena> memory;
+    if (use_arena)
+        memory = std::make_unique<arena>(size_t(16) << 20);
+    auto world = std::make_unique<hittable_list>();
+    light_bvh lights;
+    camera cam;
+    seed_random(1);
+    many_spheres(*world, lights, cam, memory.get(), count);
+
+    result.build_seconds = seconds_since(start);
+    result.build_allocations = allocation_count - allocations_before;
+    result.build_bytes = heap_in_use() - heap_before;
+    result.arena_bytes = memory ? memory->bytes_used() : 0;
+
+    cam.image_width = width;
+    cam.samples_per_pixel = spp;
+    for (int frame = 0; frame < 2; frame++) {
+        seed_random(2);
+        allocations_before = allocation_count;
+        start = std::chrono::steady_clock::now();
+        result.image = cam.render_image(*world, lights);
+        result.frame_seconds[frame] = seconds_since(start);
+        result.frame_allocations[frame] = allocation_count - allocations_before;
+    }
+    auto& rays = cam.ray_counts();
+    result.rays = std::accumulate(rays.begin(), rays.end(), 0LL);
+
+    start = std::chrono::steady_clock::now();
+    world.reset();
+    memory.reset();
+    result.teardown_seconds = seconds_since(start);
+    return result;
+}
+
+
+int main(int argc, char** argv) {
+    int count = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    int width = (argc > 2) ? std::atoi(argv[2]) : 320;
+    int spp   = (argc > 3) ? std::atoi(argv[3]) : 2;
+
+    // Silence the scanline progress of render_image
+    auto clogbuf = std::clog.rdbuf(nullptr);
+    auto heap = run(false, count, width, spp);
+    auto packed = run(true, count, width, spp);
+    std::clog.clear();
+    std::clog.rdbuf(clogbuf);
+
+    std::printf("%d spheres, %dx%d at %d spp, %lld rays per frame\n\n",
+                count, width, int(width / (4.0 / 3.0)), spp, heap.rays);
+    std::printf("                   %12s %12s\n", "heap", "arena");
+    std::printf("build              %10.3f s %10.3f s\n", heap.build_seconds, packed.build_seconds);
+    std::printf("  allocations      %12zu %12zu\n", heap.build_allocations, packed.build_allocations);
+    std::printf("  heap in use      %9.1f MB %9.1f MB\n", heap.build_bytes / 1e6, packed.build_bytes / 1e6);
+    std::printf("  of it in arena   %12s %9.1f MB\n", "", packed.arena_bytes / 1e6);
+    for (int frame = 0; frame < 2; frame++) {
+        std::printf("frame %d            %10.3f s %10.3f s\n", frame + 1,
+                    heap.frame_seconds[frame], packed.frame_seconds[frame]);
+        std::printf("  Mrays/s          %12.2f %12.2f\n", heap.rays / heap.frame_seconds[frame] / 1e6,
+                    packed.rays / packed.frame_seconds[frame] / 1e6);
+        std::printf("  allocations      %12zu %12zu\n",
+                    heap.frame_allocations[frame], packed.frame_allocations[frame]);
+    }
+    std::printf("teardown           %10.3f s %10.3f s\n", heap.teardown_seconds, packed.teardown_seconds);
+
+    bool same = heap.image.size() == packed.image.size();
+    for (size_t i = 0; same && i < heap.image.size(); i++)
+        for (int c = 0; c < 3; c++)
+            same = same && heap.image[i][c] == packed.image[i][c];
+    std::printf("\nimages %s\n", same ? "identical" : "DIFFER");
+    return same ? 0 : 1;
+}
@@ -0,0 +1,200 @@
+#ifndef ARENA_H
+#define ARENA_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+
+// Bump allocator: memory is handed out from large blocks in order, and only given back all at
+// once, by rewinding to an earlier mark or destroying the arena. Objects made with create()
+// have their destructors run then, newest first. Blocks are kept when rewinding, so an arena
+// that is filled and rewound every frame stops allocating after the first one.
+class arena {
+  private:
+    struct destructor {
+        // Stored in the arena just before the object it destroys.
+        destructor* next;
+        void (*destroy)(void*);
+        void* object;
+    };
+
+    struct block {
+        char* data;
+        size_t size;
+    };
+
+  public:
+    struct marker {
+        size_t block = 0;
+        size_t offset = 0;
+        size_t used = 0;
+        destructor* destructors = nullptr;
+    };
+
+    explicit arena(size_t block_size = size_t(1) << 20) : block_size(block_size) {}
+
+    ~arena() {
+        reset();
+        for (auto& b : blocks)
+            ::operator delete(b.data);
+    }
+
+    arena(const arena&) = delete;
+    arena& operator=(const arena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t)) {
+        // Moves on to the next block that has room, keeping the space left in the current one
+        // unused; a request larger than the block size gets a block of its own.
+        while (current < blocks.size()) {
+            auto& b = blocks[current];
+            auto start = (reinterpret_cast<uintptr_t>(b.data) + offset + alignment - 1) & ~(alignment - 1);
+            auto end = start - reinterpret_cast<uintptr_t>(b.data) + size;
+            if (end <= b.size) {
+                offset = end;
+                used += size;
+                return reinterpret_cast<void*>(start);
+            }
+            current++;
+            offset = 0;
+        }
+
+        auto size_needed = std::max(block_size, size + alignment);
+        blocks.push_back(block{ static_cast<char*>(::operator new(size_needed)), size_needed });
+        current = blocks.size() - 1;
+        offset = 0;
+        return allocate(size, alignment);
+    }
+
+    template <typename T, typename... Args>
+    T* create(Args&&... args) {
+        destructor* record = nullptr;
+        if (!std::is_trivially_destructible<T>::value)
+            record = static_cast<destructor*>(allocate(sizeof(destructor), alignof(destructor)));
+
+        T* object = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (record) {
+            *record = destructor{ destructors, [](void* p) { static_cast<T*>(p)->~T(); }, object };
+            destructors = record;
+        }
+        return object;
+    }
+
+    template <typename T, typename... Args>
+    std::shared_ptr<T> make_shared(Args&&... args) {
+        // A shared_ptr that does not own the object: it has no control block, so making and
+        // copying it costs no allocation or reference counting. The arena must outlive it.
+        return std::shared_ptr<T>(std::shared_ptr<T>(), create<T>(std::forward<Args>(args)...));
+    }
+
+    marker mark() const { return marker{ current, offset, used, destructors }; }
+
+    void rewind(const marker& m) {
+        // Destroys everything created since m and makes its memory available again.
+        while (destructors != m.destructors) {
+            destructors->destroy(destructors->object);
+            destructors = destructors->next;
+        }
+        current = m.block;
+        offset = m.offset;
+        used = m.used;
+    }
+
+    void reset() { rewind(marker()); }
+
+    size_t bytes_used() const { return used; }
+
+    size_t bytes_reserved() const {
+        size_t total = 0;
+        for (const auto& b : blocks)
+            total += b.size;
+        return total;
+    }
+
+  private:
+    size_t block_size;
+    std::vector<block> blocks;
+    size_t current = 0;     // Block being filled
+    size_t offset = 0;      // Bytes of it handed out
+    size_t used = 0;        // Bytes asked for since the arena was last empty
+    destructor* destructors = nullptr;
+};
+
+
+template <typename T, typename... Args>
+std::shared_ptr<T> make_shared_in(arena* a, Args&&... args) {
+    // Places the object in a when there is one, on the heap with its own count otherwise.
+    if (a)
+        return a->make_shared<T>(std::forward<Args>(args)...);
+    return std::make_shared<T>(std::forward<Args>(args)...);
+}
+
+
+// Standard allocator over an arena, for containers whose lifetime ends before the arena is
+// rewound. Deallocation does nothing; the memory comes back with the rewind.
+template <typename T>
+class arena_allocator {
+  public:
+    using value_type = T;
+
+    arena_allocator(arena& a) : a(&a) {}
+
+    template <typename U>
+    arena_allocator(const arena_allocator<U>& other) : a(other.a) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(a->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const arena_allocator<U>& other) const { return a == other.a; }
+    template <typename U>
+    bool operator!=(const arena_allocator<U>& other) const { return a != other.a; }
+
+  private:
+    template <typename U> friend class arena_allocator;
+    arena* a;
+};
+
+template <typename T>
+using arena_vector = std::vector<T, arena_allocator<T>>;
+
+
+inline arena& frame_arena() {
+    // Scratch memory of the calling thread for the frame being rendered.
+    thread_local arena scratch(size_t(4) << 20);
+    return scratch;
+}
+
+class frame_scope {
+  // Gives back everything taken from the thread's frame arena while it is alive. Containers
+  // using the arena must be declared after it, so they are gone before it rewinds.
+  public:
+    frame_scope() : scratch(frame_arena()), start(scratch.mark()) {}
+    ~frame_scope() { scratch.rewind(start); }
+
+    frame_scope(const frame_scope&) = delete;
+    frame_scope& operator=(const frame_scope&) = delete;
+
+    template <typename T>
+    arena_allocator<T> allocator() const { return arena_allocator<T>(scratch); }
+
+  private:
+    arena& scratch;
+    arena::marker start;
+};
+
+
+#endif
@@ -0,0 +1,104 @@
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+// The dynamic integrator (runtime depth limit, virtual material calls) against one specialised
+// at compile time for the scene's depth limit and materials. Checks that both produce the same
+// image from the same random sequence, and reports render time and cycles per ray at each
+// bounce depth.
+//
+//   make bounces && ./bounces [scene] [spp]
+
+#include "rtweekend.h"
+
+#include "scenes.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+
+struct run_result {
+    std::vector<color> image;
+    double seconds;
+    std::vector<long long> rays;
+    std::vector<unsigned long long> cycles;
+};
+
+
+template <int MaxDepth, typename... Materials>
+run_result run(camera& cam, const hittable& world, const light_bvh& lights) {
+    run_result result;
+    seed_random(1);
+    auto start = std::chrono::steady_clock::now();
+    result.image = cam.render_image<MaxDepth, Materials...>(world, lights);
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    result.seconds = elapsed.count();
+    result.rays = cam.ray_counts();
+    result.cycles = cam.cycle_counts();
+    return result;
+}
+
+
+int main(int argc, char** argv) {
+    int scene = (argc > 1) ? std::atoi(argv[1]) : 1;
+    int spp   = (argc > 2) ? std::atoi(argv[2]) : 8;
+
+    hittable_list world;
+    light_bvh lights;
+    camera cam;
+    switch (scene) {
+        case 2:  many_lights(world, lights, cam);   break;
+        default: three_spheres(world, lights, cam); break;
+    }
+    cam.samples_per_pixel = spp;
+
+    // The specialisation below hard-codes the depth limit set by setup_camera().
+    const int depth = 50;
+    if (cam.max_depth != depth) {
+        std::fprintf(stderr, "scene max_depth %d does not match the specialised %d\n",
+                     cam.max_depth, depth);
+        return 1;
+    }
+
+    // Untimed warm-up, then time both without profiling overhead.
+    run<0>(cam, world, lights);
+    auto dynamic = run<0>(cam, world, lights);
+    auto special = run<depth, lambertian, diffuse_light>(cam, world, lights);
+
+    if (dynamic.image.size() != special.image.size()) {
+        std::fprintf(stderr, "image sizes differ\n");
+        return 1;
+    }
+    size_t differing = 0;
+    for (size_t i = 0; i < dynamic.image.size(); i++) {
+        auto d = dynamic.image[i] - special.image[i];
+        if (!(d.near_zero()))
+            differing++;
+    }
+
+    std::printf("dynamic:     %.3f s\n", dynamic.seconds);
+    std::printf("specialised: %.3f s (%.2fx)\n", special.seconds, dynamic.seconds / special.seconds);
+    std::printf("pixels that differ: %zu of %zu\n\n", differing, dynamic.image.size());
+
+    // Second pass with per-bounce cycle counters on.
+    cam.profile_bounces = true;
+    dynamic = run<0>(cam, world, lights);
+    special = run<depth, lambertian, diffuse_light>(cam, world, lights);
+
+    std::printf("depth  rays      cycles/ray (dynamic)  cycles/ray (specialised)\n");
+    for (size_t d = 0; d < dynamic.rays.size(); d++) {
+        if (!dynamic.rays[d])
+            continue;
+        std::printf("%5zu  %8lld  %20.0f  %24.0f\n", d, dynamic.rays[d],
+                    double(dynamic.cycles[d]) / dynamic.rays[d],
+                    double(special.cycles[d]) / special.rays[d]);
+    }
+
+    return differing == 0 ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+#ifndef BVH_H
+#define BVH_H
+//==============================================================================================
+// Originally written in 2016 by Peter Shirley <ptrshrl@gmail.com>
+//
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "aabb.h"
+#include "arena.h"
+#include "hittable.h"
+#include "hittable_list.h"
+
+#include <algorithm>
+
+
+template <typename P>
+class basic_bvh_node : public basic_hittable<P> {
+  public:
+    using real = typename P::real;
+    using ray = basic_ray<real>;
+    using interval = basic_interval<real>;
+    using aabb = basic_aabb<real>;
+    using hit_record = basic_hit_record<P>;
+    using object_ptr = shared_ptr<basic_hittable<P>>;
+
+    basic_bvh_node(basic_hittable_list<P> list, arena* nodes = nullptr)
+      : basic_bvh_node(list.objects, 0, list.objects.size(), nodes)
+    {
+        // There's a C++ subtlety here. This constructor (without span indices) creates an
+        // implicit copy of the hittable list, which we will modify. The lifetime of the copied
+        // list only extends until this constructor exits. That's OK, because we only need to
+        // persist the resulting bounding volume hierarchy.
+        //
+        // Interior nodes are placed in the nodes arena if one is given, which must then outlive
+        // the tree.
+    }
+
+    basic_bvh_node(std::vector<object_ptr>& objects, size_t start, size_t end,
+                   arena* nodes = nullptr) {
+        // Build the bounding box of the span of source objects.
+        bbox = aabb::empty;
+        for (size_t object_index=start; object_index < end; object_index++)
+            bbox = aabb(bbox, objects[object_index]->bounding_box());
+
+        int axis = bbox.longest_axis();
+
+        auto comparator = (axis == 0) ? box_x_compare
+                        : (axis == 1) ? box_y_compare
+                                      : box_z_compare;
+
+        size_t object_span = end - start;
+
+        if (object_span == 1) {
+            left = right = objects[start];
+        } else if (object_span == 2) {
+            left = objects[start];
+            right = objects[start+1];
+        } else {
+            std::sort(std::begin(objects) + start, std::begin(objects) + end, comparator);
+
+            auto mid = start + object_span/2;
+            left = make_shared_in<basic_bvh_node>(nodes, objects, start, mid, nodes);
+            right = make_shared_in<basic_bvh_node>(nodes, objects, mid, end, nodes);
+        }
+    }
+
+    bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
+        if (!bbox.hit(r, ray_t))
+            return false;
+
+        bool hit_left = left->hit(r, ray_t, rec);
+        bool hit_right = right->hit(r, interval(ray_t.min, hit_left ? rec.t : ray_t.max), rec);
+
+        return hit_left || hit_right;
+    }
+
+    bool occluded(const ray& r, interval ray_t) const override {
+        if (!bbox.hit(r, ray_t))
+            return false;
+
+        return left->occluded(r, ray_t) || right->occluded(r, ray_t);
+    }
+
+    void hit_group(const ray* rays, const int* active, int count, real t_min,
+                   real* t_max, hit_record* recs) const override {
+        // The node is fetched once for the group, and the rays whose interval still meets its
+        // box go on to both children together. As in hit(), hits in the left child shorten
+        // the interval searched in the right one.
+        int inside[basic_hittable<P>::max_group];
+        int inside_count = 0;
+        for (int k = 0; k < count; k++) {
+            int i = active[k];
+            if (bbox.hit(rays[i], interval(t_min, t_max[i])))
+                inside[inside_count++] = i;
+        }
+        if (inside_count == 0)
+            return;
+
+        left->hit_group(rays, inside, inside_count, t_min, t_max, recs);
+        right->hit_group(rays, inside, inside_count, t_min, t_max, recs);
+    }
+
+    aabb bounding_box() const override { return bbox; }
+
+  private:
+    object_ptr left;
+    object_ptr right;
+    aabb bbox;
+
+    static bool box_compare(const object_ptr a, const object_ptr b, int axis_index) {
+        auto a_axis_interval = a->bounding_box().axis_interval(axis_index);
+        auto b_axis_interval = b->bounding_box().axis_interval(axis_index);
+        return a_axis_interval.min < b_axis_interval.min;
+    }
+
+    static bool box_x_compare (const object_ptr a, const object_ptr b) {
+        return box_compare(a, b, 0);
+    }
+
+    static bool box_y_compare (const object_ptr a, const object_ptr b) {
+        return box_compare(a, b, 1);
+    }
+
+    static bool box_z_compare (const object_ptr a, const object_ptr b) {
+        return box_compare(a, b, 2);
+    }
+};
+
+using bvh_node = basic_bvh_node<double_precision>;
+
+
+#endif
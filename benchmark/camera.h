@@ -11,16 +11,39 @@
 // along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
 //==============================================================================================
 
+#include "arena.h"
+#include "checkpoint.h"
+#include "feature_buffers.h"
 #include "hittable.h"
+#include "light_bvh.h"
 #include "material.h"
 
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
 
-class camera {
+
+template <typename P>
+class basic_camera {
   public:
+    // Settings are in double whatever the precision; rays, hits and shading use P::real.
+    using real = typename P::real;
+    using vec = basic_vec3<real>;
+    using color = basic_vec3<real>;
+    using ray = basic_ray<real>;
+    using interval = basic_interval<real>;
+    using hittable = basic_hittable<P>;
+    using hit_record = basic_hit_record<P>;
+    using material = basic_material<P>;
+    using light_bvh = basic_light_bvh<P>;
+
     double aspect_ratio      = 1.0;  // Ratio of image width over height
     int    image_width       = 100;  // Rendered image width in pixel count
     int    samples_per_pixel = 10;   // Count of random samples for each pixel
     int    max_depth         = 10;   // Maximum number of ray bounces into scene
+    bool   russian_roulette  = true; // Randomly end low-throughput paths (unbiased)
+    int    roulette_depth    = 3;    // Bounces before Russian roulette starts
 
     double vfov     = 90;              // Vertical view angle (field of view)
     point3 lookfrom = point3(0,0,0);   // Point camera is looking from
@@ -30,36 +53,157 @@ class camera {
     double defocus_angle = 0;  // Variation angle of rays through each pixel
     double focus_dist = 10;    // Distance from camera lookfrom point to plane of perfect focus
 
+    bool   sky_background = true;  // Sky gradient behind the scene, otherwise black
+    bool   sample_lights  = true;  // Next-event estimation toward the lights passed to render()
+    bool   profile_bounces = false; // Count cycles spent at each bounce depth
+    bool   write_features  = false; // Record first-hit albedo, normal and depth, see features()
+
+    shared_ptr<sampler> pixel_sampler;  // Source of sample values, independent random if unset
+
+    std::string checkpoint_path;       // Save progress here while rendering, if set
+    double checkpoint_interval = 60;   // Seconds between checkpoints
+    bool   resume = false;             // Continue from checkpoint_path when it matches this render
+
     void render(const hittable& world) {
-        initialize();
+        render(world, light_bvh());
+    }
+
+    void render(const hittable& world, const light_bvh& lights) {
+        auto image = render_image(world, lights);
 
         std::cout << "P3\n" << image_width << ' ' << image_height << "\n255\n";
+        for (const auto& pixel_color : image)
+            write_color(std::cout, pixel_color);
+    }
 
-        for (int j = 0; j < image_height; j++) {
+    template <int MaxDepth = 0, typename... Materials>
+    std::vector<::color> render_image(const hittable& world, const light_bvh& lights) {
+        // Renders into a row-major buffer of linear pixel colors, in double for any precision.
+        //
+        // The integrator can be specialised at compile time: a nonzero MaxDepth replaces
+        // max_depth as the bounce limit, and materials listed in Materials are shaded without
+        // virtual calls (see visit_material). The defaults give the fully dynamic integrator.
+        initialize();
+        this->lights = &lights;
+        auto depth_limit = (MaxDepth > 0) ? MaxDepth : max_depth;
+        rays_per_depth.assign(depth_limit, 0);
+        cycles_per_depth.assign(depth_limit, 0);
+        if (write_features)
+            feature_image.resize(image_width, image_height);
+
+        independent_sampler default_sampler;
+        sampler& s = pixel_sampler ? *pixel_sampler : default_sampler;
+        s.init(samples_per_pixel);
+
+        // Samples are summed per pixel into a float buffer, which is also what a checkpoint
+        // stores, so a resumed render finishes with exactly the image it would have produced.
+        // Both buffers live in the thread's frame arena, which keeps its blocks from one frame
+        // to the next.
+        frame_scope scratch;
+        auto pixel_count = size_t(image_width) * image_height;
+        arena_vector<float> accumulation(3 * pixel_count, 0.0f, scratch.allocator<float>());
+        arena_vector<uint32_t> sample_counts(pixel_count, 0, scratch.allocator<uint32_t>());
+        int first_row = resume_from_checkpoint(depth_limit, accumulation, sample_counts);
+
+        std::unique_ptr<checkpoint_writer> writer;
+        if (!checkpoint_path.empty())
+            writer = std::make_unique<checkpoint_writer>(checkpoint_path);
+        auto last_checkpoint = std::chrono::steady_clock::now();
+
+        for (int j = first_row; j < image_height; j++) {
             std::clog << "\rScanlines remaining: " << (image_height - j) << ' ' << std::flush;
             for (int i = 0; i < image_width; i++) {
                 color pixel_color(0,0,0);
+                feature_sample first_hit{}, feature_sum{};
                 for (int sample = 0; sample < samples_per_pixel; sample++) {
-                    ray r = get_ray(i, j);
-                    pixel_color += ray_color(r, max_depth, world);
+                    s.start_pixel_sample(i, j, sample);
+                    ray r = get_ray(i, j, s);
+                    if (write_features) {
+                        pixel_color += ray_color<MaxDepth, Materials...>(r, world, s, &first_hit);
+                        feature_sum.albedo += first_hit.albedo;
+                        feature_sum.normal += first_hit.normal;
+                        feature_sum.depth += first_hit.depth;
+                    } else {
+                        pixel_color += ray_color<MaxDepth, Materials...>(r, world, s);
+                    }
+                }
+                auto p = size_t(j) * image_width + i;
+                if (write_features) {
+                    feature_sum.albedo /= samples_per_pixel;
+                    feature_sum.normal /= samples_per_pixel;
+                    feature_sum.depth /= samples_per_pixel;
+                    feature_image.set(p, feature_sum);
                 }
-                write_color(std::cout, pixel_samples_scale * pixel_color);
+                accumulation[3*p + 0] = float(pixel_color.x());
+                accumulation[3*p + 1] = float(pixel_color.y());
+                accumulation[3*p + 2] = float(pixel_color.z());
+                sample_counts[p] = uint32_t(samples_per_pixel);
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (writer && std::chrono::duration<double>(now - last_checkpoint).count() >= checkpoint_interval) {
+                writer->submit(make_checkpoint(j + 1, depth_limit, accumulation, sample_counts));
+                last_checkpoint = now;
             }
         }
 
+        // Wait for any checkpoint still being written; a finished render no longer needs it.
+        if (writer) {
+            writer.reset();
+            std::remove(checkpoint_path.c_str());
+        }
+
+        std::vector<::color> image(pixel_count);
+        for (size_t p = 0; p < pixel_count; p++) {
+            auto scale = sample_counts[p] > 0 ? 1.0 / sample_counts[p] : 0.0;
+            image[p] = scale * ::color(accumulation[3*p], accumulation[3*p + 1], accumulation[3*p + 2]);
+        }
+
         std::clog << "\rDone.                 \n";
+        this->lights = nullptr;
+        return image;
+    }
+
+    const std::vector<long long>& ray_counts() const {
+        // Number of rays traced at each bounce depth during the last render.
+        return rays_per_depth;
+    }
+
+    const std::vector<unsigned long long>& cycle_counts() const {
+        // Cycles spent at each bounce depth during the last render, if profile_bounces is set.
+        return cycles_per_depth;
+    }
+
+    const feature_buffers& features() const {
+        // First-hit features of the last render, averaged over each pixel's samples, if
+        // write_features is set. Rows restored from a checkpoint have none.
+        return feature_image;
     }
 
   private:
     int    image_height;         // Rendered image height
     double pixel_samples_scale;  // Color scale factor for a sum of pixel samples
-    point3 center;               // Camera center
-    point3 pixel00_loc;          // Location of pixel 0, 0
-    vec3   pixel_delta_u;        // Offset to pixel to the right
-    vec3   pixel_delta_v;        // Offset to pixel below
+    vec    center;               // Camera center
+    vec    pixel00_loc;          // Location of pixel 0, 0
+    vec    pixel_delta_u;        // Offset to pixel to the right
+    vec    pixel_delta_v;        // Offset to pixel below
+    vec    defocus_disk_u;       // Defocus disk horizontal radius
+    vec    defocus_disk_v;       // Defocus disk vertical radius
     vec3   u, v, w;              // Camera frame basis vectors
-    vec3   defocus_disk_u;       // Defocus disk horizontal radius
-    vec3   defocus_disk_v;       // Defocus disk vertical radius
+    const light_bvh* lights = nullptr;  // Lights for next-event estimation during render
+    mutable std::vector<long long> rays_per_depth;  // Rays traced at each depth, for reporting
+    mutable std::vector<unsigned long long> cycles_per_depth;  // Cycles at each depth, if profiling
+    feature_buffers feature_image;  // First-hit features, if write_features
+
+    // Sample dimensions: the pixel and lens offsets come first, then every bounce owns a fixed
+    // block so that each decision at each depth always reads the same dimensions.
+    static const int pixel_dimension    = 0;  // 2D pixel offset
+    static const int lens_dimension     = 2;  // 2D defocus disk offset
+    static const int bounce_dimension   = 4;  // Start of the first bounce's block
+    static const int dimensions_per_bounce = 7;
+    static const int scatter_offset     = 0;  // Up to 3 numbers for material scattering
+    static const int light_pick_offset  = 3;  // 1D light choice, then 2D direction toward it
+    static const int roulette_offset    = 6;  // 1D Russian roulette decision
 
     void initialize() {
         image_height = int(image_width / aspect_ratio);
@@ -67,7 +211,7 @@ class camera {
 
         pixel_samples_scale = 1.0 / samples_per_pixel;
 
-        center = lookfrom;
+        center = vec(lookfrom);
 
         // Determine viewport dimensions.
         auto theta = degrees_to_radians(vfov);
@@ -85,66 +229,236 @@ class camera {
         vec3 viewport_v = viewport_height * -v;  // Vector down viewport vertical edge
 
         // Calculate the horizontal and vertical delta vectors from pixel to pixel.
-        pixel_delta_u = viewport_u / image_width;
-        pixel_delta_v = viewport_v / image_height;
+        vec3 delta_u = viewport_u / image_width;
+        vec3 delta_v = viewport_v / image_height;
+        pixel_delta_u = vec(delta_u);
+        pixel_delta_v = vec(delta_v);
 
         // Calculate the location of the upper left pixel.
-        auto viewport_upper_left = center - (focus_dist * w) - viewport_u/2 - viewport_v/2;
-        pixel00_loc = viewport_upper_left + 0.5 * (pixel_delta_u + pixel_delta_v);
+        auto viewport_upper_left = lookfrom - (focus_dist * w) - viewport_u/2 - viewport_v/2;
+        pixel00_loc = vec(viewport_upper_left + 0.5 * (delta_u + delta_v));
 
         // Calculate the camera defocus disk basis vectors.
         auto defocus_radius = focus_dist * std::tan(degrees_to_radians(defocus_angle / 2));
-        defocus_disk_u = u * defocus_radius;
-        defocus_disk_v = v * defocus_radius;
+        defocus_disk_u = vec(u * defocus_radius);
+        defocus_disk_v = vec(v * defocus_radius);
     }
 
-    ray get_ray(int i, int j) const {
+    int resume_from_checkpoint(int depth_limit, arena_vector<float>& accumulation,
+                               arena_vector<uint32_t>& sample_counts) const {
+        // Restores the finished scanlines and the random state from checkpoint_path when resume
+        // is set and the checkpoint belongs to this render. Returns the scanline to start at.
+        if (!resume || checkpoint_path.empty())
+            return 0;
+
+        render_checkpoint checkpoint;
+        if (!checkpoint.load(checkpoint_path)) {
+            std::clog << "No checkpoint at " << checkpoint_path << ", starting from scratch\n";
+            return 0;
+        }
+        if (!checkpoint.matches(image_width, image_height, samples_per_pixel, depth_limit)) {
+            std::clog << "Checkpoint " << checkpoint_path << " is from a different render, ignoring it\n";
+            return 0;
+        }
+
+        std::copy(checkpoint.accumulation.begin(), checkpoint.accumulation.end(), accumulation.begin());
+        std::copy(checkpoint.sample_counts.begin(), checkpoint.sample_counts.end(), sample_counts.begin());
+        random_state() = checkpoint.random_state;
+        std::clog << "Resuming at scanline " << checkpoint.next_row << " of " << image_height << '\n';
+        return checkpoint.next_row;
+    }
+
+    render_checkpoint make_checkpoint(int next_row, int depth_limit, const arena_vector<float>& accumulation,
+                                      const arena_vector<uint32_t>& sample_counts) const {
+        // Copies the finished scanlines; the render carries on while the copy is written out.
+        render_checkpoint checkpoint;
+        checkpoint.image_width = image_width;
+        checkpoint.image_height = image_height;
+        checkpoint.samples_per_pixel = samples_per_pixel;
+        checkpoint.max_depth = depth_limit;
+        checkpoint.next_row = next_row;
+        checkpoint.random_state = random_state();
+        auto pixels = size_t(next_row) * image_width;
+        checkpoint.accumulation.assign(accumulation.begin(), accumulation.begin() + 3*pixels);
+        checkpoint.sample_counts.assign(sample_counts.begin(), sample_counts.begin() + pixels);
+        return checkpoint;
+    }
+
+    ray get_ray(int i, int j, sampler& s) const {
         // Construct a camera ray originating from the defocus disk and directed at a randomly
         // sampled point around the pixel location i, j.
 
-        auto offset = sample_square();
+        s.set_dimension(pixel_dimension);
+        auto offset = sample_square(s);
         auto pixel_sample = pixel00_loc
                           + ((i + offset.x()) * pixel_delta_u)
                           + ((j + offset.y()) * pixel_delta_v);
 
-        auto ray_origin = (defocus_angle <= 0) ? center : defocus_disk_sample();
+        s.set_dimension(lens_dimension);
+        auto ray_origin = (defocus_angle <= 0) ? center : defocus_disk_sample(s);
         auto ray_direction = pixel_sample - ray_origin;
 
         return ray(ray_origin, ray_direction);
     }
 
-    vec3 sample_square() const {
+    vec3 sample_square(sampler& s) const {
         // Returns the vector to a random point in the [-.5,-.5]-[+.5,+.5] unit square.
-        return vec3(random_double() - 0.5, random_double() - 0.5, 0);
-    }
-
-    vec3 sample_disk(double radius) const {
-        // Returns a random point in the unit (radius 0.5) disk centered at the origin.
-        return radius * random_in_unit_disk();
+        auto u = s.get_2d();
+        return vec3(u.x() - 0.5, u.y() - 0.5, 0);
     }
 
-    point3 defocus_disk_sample() const {
+    vec defocus_disk_sample(sampler& s) const {
         // Returns a random point in the camera defocus disk.
-        auto p = random_in_unit_disk();
+        auto p = square_to_unit_disk(s.get_2d());
         return center + (p[0] * defocus_disk_u) + (p[1] * defocus_disk_v);
     }
 
-    color ray_color(const ray& r, int depth, const hittable& world) const {
+    template <int MaxDepth, typename... Materials>
+    MULTIVERSION color ray_color(const ray& camera_ray, const hittable& world, sampler& s,
+                                 feature_sample* first_hit = nullptr) const {
+        // Follows one path iteratively, carrying the product of attenuations along it in
+        // throughput instead of multiplying it in on the way back out of a recursion. One hit
+        // record is reused for every bounce. If first_hit is given, it receives what the
+        // camera ray found.
+        color radiance(0,0,0);
+        color throughput(1,1,1);
+        ray r = camera_ray;
+        hit_record rec;
+        const int depth_limit = (MaxDepth > 0) ? MaxDepth : max_depth;
+        unsigned long long bounce_start = profile_bounces ? cycle_count() : 0;
+
+        // Density with which the previous bounce sampled r, or zero if that bounce did not
+        // also sample the lights (camera rays, specular bounces). It weights emission found by
+        // r against next-event estimation at the previous vertex.
+        double bsdf_pdf = 0;
+
         // If we've exceeded the ray bounce limit, no more light is gathered.
-        if (depth <= 0)
-            return color(0,0,0);
+        int depth = 0;
+        for (; depth < depth_limit; depth++) {
+            if (profile_bounces && depth > 0) {
+                auto now = cycle_count();
+                cycles_per_depth[depth-1] += now - bounce_start;
+                bounce_start = now;
+            }
+            rays_per_depth[depth]++;
 
-        hit_record rec;
+            if (!world.hit(r, interval(0.001, infinity), rec)) {
+                if (first_hit && depth == 0)
+                    *first_hit = { ::color(background(r)), vec3(0,0,0), feature_buffers::miss_depth };
+                radiance += throughput * background(r);
+                break;
+            }
+
+            const material& mat = *rec.mat;
+            const int dimension = bounce_dimension + depth * dimensions_per_bounce;
+            color color_from_emission = visit_material<Materials...>(mat,
+                [&](const auto& m) { return m.emitted(r, rec); });
+            if (bsdf_pdf > 0 && !color_from_emission.near_zero()) {
+                auto light_pdf = lights->pmf(r.origin(), rec.object)
+                               * rec.object->pdf_value(r.origin(), r.direction());
+                color_from_emission = power_heuristic(bsdf_pdf, light_pdf) * color_from_emission;
+            }
+            radiance += throughput * color_from_emission;
 
-        if (world.hit(r, interval(0.001, infinity), rec)) {
             ray scattered;
             color attenuation;
-            if (rec.mat->scatter(r, rec, attenuation, scattered))
-                return attenuation * ray_color(scattered, depth-1, world);
-            return color(0,0,0);
+            s.set_dimension(dimension + scatter_offset);
+            bool scatters = visit_material<Materials...>(mat,
+                [&](const auto& m) { return m.scatter(r, rec, attenuation, scattered, s); });
+            if (first_hit && depth == 0) {
+                // Lights have their emission, clamped to 1, as albedo.
+                static const basic_interval<real> unit(0, 1);
+                color reflectance = scatters ? attenuation
+                                  : color(unit.clamp(color_from_emission.x()),
+                                          unit.clamp(color_from_emission.y()),
+                                          unit.clamp(color_from_emission.z()));
+                *first_hit = { ::color(reflectance), vec3(rec.normal),
+                               double(rec.t) * double(r.direction().length()) };
+            }
+            if (!scatters)
+                break;
+
+            bsdf_pdf = 0;
+            if (use_light_sampling()) {
+                bsdf_pdf = visit_material<Materials...>(mat,
+                    [&](const auto& m) { return m.scattering_pdf(r, rec, scattered); });
+                if (bsdf_pdf > 0) {
+                    s.set_dimension(dimension + light_pick_offset);
+                    radiance += throughput
+                              * sample_direct<Materials...>(r, rec, attenuation, world, s);
+                }
+            }
+
+            throughput = throughput * attenuation;
+            r = scattered;
+
+            // Past the first few bounces, continue with probability equal to the largest
+            // throughput component and boost survivors to keep the estimate unbiased.
+            if (russian_roulette && depth + 1 >= roulette_depth) {
+                auto survive = std::fmin(1.0, std::fmax(throughput.x(),
+                                              std::fmax(throughput.y(), throughput.z())));
+                s.set_dimension(dimension + roulette_offset);
+                if (s.get_1d() >= survive)
+                    break;
+                throughput /= survive;
+            }
         }
 
-        vec3 unit_direction = unit_vector(r.direction());
+        if (profile_bounces && depth_limit > 0)
+            cycles_per_depth[std::min(depth, depth_limit-1)] += cycle_count() - bounce_start;
+
+        return radiance;
+    }
+
+    template <typename... Materials>
+    color sample_direct(const ray& r, const hit_record& rec, const color& attenuation,
+                        const hittable& world, sampler& s) const {
+        // One light sample for the diffuse vertex rec, MIS-weighted against BSDF sampling.
+        double pick_pmf;
+        // The light choice and the direction toward it read consecutive dimensions.
+        int light_index = lights->sample(rec.p, s.get_1d(), pick_pmf);
+        if (light_index < 0 || pick_pmf <= 0)
+            return color(0,0,0);
+
+        const hittable& light = lights->object(light_index);
+        ray to_light(rec.p, light.random(rec.p, s));
+
+        hit_record light_rec;
+        if (!light.hit(to_light, interval(0.001, infinity), light_rec))
+            return color(0,0,0);
+
+        color emission = visit_material<Materials...>(*light_rec.mat,
+            [&](const auto& m) { return m.emitted(to_light, light_rec); });
+        auto bsdf_pdf = visit_material<Materials...>(*rec.mat,
+            [&](const auto& m) { return m.scattering_pdf(r, rec, to_light); });
+        if (emission.near_zero() || bsdf_pdf <= 0)
+            return color(0,0,0);
+
+        if (world.occluded(to_light, interval(0.001, light_rec.t * (1 - 1e-6))))
+            return color(0,0,0);
+
+        auto light_pdf = pick_pmf * light.pdf_value(rec.p, to_light.direction());
+        if (light_pdf <= 0)
+            return color(0,0,0);
+
+        // For the diffuse materials that reach here, attenuation * scattering_pdf is the BRDF
+        // times the cosine term.
+        return power_heuristic(light_pdf, bsdf_pdf) * bsdf_pdf / light_pdf * attenuation * emission;
+    }
+
+    bool use_light_sampling() const {
+        return sample_lights && lights && !lights->empty();
+    }
+
+    static double power_heuristic(double pdf_f, double pdf_g) {
+        return pdf_f*pdf_f / (pdf_f*pdf_f + pdf_g*pdf_g);
+    }
+
+    color background(const ray& r) const {
+        if (!sky_background)
+            return color(0,0,0);
+
+        vec unit_direction = unit_vector(r.direction());
         auto a = 0.5*(unit_direction.y() + 1.0);
         // Match the gradient from the main project:
         // color = glm::mix(glm::vec3(0.6f, 0.8f, 1.0f), glm::vec3(0.2f, 0.3f, 0.5f), v);
@@ -155,5 +469,7 @@ class camera {
     }
 };
 
+using camera = basic_camera<double_precision>;
+
 
 #endif
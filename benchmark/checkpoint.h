@@ -0,0 +1,169 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+class render_checkpoint {
+  // Everything needed to continue a render: the float sum of samples for each finished pixel,
+  // how many samples each of them has, the random generator state, and the scanline to resume
+  // from. The render settings are stored too, so a checkpoint is only used by the same render.
+  public:
+    int image_width = 0;
+    int image_height = 0;
+    int samples_per_pixel = 0;
+    int max_depth = 0;
+    int next_row = 0;                  // Rows before this one are finished
+    uint64_t random_state = 0;
+    std::vector<float> accumulation;   // RGB sums, next_row * image_width pixels
+    std::vector<uint32_t> sample_counts;
+
+    bool matches(int width, int height, int spp, int depth) const {
+        return image_width == width && image_height == height
+            && samples_per_pixel == spp && max_depth == depth;
+    }
+
+    bool save(const std::string& path) const {
+        // Written to a temporary file and renamed over the old checkpoint, so a crash while
+        // saving leaves the previous checkpoint intact.
+        auto temp = path + ".tmp";
+        auto f = std::fopen(temp.c_str(), "wb");
+        if (!f) return false;
+
+        auto pixels = size_t(next_row) * image_width;
+        int32_t fields[6] = { version, image_width, image_height, samples_per_pixel, max_depth,
+                              next_row };
+        bool ok = std::fwrite(magic, 1, 4, f) == 4
+               && std::fwrite(fields, sizeof(fields), 1, f) == 1
+               && std::fwrite(&random_state, sizeof(random_state), 1, f) == 1
+               && std::fwrite(sample_counts.data(), sizeof(uint32_t), pixels, f) == pixels
+               && std::fwrite(accumulation.data(), sizeof(float), 3*pixels, f) == 3*pixels;
+        ok = (std::fclose(f) == 0) && ok;
+        return ok && std::rename(temp.c_str(), path.c_str()) == 0;
+    }
+
+    bool load(const std::string& path) {
+        auto f = std::fopen(path.c_str(), "rb");
+        if (!f) return false;
+
+        char file_magic[4];
+        int32_t fields[6];
+        bool ok = std::fread(file_magic, 1, 4, f) == 4
+               && std::equal(file_magic, file_magic + 4, magic)
+               && std::fread(fields, sizeof(fields), 1, f) == 1
+               && fields[0] == version
+               && std::fread(&random_state, sizeof(random_state), 1, f) == 1;
+        if (ok) {
+            image_width = fields[1];
+            image_height = fields[2];
+            samples_per_pixel = fields[3];
+            max_depth = fields[4];
+            next_row = fields[5];
+            ok = image_width > 0 && image_height > 0 && next_row >= 0 && next_row <= image_height;
+        }
+        auto pixels = ok ? size_t(next_row) * image_width : 0;
+        if (ok) {
+            // A header promising more scanlines than the file holds is a truncated or damaged
+            // checkpoint; find out before allocating for them.
+            auto start = std::ftell(f);
+            ok = start >= 0 && std::fseek(f, 0, SEEK_END) == 0
+              && size_t(std::ftell(f) - start) >= pixels * (sizeof(uint32_t) + 3*sizeof(float))
+              && std::fseek(f, start, SEEK_SET) == 0;
+        }
+        if (ok) {
+            sample_counts.resize(pixels);
+            accumulation.resize(3*pixels);
+            ok = std::fread(sample_counts.data(), sizeof(uint32_t), pixels, f) == pixels
+              && std::fread(accumulation.data(), sizeof(float), 3*pixels, f) == 3*pixels;
+        }
+        std::fclose(f);
+        if (!ok) {
+            sample_counts.clear();
+            accumulation.clear();
+        }
+        return ok;
+    }
+
+  private:
+    static constexpr char magic[4] = { 'R', 'T', 'C', 'K' };
+    static const int32_t version = 1;
+};
+
+
+class checkpoint_writer {
+  // Saves checkpoints on a background thread so the render loop only pays for handing over a
+  // copy of its buffers. If a new checkpoint arrives while the previous one is still being
+  // written, the older pending one is dropped; only the latest state matters.
+  public:
+    explicit checkpoint_writer(std::string path) : path(std::move(path)) {
+        worker = std::thread([this] { run(); });
+    }
+
+    ~checkpoint_writer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+    }
+
+    void submit(render_checkpoint checkpoint) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending = std::move(checkpoint);
+            has_pending = true;
+        }
+        wake.notify_one();
+    }
+
+    int saved() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return saved_count;
+    }
+
+  private:
+    std::string path;
+    mutable std::mutex mutex;
+    std::condition_variable wake;
+    render_checkpoint pending;
+    bool has_pending = false;
+    bool stopping = false;
+    int saved_count = 0;
+    std::thread worker;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return has_pending || stopping; });
+            if (!has_pending) return;
+
+            auto checkpoint = std::move(pending);
+            has_pending = false;
+            lock.unlock();
+            bool ok = checkpoint.save(path);
+            lock.lock();
+            if (ok) saved_count++;
+            else std::clog << "\nCould not write checkpoint " << path << '\n';
+        }
+    }
+};
+
+
+#endif
@@ -0,0 +1,65 @@
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+// Noise against render time for the many-lights scene. Prints CSV rows of
+// method, samples per pixel, seconds and display-range RMSE against a high sample count reference.
+//
+//   make convergence && ./convergence [reference_spp] > convergence.csv
+
+#include "rtweekend.h"
+
+#include "image_error.h"
+#include "scenes.h"
+
+#include <chrono>
+#include <vector>
+
+
+int main(int argc, char** argv) {
+    int reference_spp = (argc > 1) ? std::atoi(argv[1]) : 1024;
+
+    hittable_list world;
+    light_bvh lights;
+    camera cam;
+    many_lights(world, lights, cam);
+    cam.image_width = 160;
+    cam.max_depth   = 8;
+
+    struct method {
+        const char* name;
+        bool sample_lights;
+        bool importance_sampling;
+    };
+    const method methods[] = {
+        { "bsdf_only",     false, true  },
+        { "nee_uniform",   true,  false },
+        { "nee_light_bvh", true,  true  },
+    };
+
+    seed_random(1);
+    cam.samples_per_pixel = reference_spp;
+    auto reference = cam.render_image(world, lights);
+
+    std::cout << "method,spp,seconds,rmse\n";
+    for (const auto& m : methods) {
+        cam.sample_lights = m.sample_lights;
+        lights.importance_sampling = m.importance_sampling;
+
+        for (int spp = 1; spp <= 64; spp *= 2) {
+            seed_random(2);
+            cam.samples_per_pixel = spp;
+            auto start = std::chrono::steady_clock::now();
+            auto image = cam.render_image(world, lights);
+            std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+
+            std::cout << m.name << ',' << spp << ',' << seconds.count() << ','
+                      << rmse(image, reference) << std::endl;
+        }
+    }
+}
@@ -0,0 +1,78 @@
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+// Low sample count renders of the many-lights scene put through the a-trous denoiser, against
+// brute-force renders at high sample counts. Prints CSV rows of method, samples per pixel,
+// render seconds, denoise seconds, and PSNR and SSIM against a high sample count reference.
+//
+//   make denoise && ./denoise [reference_spp] > denoise.csv
+
+#include "rtweekend.h"
+
+#include "denoise.h"
+#include "image_error.h"
+#include "scenes.h"
+
+#include <chrono>
+#include <vector>
+
+
+int main(int argc, char** argv) {
+    int reference_spp = (argc > 1) ? std::atoi(argv[1]) : 1024;
+
+    hittable_list world;
+    light_bvh lights;
+    camera cam;
+    many_lights(world, lights, cam);
+    cam.image_width = 160;
+    cam.max_depth   = 8;
+
+    // Framed below the lights: the directly seen lights are smaller than a pixel, so their
+    // coverage at a few samples is aliasing that no filter can get back, and it would swamp
+    // the error of the lighting.
+    cam.vfov   = 45;
+    cam.lookat = point3(0, -0.45, -1);
+
+    seed_random(1);
+    cam.samples_per_pixel = reference_spp;
+    auto reference = cam.render_image(world, lights);
+    int width = cam.image_width;
+
+    auto report = [&](const char* name, int spp, double render_seconds, double denoise_seconds,
+                      const std::vector<color>& image) {
+        std::cout << name << ',' << spp << ',' << render_seconds << ',' << denoise_seconds << ','
+                  << psnr(image, reference) << ',' << ssim(image, reference, width) << std::endl;
+    };
+
+    std::cout << "method,spp,render_seconds,denoise_seconds,psnr,ssim\n";
+    cam.write_features = true;
+    for (int spp = 1; spp <= 8; spp *= 2) {
+        seed_random(2);
+        cam.samples_per_pixel = spp;
+        auto start = std::chrono::steady_clock::now();
+        auto image = cam.render_image(world, lights);
+        auto rendered = std::chrono::steady_clock::now();
+        auto denoised = atrous_denoise(image, cam.features());
+        auto done = std::chrono::steady_clock::now();
+
+        std::chrono::duration<double> render_seconds = rendered - start, denoise_seconds = done - rendered;
+        report("noisy", spp, render_seconds.count(), 0, image);
+        report("atrous", spp, render_seconds.count(), denoise_seconds.count(), denoised);
+    }
+
+    cam.write_features = false;
+    for (int spp = 16; spp <= 256; spp *= 2) {
+        seed_random(2);
+        cam.samples_per_pixel = spp;
+        auto start = std::chrono::steady_clock::now();
+        auto image = cam.render_image(world, lights);
+        std::chrono::duration<double> seconds = std::chrono::steady_clock::now() - start;
+        report("brute_force", spp, seconds.count(), 0, image);
+    }
+}
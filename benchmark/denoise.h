@@ -0,0 +1,227 @@
+#ifndef DENOISE_H
+#define DENOISE_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "rtweekend.h"
+
+#include "feature_buffers.h"
+
+#include <algorithm>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al. 2010, "Edge-Avoiding A-Trous Wavelet
+// Transform for fast Global Illumination Filtering"). Each pass blurs with a 5x5 B3 spline
+// whose taps are 2^pass pixels apart, so five passes cover a 125 pixel wide footprint with
+// 25 taps each. Every tap is weighted down by how much it differs from the centre pixel in
+// color, normal, depth and albedo, which keeps edges and texture sharp.
+//
+// The filter runs on the image divided by the first-hit albedo, so it only has to smooth the
+// lighting, and multiplies the albedo back in at the end.
+
+struct atrous_settings {
+    int   iterations   = 5;
+    float sigma_color  = 1.5f;   // Color difference scale of the first pass, halved every pass
+    float sigma_normal = 0.3f;   // Normal difference scale
+    float sigma_depth  = 0.05f;  // Depth difference scale, relative to the centre pixel's depth
+    float sigma_albedo = 0.1f;   // Albedo difference scale
+    int   threads      = 0;      // Worker threads, 0 for one per hardware thread
+};
+
+
+inline float exp_negative(float x) {
+    // e^-x for x >= 0, to about 1e-4 relative, written so that loops over it vectorize: 2^-t
+    // is split into 2^ceil(-t), put straight into the exponent bits, and a polynomial for the
+    // fraction in (-1, 0].
+    //
+    // Past t = 24 the result is flushed to zero. A tap that far below the centre weight cannot
+    // change a float sum anyway, and the tiny weights it would get otherwise carried values
+    // down into denormals over the passes, which slowed the filter three times over. The test
+    // is on the bits, which order like the values for positive floats: a float compare may
+    // trap, and that keeps GCC from vectorizing the loop.
+    float t = x * 1.44269504f;
+    int32_t t_bits, cap_bits = 0x41c00000;  // 24.0f
+    std::memcpy(&t_bits, &t, sizeof(t));
+    int32_t keep = (t_bits - cap_bits) >> 31;  // All ones below the cap
+    t_bits = t_bits < cap_bits ? t_bits : cap_bits;
+    std::memcpy(&t, &t_bits, sizeof(t));
+
+    int whole = int(-t);
+    float f = -t - float(whole);
+    float p = 1.0f + f*(0.693147f + f*(0.240227f + f*(0.0555041f + f*(0.00961813f + f*0.00133336f))));
+    int32_t scale_bits = ((whole + 127) << 23) & keep;
+    float scale;
+    std::memcpy(&scale, &scale_bits, sizeof(scale));
+    return p * scale;
+}
+
+
+// One pass of the filter over one row. The planes are full images, read at taps around row y
+// and written at row y of out. sums is scratch space for 4 * width floats.
+struct atrous_pass {
+    int width, height, step;
+    const float* in[3];
+    float* out[3];
+    const float* albedo[3];
+    const float* normal[3];
+    const float* depth;
+    float inv_sigma_color, inv_sigma_normal, inv_sigma_depth, inv_sigma_albedo;  // 1 / sigma^2
+};
+
+MULTIVERSION inline void atrous_row(const atrous_pass& pass, int y, float* __restrict sums) {
+    static const float spline[5] = { 1/16.0f, 1/4.0f, 3/8.0f, 1/4.0f, 1/16.0f };
+    const int w = pass.width;
+    // sums is scratch that nothing else points into. Saying so (and keeping the sigmas in
+    // locals) spares GCC the run-time alias checks between it and the twelve input planes,
+    // which are too many for it to vectorize with.
+    float* sum_weight = sums;
+    float* sum_r = sums + w;
+    float* sum_g = sums + 2*w;
+    float* sum_b = sums + 3*w;
+    const float inv_sigma_color = pass.inv_sigma_color, inv_sigma_normal = pass.inv_sigma_normal;
+    const float inv_sigma_depth = pass.inv_sigma_depth, inv_sigma_albedo = pass.inv_sigma_albedo;
+    std::fill(sums, sums + 4*w, 0.0f);
+
+    auto row = size_t(y) * w;
+    const float *cr = pass.in[0] + row, *cg = pass.in[1] + row, *cb = pass.in[2] + row;
+    const float *nx = pass.normal[0] + row, *ny = pass.normal[1] + row, *nz = pass.normal[2] + row;
+    const float *ar = pass.albedo[0] + row, *ag = pass.albedo[1] + row, *ab = pass.albedo[2] + row;
+    const float* d = pass.depth + row;
+
+    for (int ky = -2; ky <= 2; ky++) {
+        int qy = y + ky * pass.step;
+        if (qy < 0 || qy >= pass.height)
+            continue;
+
+        for (int kx = -2; kx <= 2; kx++) {
+            // Taps that fall outside the image are left out; the weights are renormalised.
+            int dx = kx * pass.step;
+            int first = std::max(0, -dx), last = std::min(w, w - dx);
+            float h = spline[ky + 2] * spline[kx + 2];
+
+            auto tap = size_t(qy) * w + dx;
+            const float *qr = pass.in[0] + tap, *qg = pass.in[1] + tap, *qb = pass.in[2] + tap;
+            const float *qnx = pass.normal[0] + tap, *qny = pass.normal[1] + tap, *qnz = pass.normal[2] + tap;
+            const float *qar = pass.albedo[0] + tap, *qag = pass.albedo[1] + tap, *qab = pass.albedo[2] + tap;
+            const float* qd = pass.depth + tap;
+
+            for (int x = first; x < last; x++) {
+                float color_distance = (qr[x]-cr[x])*(qr[x]-cr[x]) + (qg[x]-cg[x])*(qg[x]-cg[x])
+                                     + (qb[x]-cb[x])*(qb[x]-cb[x]);
+                float normal_distance = (qnx[x]-nx[x])*(qnx[x]-nx[x]) + (qny[x]-ny[x])*(qny[x]-ny[x])
+                                      + (qnz[x]-nz[x])*(qnz[x]-nz[x]);
+                float albedo_distance = (qar[x]-ar[x])*(qar[x]-ar[x]) + (qag[x]-ag[x])*(qag[x]-ag[x])
+                                      + (qab[x]-ab[x])*(qab[x]-ab[x]);
+                float depth_distance = (qd[x] - d[x]) / d[x];
+                float weight = h * exp_negative(color_distance * inv_sigma_color
+                                              + normal_distance * inv_sigma_normal
+                                              + depth_distance * depth_distance * inv_sigma_depth
+                                              + albedo_distance * inv_sigma_albedo);
+                sum_weight[x] += weight;
+                sum_r[x] += weight * qr[x];
+                sum_g[x] += weight * qg[x];
+                sum_b[x] += weight * qb[x];
+            }
+        }
+    }
+
+    // The centre tap has weight 9/64 or more, so the sum is never zero.
+    for (int x = 0; x < w; x++) {
+        pass.out[0][row + x] = sum_r[x] / sum_weight[x];
+        pass.out[1][row + x] = sum_g[x] / sum_weight[x];
+        pass.out[2][row + x] = sum_b[x] / sum_weight[x];
+    }
+}
+
+
+template <typename Rows>
+void parallel_rows(int height, int threads, Rows rows) {
+    // Calls rows(first, last) for bands of rows on the given number of threads.
+    if (threads <= 0)
+        threads = int(std::max(1u, std::thread::hardware_concurrency()));
+    threads = std::min(threads, height);
+    if (threads <= 1) {
+        rows(0, height);
+        return;
+    }
+
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; t++) {
+        int first = int(int64_t(height) * t / threads);
+        int last = int(int64_t(height) * (t + 1) / threads);
+        workers.emplace_back([&rows, first, last] { rows(first, last); });
+    }
+    for (auto& worker : workers)
+        worker.join();
+}
+
+
+inline std::vector<color> atrous_denoise(const std::vector<color>& image, const feature_buffers& features,
+                                         const atrous_settings& settings = atrous_settings()) {
+    // Returns the filtered image. features must come from the render of image.
+    const int w = features.width, h = features.height;
+    const auto n = size_t(w) * h;
+
+    // Divide out the albedo where there is one; black albedo (a black background, say) leaves
+    // the color as it is.
+    std::vector<float> planes[2][3];
+    std::vector<float> modulation[3];
+    for (int c = 0; c < 3; c++) {
+        planes[0][c].resize(n);
+        planes[1][c].resize(n);
+        modulation[c].resize(n);
+        for (size_t p = 0; p < n; p++) {
+            auto a = features.albedo[c][p];
+            modulation[c][p] = a > 1e-3f ? a : 1.0f;
+            planes[0][c][p] = float(image[p][c]) / modulation[c][p];
+        }
+    }
+
+    atrous_pass pass;
+    pass.width = w;
+    pass.height = h;
+    for (int c = 0; c < 3; c++) {
+        pass.albedo[c] = features.albedo[c].data();
+        pass.normal[c] = features.normal[c].data();
+    }
+    pass.depth = features.depth.data();
+    pass.inv_sigma_normal = 1 / (settings.sigma_normal * settings.sigma_normal);
+    pass.inv_sigma_depth = 1 / (settings.sigma_depth * settings.sigma_depth);
+    pass.inv_sigma_albedo = 1 / (settings.sigma_albedo * settings.sigma_albedo);
+
+    int current = 0;
+    for (int iteration = 0; iteration < settings.iterations; iteration++) {
+        auto sigma_color = settings.sigma_color / float(1 << iteration);
+        pass.step = 1 << iteration;
+        pass.inv_sigma_color = 1 / (sigma_color * sigma_color);
+        for (int c = 0; c < 3; c++) {
+            pass.in[c] = planes[current][c].data();
+            pass.out[c] = planes[1 - current][c].data();
+        }
+
+        parallel_rows(h, settings.threads, [&](int first, int last) {
+            std::vector<float> sums(4 * size_t(w));
+            for (int y = first; y < last; y++)
+                atrous_row(pass, y, sums.data());
+        });
+        current = 1 - current;
+    }
+
+    std::vector<color> result(n);
+    for (size_t p = 0; p < n; p++)
+        for (int c = 0; c < 3; c++)
+            result[p][c] = planes[current][c][p] * modulation[c][p];
+    return result;
+}
+
+
+#endif
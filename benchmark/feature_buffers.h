@@ -0,0 +1,58 @@
+#ifndef FEATURE_BUFFERS_H
+#define FEATURE_BUFFERS_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "color.h"
+
+#include <vector>
+
+
+// What a camera ray found at its first hit, the auxiliary input of the denoiser. A miss has
+// the background as albedo, a zero normal and miss_depth.
+struct feature_sample {
+    color albedo;
+    vec3  normal;
+    double depth;  // Distance from the camera
+};
+
+
+// Per-pixel averages of the feature samples of a render, one float plane per channel.
+class feature_buffers {
+  public:
+    static constexpr float miss_depth = 1e4f;
+
+    int width = 0;
+    int height = 0;
+    std::vector<float> albedo[3];
+    std::vector<float> normal[3];
+    std::vector<float> depth;
+
+    void resize(int w, int h) {
+        width = w;
+        height = h;
+        auto n = size_t(w) * h;
+        for (int c = 0; c < 3; c++) {
+            albedo[c].assign(n, 0.0f);
+            normal[c].assign(n, 0.0f);
+        }
+        depth.assign(n, miss_depth);
+    }
+
+    void set(size_t pixel, const feature_sample& average) {
+        for (int c = 0; c < 3; c++) {
+            albedo[c][pixel] = float(average.albedo[c]);
+            normal[c][pixel] = float(average.normal[c]);
+        }
+        depth[pixel] = float(average.depth);
+    }
+};
+
+
+#endif
@@ -11,18 +11,26 @@
 // along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
 //==============================================================================================
 
-class material;
+#include "aabb.h"
+#include "sampler.h"
 
+template <typename P> class basic_hittable;
+template <typename P> class basic_material;
 
-class hit_record {
+
+template <typename P>
+class basic_hit_record {
   public:
-    point3 p;
-    vec3 normal;
-    shared_ptr<material> mat;
-    double t;
+    using real = typename P::real;
+
+    basic_vec3<real> p;
+    basic_vec3<real> normal;
+    const basic_material<P>* mat;
+    const basic_hittable<P>* object;  // The primitive that was hit, used to look it up as a light
+    real t;
     bool front_face;
 
-    void set_face_normal(const ray& r, const vec3& outward_normal) {
+    void set_face_normal(const basic_ray<real>& r, const basic_vec3<real>& outward_normal) {
         // Sets the hit record normal vector.
         // NOTE: the parameter `outward_normal` is assumed to have unit length.
 
@@ -32,12 +40,57 @@ class hit_record {
 };
 
 
-class hittable {
+template <typename P>
+class basic_hittable {
   public:
-    virtual ~hittable() = default;
+    using real = typename P::real;
+    using vec = basic_vec3<real>;
+    using ray = basic_ray<real>;
+    using interval = basic_interval<real>;
+    using aabb = basic_aabb<real>;
+    using hit_record = basic_hit_record<P>;
+
+    virtual ~basic_hittable() = default;
 
     virtual bool hit(const ray& r, interval ray_t, hit_record& rec) const = 0;
+
+    virtual bool occluded(const ray& r, interval ray_t) const {
+        // Returns true if anything is hit in ray_t. Aggregates override this to stop at the
+        // first hit instead of searching for the closest one.
+        hit_record rec;
+        return hit(r, ray_t, rec);
+    }
+
+    // Largest number of rays hit_group() is given at once.
+    static const int max_group = 64;
+
+    virtual void hit_group(const ray* rays, const int* active, int count, real t_min,
+                           real* t_max, hit_record* recs) const {
+        // Closest hits for the rays rays[active[k]], k < count. A hit on ray i inside
+        // (t_min, t_max[i]) is written to recs[i] and lowers t_max[i] to it, so calling this
+        // on several objects in turn leaves each ray's closest hit. A ray hit something if its
+        // t_max went down. Aggregates override it to test each of their boxes once for the
+        // whole group.
+        for (int k = 0; k < count; k++) {
+            int i = active[k];
+            if (hit(rays[i], interval(t_min, t_max[i]), recs[i]))
+                t_max[i] = recs[i].t;
+        }
+    }
+
+    virtual aabb bounding_box() const = 0;
+
+    virtual real pdf_value(const vec&, const vec&) const {
+        return 0;
+    }
+
+    virtual vec random(const vec&, sampler&) const {
+        return vec(1,0,0);
+    }
 };
 
+using hit_record = basic_hit_record<double_precision>;
+using hittable = basic_hittable<double_precision>;
+
 
 #endif
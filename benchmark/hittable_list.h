@@ -16,35 +16,64 @@
 #include <vector>
 
 
-class hittable_list : public hittable {
+template <typename P>
+class basic_hittable_list : public basic_hittable<P> {
   public:
-    std::vector<shared_ptr<hittable>> objects;
+    using real = typename P::real;
+    using ray = basic_ray<real>;
+    using interval = basic_interval<real>;
+    using aabb = basic_aabb<real>;
+    using hit_record = basic_hit_record<P>;
 
-    hittable_list() {}
-    hittable_list(shared_ptr<hittable> object) { add(object); }
+    std::vector<shared_ptr<basic_hittable<P>>> objects;
+
+    basic_hittable_list() {}
+    basic_hittable_list(shared_ptr<basic_hittable<P>> object) { add(object); }
 
     void clear() { objects.clear(); }
 
-    void add(shared_ptr<hittable> object) {
+    void add(shared_ptr<basic_hittable<P>> object) {
         objects.push_back(object);
+        bbox = aabb(bbox, object->bounding_box());
     }
 
     bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
-        hit_record temp_rec;
+        // Objects only write rec when they report a hit, so each closer hit can go straight
+        // into rec without a temporary record and copy.
         bool hit_anything = false;
         auto closest_so_far = ray_t.max;
 
         for (const auto& object : objects) {
-            if (object->hit(r, interval(ray_t.min, closest_so_far), temp_rec)) {
+            if (object->hit(r, interval(ray_t.min, closest_so_far), rec)) {
                 hit_anything = true;
-                closest_so_far = temp_rec.t;
-                rec = temp_rec;
+                closest_so_far = rec.t;
             }
         }
 
         return hit_anything;
     }
+
+    bool occluded(const ray& r, interval ray_t) const override {
+        for (const auto& object : objects) {
+            if (object->occluded(r, ray_t))
+                return true;
+        }
+        return false;
+    }
+
+    void hit_group(const ray* rays, const int* active, int count, real t_min,
+                   real* t_max, hit_record* recs) const override {
+        for (const auto& object : objects)
+            object->hit_group(rays, active, count, t_min, t_max, recs);
+    }
+
+    aabb bounding_box() const override { return bbox; }
+
+  private:
+    aabb bbox;
 };
 
+using hittable_list = basic_hittable_list<double_precision>;
+
 
 #endif
@@ -0,0 +1,87 @@
+#ifndef IMAGE_ERROR_H
+#define IMAGE_ERROR_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "color.h"
+
+#include <vector>
+
+
+inline double mse(const std::vector<color>& image, const std::vector<color>& reference) {
+    // Mean squared error in display range, so the antialiased edges of directly visible lights
+    // (with radiance far above 1) don't swamp the lighting noise.
+    static const interval display(0, 1);
+    double sum = 0;
+    for (size_t i = 0; i < image.size(); i++) {
+        for (int c = 0; c < 3; c++) {
+            auto d = display.clamp(image[i][c]) - display.clamp(reference[i][c]);
+            sum += d*d / 3;
+        }
+    }
+    return sum / image.size();
+}
+
+inline double rmse(const std::vector<color>& image, const std::vector<color>& reference) {
+    return std::sqrt(mse(image, reference));
+}
+
+inline double psnr(const std::vector<color>& image, const std::vector<color>& reference) {
+    // Peak signal to noise ratio in decibels, against a peak of 1.
+    return 10 * std::log10(1 / mse(image, reference));
+}
+
+inline double ssim(const std::vector<color>& image, const std::vector<color>& reference, int width) {
+    // Mean structural similarity (Wang et al. 2004) in display range: local means, variances
+    // and covariance under an 11x11 Gaussian with sigma 1.5, averaged over the color channels
+    // and over every window that fits in the image.
+    static const interval display(0, 1);
+    const int radius = 5;
+    const double c1 = 0.01 * 0.01, c2 = 0.03 * 0.03;
+    int height = int(image.size()) / width;
+
+    double kernel[2*radius + 1], kernel_sum = 0;
+    for (int i = -radius; i <= radius; i++)
+        kernel_sum += kernel[i + radius] = std::exp(-i*i / (2 * 1.5 * 1.5));
+    for (auto& k : kernel)
+        k /= kernel_sum;
+
+    double total = 0;
+    long windows = 0;
+    for (int y = radius; y < height - radius; y++) {
+        for (int x = radius; x < width - radius; x++) {
+            for (int c = 0; c < 3; c++) {
+                double mean_a = 0, mean_b = 0, aa = 0, bb = 0, ab = 0;
+                for (int j = -radius; j <= radius; j++) {
+                    for (int i = -radius; i <= radius; i++) {
+                        auto k = kernel[i + radius] * kernel[j + radius];
+                        auto p = size_t(y + j) * width + (x + i);
+                        auto a = display.clamp(image[p][c]);
+                        auto b = display.clamp(reference[p][c]);
+                        mean_a += k * a;
+                        mean_b += k * b;
+                        aa += k * a * a;
+                        bb += k * b * b;
+                        ab += k * a * b;
+                    }
+                }
+                auto var_a = aa - mean_a*mean_a;
+                auto var_b = bb - mean_b*mean_b;
+                auto covariance = ab - mean_a*mean_b;
+                total += (2*mean_a*mean_b + c1) * (2*covariance + c2)
+                       / ((mean_a*mean_a + mean_b*mean_b + c1) * (var_a + var_b + c2));
+            }
+            windows += 3;
+        }
+    }
+    return windows > 0 ? total / windows : 1.0;
+}
+
+
+#endif
@@ -0,0 +1,187 @@
+#ifndef LIGHT_BVH_H
+#define LIGHT_BVH_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "aabb.h"
+#include "hittable.h"
+
+#include <algorithm>
+#include <numeric>
+#include <unordered_map>
+#include <vector>
+
+
+// Hierarchy over the emissive objects of a scene, used to pick a light for next-event
+// estimation. Each node stores the bounds and total power of the lights below it, and a light
+// is chosen by walking down from the root, taking each child with probability proportional to
+// its estimated contribution at the shading point. Both picking a light and evaluating the
+// probability of having picked it take O(log n).
+template <typename P>
+class basic_light_bvh {
+  public:
+    using real = typename P::real;
+    using vec = basic_vec3<real>;
+    using aabb = basic_aabb<real>;
+    using hittable = basic_hittable<P>;
+
+    bool importance_sampling = true;  // Pick lights by estimated contribution, else uniformly
+
+    void add(shared_ptr<hittable> light, const color& emission) {
+        // Power only has to be right up to a constant factor, so the box area stands in for the
+        // emitting surface area.
+        auto box = light->bounding_box();
+        auto dx = box.x.size(), dy = box.y.size(), dz = box.z.size();
+        auto luminance = 0.2126*emission.x() + 0.7152*emission.y() + 0.0722*emission.z();
+
+        index_of[light.get()] = int(lights.size());
+        lights.push_back(light);
+        powers.push_back(luminance * 2*(dx*dy + dy*dz + dz*dx));
+    }
+
+    void build() {
+        // Must be called once after the last add() and before sampling.
+        nodes.clear();
+        trails.assign(lights.size(), 0);
+        depths.assign(lights.size(), 0);
+        if (lights.empty())
+            return;
+
+        std::vector<int> ids(lights.size());
+        std::iota(ids.begin(), ids.end(), 0);
+        build_node(ids, 0, ids.size(), 0, 0);
+    }
+
+    bool empty() const { return lights.empty(); }
+    int size() const { return int(lights.size()); }
+    const hittable& object(int light) const { return *lights[light]; }
+
+    int sample(const vec& p, double u, double& pmf) const {
+        // Picks a light for shading point p using the uniform number u, and returns its index
+        // along with the probability it had of being picked. Returns -1 if there are no lights.
+        if (lights.empty())
+            return -1;
+
+        if (!importance_sampling) {
+            pmf = 1.0 / lights.size();
+            return std::min(int(u * lights.size()), int(lights.size()) - 1);
+        }
+
+        pmf = 1;
+        int k = 0;
+        while (nodes[k].left >= 0) {
+            auto p_left = left_probability(nodes[k], p);
+            if (u < p_left) {
+                u = u / p_left;
+                pmf *= p_left;
+                k = nodes[k].left;
+            } else {
+                u = (u - p_left) / (1 - p_left);
+                pmf *= 1 - p_left;
+                k = nodes[k].right;
+            }
+            u = std::min(u, 1 - 1e-12);
+        }
+        return nodes[k].light;
+    }
+
+    double pmf(const vec& p, const hittable* light) const {
+        // Probability that sample() at p returns the given object, or zero for non-lights.
+        auto it = index_of.find(light);
+        if (it == index_of.end())
+            return 0;
+
+        if (!importance_sampling)
+            return 1.0 / lights.size();
+
+        // Replay the path from the root to the light's leaf.
+        int i = it->second;
+        double pmf = 1;
+        int k = 0;
+        for (int d = 0; d < depths[i]; d++) {
+            auto p_left = left_probability(nodes[k], p);
+            if (trails[i] >> d & 1) {
+                pmf *= 1 - p_left;
+                k = nodes[k].right;
+            } else {
+                pmf *= p_left;
+                k = nodes[k].left;
+            }
+        }
+        return pmf;
+    }
+
+  private:
+    struct node {
+        aabb bbox;
+        double power;
+        int left, right;  // Child node indices, -1 for leaves
+        int light;        // Light index for leaves
+    };
+
+    std::vector<shared_ptr<hittable>> lights;
+    std::vector<double> powers;
+    std::vector<node> nodes;
+    std::vector<unsigned long long> trails;  // Bit d set if the path to the light goes right at depth d
+    std::vector<int> depths;
+    std::unordered_map<const hittable*, int> index_of;
+
+    int build_node(std::vector<int>& ids, size_t start, size_t end, unsigned long long trail, int depth) {
+        int k = int(nodes.size());
+        nodes.push_back(node());
+
+        aabb bbox = aabb::empty;
+        double power = 0;
+        for (size_t i = start; i < end; i++) {
+            bbox = aabb(bbox, lights[ids[i]]->bounding_box());
+            power += powers[ids[i]];
+        }
+
+        int left = -1, right = -1, light = -1;
+        if (end - start == 1) {
+            light = ids[start];
+            trails[light] = trail;
+            depths[light] = depth;
+        } else {
+            // Median split along the longest axis of the light bounds.
+            int axis = bbox.longest_axis();
+            auto mid = start + (end - start)/2;
+            std::nth_element(ids.begin() + start, ids.begin() + mid, ids.begin() + end,
+                [&](int a, int b) {
+                    return lights[a]->bounding_box().center()[axis]
+                         < lights[b]->bounding_box().center()[axis];
+                });
+            left = build_node(ids, start, mid, trail, depth + 1);
+            right = build_node(ids, mid, end, trail | (1ull << depth), depth + 1);
+        }
+
+        nodes[k] = node{bbox, power, left, right, light};
+        return k;
+    }
+
+    double importance(const node& n, const vec& p) const {
+        // Power over squared distance, with the distance clamped to the node radius so that
+        // points inside or near a cluster don't blow up.
+        auto d2 = (n.bbox.center() - p).length_squared();
+        auto dx = n.bbox.x.size(), dy = n.bbox.y.size(), dz = n.bbox.z.size();
+        auto r2 = 0.25 * (dx*dx + dy*dy + dz*dz);
+        return n.power / std::fmax(d2, r2);
+    }
+
+    double left_probability(const node& n, const vec& p) const {
+        auto il = importance(nodes[n.left], p);
+        auto ir = importance(nodes[n.right], p);
+        return (il + ir > 0) ? il / (il + ir) : 0.5;
+    }
+};
+
+using light_bvh = basic_light_bvh<double_precision>;
+
+
+#endif
@@ -11,47 +11,67 @@
 
 #include "rtweekend.h"
 
+#include "arena.h"
 #include "camera.h"
 #include "hittable.h"
 #include "hittable_list.h"
+#include "light_bvh.h"
 #include "material.h"
+#include "scenes.h"
 #include "sphere.h"
 
 #include <iostream>
 #include <fstream>
+#include <string>
 
-int main() {
-    hittable_list world;
-
-    auto material_center = make_shared<lambertian>(color(0.7, 0.2, 0.2)); // Red
-    auto material_left   = make_shared<lambertian>(color(0.7, 0.2, 0.2));
-    auto material_right  = make_shared<lambertian>(color(0.7, 0.2, 0.2));
-
-    world.add(make_shared<sphere>(point3( 0.0, 0.0, -3.0), 1.0, material_center));
-    world.add(make_shared<sphere>(point3(-2.0, 0.0, -4.0), 1.0, material_left));
-    world.add(make_shared<sphere>(point3( 2.0, 0.0, -4.0), 1.0, material_right));
+int main(int argc, char** argv) {
+    // Usage: benchmark [scene] [--spp n] [--checkpoint file] [--interval seconds] [--resume]
+    //   scene       1 = three spheres (default), 2 = many small lights, 3 = a million spheres
+    //   --spp         samples per pixel, overriding the scene's
+    //   --checkpoint  save progress to file while rendering (render.ckpt with --resume)
+    //   --interval    seconds between checkpoints, 60 by default
+    //   --resume      continue from the checkpoint if it belongs to this render
+    int scene = 1;
+    std::string checkpoint_path;
+    double interval = 60;
+    bool resume = false;
+    int spp = 0;
+    for (int a = 1; a < argc; a++) {
+        std::string arg = argv[a];
+        if (arg == "--spp" && a + 1 < argc)            spp = std::atoi(argv[++a]);
+        else if (arg == "--checkpoint" && a + 1 < argc) checkpoint_path = argv[++a];
+        else if (arg == "--interval" && a + 1 < argc)  interval = std::atof(argv[++a]);
+        else if (arg == "--resume")                    resume = true;
+        else                                           scene = std::atoi(argv[a]);
+    }
+    if (resume && checkpoint_path.empty())
+        checkpoint_path = "render.ckpt";
 
+    // Scene objects, materials and BVH nodes are packed into one arena, declared first so it
+    // outlives everything that points into it.
+    arena scene_memory(size_t(16) << 20);
+    hittable_list world;
+    light_bvh lights;
     camera cam;
 
-    cam.aspect_ratio      = 4.0 / 3.0;
-    cam.image_width       = 800;
-    cam.samples_per_pixel = 1;
-    cam.max_depth         = 50;
-
-    cam.vfov     = 90;
-    cam.lookfrom = point3(0,0,0);
-    cam.lookat   = point3(0,0,-1);
-    cam.vup      = vec3(0,1,0);
+    switch (scene) {
+        case 2:  many_lights(world, lights, cam, &scene_memory);   break;
+        case 3:  many_spheres(world, lights, cam, &scene_memory);  break;
+        default: three_spheres(world, lights, cam, &scene_memory); break;
+    }
 
-    cam.defocus_angle = 0.0;
-    cam.focus_dist    = 1.0;
+    if (spp > 0)
+        cam.samples_per_pixel = spp;
+    cam.checkpoint_path = checkpoint_path;
+    cam.checkpoint_interval = interval;
+    cam.resume = resume;
 
     // Redirect std::cout to a file
     std::ofstream outfile("image.ppm");
     std::streambuf *coutbuf = std::cout.rdbuf(); // Save old buf
     std::cout.rdbuf(outfile.rdbuf()); // Redirect std::cout to image.ppm
 
-    cam.render(world);
+    cam.render(world, lights);
 
     std::cout.rdbuf(coutbuf); // Reset to standard output
 }
@@ -13,26 +13,79 @@
 
 #include "hittable.h"
 
+#include <utility>
 
-class material {
+
+template <typename P>
+class basic_material {
   public:
-    virtual ~material() = default;
+    using real = typename P::real;
+    using color = basic_vec3<real>;
+    using ray = basic_ray<real>;
+    using hit_record = basic_hit_record<P>;
+
+    const int kind;  // Which concrete material this is, for visit_material()
+
+    basic_material() : kind(0) {}
+    virtual ~basic_material() = default;
+
+    virtual color emitted(const ray&, const hit_record&) const {
+        return color(0,0,0);
+    }
 
-    virtual bool scatter(
-        const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered
-    ) const {
+    virtual bool scatter(const ray&, const hit_record&, color&, ray&, sampler&) const {
         return false;
     }
+
+    virtual real scattering_pdf(const ray&, const hit_record&, const ray&)
+    const {
+        // Density of scatter() over directions. Zero marks a specular material that direct
+        // light sampling cannot help.
+        return 0;
+    }
+
+  protected:
+    basic_material(int kind) : kind(kind) {}
 };
 
+using material = basic_material<double_precision>;
+
 
-class lambertian : public material {
+// Calls visitor with mat downcast to whichever of Materials it is. The concrete materials are
+// final, so calls made through the downcast reference are direct and can be inlined. Any
+// material not in the list is passed as a plain material& and goes through the vtable.
+template <typename P, typename Visitor>
+decltype(auto) visit_material(const basic_material<P>& mat, Visitor&& visitor) {
+    return visitor(mat);
+}
+
+template <typename First, typename... Rest, typename P, typename Visitor>
+decltype(auto) visit_material(const basic_material<P>& mat, Visitor&& visitor) {
+    if (mat.kind == First::material_kind)
+        return visitor(static_cast<const First&>(mat));
+    return visit_material<Rest...>(mat, std::forward<Visitor>(visitor));
+}
+
+
+// The concrete materials take their parameters in double and store them in P::real.
+
+template <typename P>
+class basic_lambertian final : public basic_material<P> {
   public:
-    lambertian(const color& albedo) : albedo(albedo) {}
+    using real = typename P::real;
+    using vec = basic_vec3<real>;
+    using color = basic_vec3<real>;
+    using ray = basic_ray<real>;
+    using hit_record = basic_hit_record<P>;
 
-    bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered)
-    const override {
-        auto scatter_direction = rec.normal + random_unit_vector();
+    static const int material_kind = 1;
+
+    basic_lambertian(const vec3& albedo) : basic_material<P>(material_kind), albedo(albedo) {}
+
+    bool scatter(
+        const ray&, const hit_record& rec, color& attenuation, ray& scattered, sampler& s
+    ) const override {
+        auto scatter_direction = rec.normal + vec(square_to_unit_vector(s.get_2d()));
 
         // Catch degenerate scatter direction
         if (scatter_direction.near_zero())
@@ -43,19 +96,37 @@ class lambertian : public material {
         return true;
     }
 
+    real scattering_pdf(const ray&, const hit_record& rec, const ray& scattered)
+    const override {
+        // scatter() is cosine-weighted, and albedo * cos/pi is also the BRDF times cosine.
+        auto cos_theta = dot(rec.normal, unit_vector(scattered.direction()));
+        return cos_theta < 0 ? 0 : cos_theta/real(pi);
+    }
+
   private:
     color albedo;
 };
 
 
-class metal : public material {
+template <typename P>
+class basic_metal final : public basic_material<P> {
   public:
-    metal(const color& albedo, double fuzz) : albedo(albedo), fuzz(fuzz < 1 ? fuzz : 1) {}
-
-    bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered)
-    const override {
-        vec3 reflected = reflect(r_in.direction(), rec.normal);
-        reflected = unit_vector(reflected) + (fuzz * random_unit_vector());
+    using real = typename P::real;
+    using vec = basic_vec3<real>;
+    using color = basic_vec3<real>;
+    using ray = basic_ray<real>;
+    using hit_record = basic_hit_record<P>;
+
+    static const int material_kind = 2;
+
+    basic_metal(const vec3& albedo, double fuzz)
+      : basic_material<P>(material_kind), albedo(albedo), fuzz(real(fuzz < 1 ? fuzz : 1)) {}
+
+    bool scatter(
+        const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered, sampler& s
+    ) const override {
+        vec reflected = reflect(r_in.direction(), rec.normal);
+        reflected = unit_vector(reflected) + (fuzz * vec(square_to_unit_vector(s.get_2d())));
         scattered = ray(rec.p, reflected);
         attenuation = albedo;
         return (dot(scattered.direction(), rec.normal) > 0);
@@ -63,27 +134,38 @@ class metal : public material {
 
   private:
     color albedo;
-    double fuzz;
+    real fuzz;
 };
 
 
-class dielectric : public material {
+template <typename P>
+class basic_dielectric final : public basic_material<P> {
   public:
-    dielectric(double refraction_index) : refraction_index(refraction_index) {}
+    using real = typename P::real;
+    using vec = basic_vec3<real>;
+    using color = basic_vec3<real>;
+    using ray = basic_ray<real>;
+    using hit_record = basic_hit_record<P>;
 
-    bool scatter(const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered)
-    const override {
+    static const int material_kind = 3;
+
+    basic_dielectric(double refraction_index)
+      : basic_material<P>(material_kind), refraction_index(real(refraction_index)) {}
+
+    bool scatter(
+        const ray& r_in, const hit_record& rec, color& attenuation, ray& scattered, sampler& s
+    ) const override {
         attenuation = color(1.0, 1.0, 1.0);
-        double ri = rec.front_face ? (1.0/refraction_index) : refraction_index;
+        real ri = rec.front_face ? (1/refraction_index) : refraction_index;
 
-        vec3 unit_direction = unit_vector(r_in.direction());
-        double cos_theta = std::fmin(dot(-unit_direction, rec.normal), 1.0);
-        double sin_theta = std::sqrt(1.0 - cos_theta*cos_theta);
+        vec unit_direction = unit_vector(r_in.direction());
+        real cos_theta = std::fmin(dot(-unit_direction, rec.normal), real(1));
+        real sin_theta = std::sqrt(1 - cos_theta*cos_theta);
 
-        bool cannot_refract = ri * sin_theta > 1.0;
-        vec3 direction;
+        bool cannot_refract = ri * sin_theta > 1;
+        vec direction;
 
-        if (cannot_refract || reflectance(cos_theta, ri) > random_double())
+        if (cannot_refract || reflectance(cos_theta, ri) > s.get_1d())
             direction = reflect(unit_direction, rec.normal);
         else
             direction = refract(unit_direction, rec.normal, ri);
@@ -95,9 +177,9 @@ class dielectric : public material {
   private:
     // Refractive index in vacuum or air, or the ratio of the material's refractive index over
     // the refractive index of the enclosing media
-    double refraction_index;
+    real refraction_index;
 
-    static double reflectance(double cosine, double refraction_index) {
+    static real reflectance(real cosine, real refraction_index) {
         // Use Schlick's approximation for reflectance.
         auto r0 = (1 - refraction_index) / (1 + refraction_index);
         r0 = r0*r0;
@@ -106,4 +188,34 @@ class dielectric : public material {
 };
 
 
+template <typename P>
+class basic_diffuse_light final : public basic_material<P> {
+  public:
+    using real = typename P::real;
+    using color = basic_vec3<real>;
+    using ray = basic_ray<real>;
+    using hit_record = basic_hit_record<P>;
+
+    static const int material_kind = 4;
+
+    basic_diffuse_light(const vec3& emit) : basic_material<P>(material_kind), emit(emit) {}
+
+    color emitted(const ray&, const hit_record& rec) const override {
+        if (!rec.front_face)
+            return color(0,0,0);
+        return emit;
+    }
+
+    const color& emission() const { return emit; }
+
+  private:
+    color emit;
+};
+
+using lambertian = basic_lambertian<double_precision>;
+using metal = basic_metal<double_precision>;
+using dielectric = basic_dielectric<double_precision>;
+using diffuse_light = basic_diffuse_light<double_precision>;
+
+
 #endif
@@ -0,0 +1,43 @@
+#ifndef ONB_H
+#define ONB_H
+//==============================================================================================
+// Originally written in 2016 by Peter Shirley <ptrshrl@gmail.com>
+//
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+
+template <typename T>
+class basic_onb {
+  public:
+    using vec = basic_vec3<T>;
+
+    basic_onb(const vec& n) {
+        axis[2] = unit_vector(n);
+        vec a = (std::fabs(axis[2].x()) > T(0.9)) ? vec(0,1,0) : vec(1,0,0);
+        axis[1] = unit_vector(cross(axis[2], a));
+        axis[0] = cross(axis[2], axis[1]);
+    }
+
+    const vec& u() const { return axis[0]; }
+    const vec& v() const { return axis[1]; }
+    const vec& w() const { return axis[2]; }
+
+    vec transform(const vec& v) const {
+        // Transform from basis coordinates to local space.
+        return (v[0] * axis[0]) + (v[1] * axis[1]) + (v[2] * axis[2]);
+    }
+
+  private:
+    vec axis[3];
+};
+
+using onb = basic_onb<double>;
+
+
+#endif
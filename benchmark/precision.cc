@@ -0,0 +1,107 @@
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+// The integrator instantiated in double, float, and mixed precision (float everywhere except
+// the sphere quadratic and light cone sampling), rendering the same scenes. Reports time, rays
+// per second, and the error of each against a converged double render. The Sobol sampler ties
+// every random number to its pixel, sample and dimension, so a path that goes a different way
+// in float does not shift the random numbers of the pixels after it.
+//
+//   make precision && ./precision [width] [spp] [spheres for scene 3]
+
+#include "rtweekend.h"
+
+#include "image_error.h"
+#include "scenes.h"
+
+#include <chrono>
+#include <cstdio>
+#include <numeric>
+#include <vector>
+
+
+struct run_result {
+    std::vector<color> image;
+    double seconds;
+    long long rays;
+    size_t object_bytes;
+};
+
+
+template <typename P>
+run_result run(int scene, int width, int spp, int sphere_count) {
+    basic_hittable_list<P> world;
+    basic_light_bvh<P> lights;
+    basic_camera<P> cam;
+    seed_random(1);
+    switch (scene) {
+        case 2:  many_lights(world, lights, cam);                         break;
+        case 3:  many_spheres(world, lights, cam, nullptr, sphere_count); break;
+        default: three_spheres(world, lights, cam);                       break;
+    }
+    cam.image_width = width;
+    cam.samples_per_pixel = spp;
+    cam.pixel_sampler = make_shared<sobol_sampler>();
+
+    run_result result;
+    auto start = std::chrono::steady_clock::now();
+    result.image = cam.render_image(world, lights);
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    auto& rays = cam.ray_counts();
+    result.rays = std::accumulate(rays.begin(), rays.end(), 0LL);
+    result.object_bytes = sizeof(basic_sphere<P>) + sizeof(basic_lambertian<P>)
+                        + sizeof(basic_bvh_node<P>);
+    return result;
+}
+
+
+double mean_value(const std::vector<color>& image) {
+    double sum = 0;
+    for (const auto& pixel : image)
+        sum += (pixel.x() + pixel.y() + pixel.z()) / 3;
+    return sum / image.size();
+}
+
+
+void report(const char* name, const run_result& r, const run_result& same_spp,
+            const run_result& converged) {
+    // Error against a converged double render, next to what the double render at the same spp
+    // has; the mean difference shows bias that noise would average out.
+    auto bias = mean_value(r.image) / mean_value(converged.image) - 1;
+    std::printf("  %-7s %8.3f s %7.3f Mrays/s %6.2fx %5zu B   rmse %.3e   mean %+.3f%%\n",
+                name, r.seconds, r.rays / r.seconds * 1e-6, same_spp.seconds / r.seconds, r.object_bytes,
+                rmse(r.image, converged.image), 100 * bias);
+}
+
+
+int main(int argc, char** argv) {
+    int width        = (argc > 1) ? std::atoi(argv[1]) : 160;
+    int spp          = (argc > 2) ? std::atoi(argv[2]) : 16;
+    int sphere_count = (argc > 3) ? std::atoi(argv[3]) : 100000;
+    int converged_spp = 16 * spp;
+
+    const char* names[] = { "three spheres", "many lights", "many spheres" };
+    std::printf("%dx%d at %d spp. Error against double at %d spp; speed against double; bytes per "
+                "sphere, material and BVH node.\n", width, int(width / (4.0 / 3.0)), spp, converged_spp);
+
+    auto clogbuf = std::clog.rdbuf(nullptr);
+    for (int scene = 1; scene <= 3; scene++) {
+        auto converged = run<double_precision>(scene, width, converged_spp, sphere_count);
+        auto reference = run<double_precision>(scene, width, spp, sphere_count);
+        auto single = run<single_precision>(scene, width, spp, sphere_count);
+        auto mixed = run<mixed_precision>(scene, width, spp, sphere_count);
+
+        std::printf("\n%d: %s\n", scene, names[scene - 1]);
+        report("double", reference, reference, converged);
+        report("float", single, reference, converged);
+        report("mixed", mixed, reference, converged);
+    }
+    std::clog.clear();
+    std::clog.rdbuf(clogbuf);
+}
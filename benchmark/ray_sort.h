@@ -0,0 +1,107 @@
+#ifndef RAY_SORT_H
+#define RAY_SORT_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "aabb.h"
+
+#include <cstdint>
+#include <vector>
+
+
+// Reordering of a batch of rays for coherent traversal. After a diffuse bounce neighbouring
+// paths leave in unrelated directions, so tracing them in path order visits a different part
+// of the BVH on every ray. Sorting the batch by direction octant, then by the Morton code of
+// the origin, puts rays that start close together and head the same general way next to each
+// other, where they walk mostly the same nodes.
+
+template <typename T>
+inline uint32_t direction_octant(const basic_vec3<T>& d) {
+    // One bit per axis, set where the direction is negative.
+    return uint32_t(d.x() < 0) | (uint32_t(d.y() < 0) << 1) | (uint32_t(d.z() < 0) << 2);
+}
+
+inline uint32_t spread_bits(uint32_t x) {
+    // Moves the low 10 bits of x to every third bit.
+    x &= 0x3ff;
+    x = (x | (x << 16)) & 0x030000ff;
+    x = (x | (x <<  8)) & 0x0300f00f;
+    x = (x | (x <<  4)) & 0x030c30c3;
+    x = (x | (x <<  2)) & 0x09249249;
+    return x;
+}
+
+template <typename T>
+inline uint32_t morton_code(const basic_vec3<T>& p, const basic_aabb<T>& bounds) {
+    // 30-bit Morton code of p on a 1024^3 grid over bounds; points outside are clamped.
+    uint32_t code = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        const auto& extent = bounds.axis_interval(axis);
+        auto size = extent.size();
+        auto cell = size > 0 ? (p[axis] - extent.min) / size * 1024 : T(0);
+        cell = cell < 0 ? T(0) : (cell > 1023 ? T(1023) : cell);
+        code |= spread_bits(uint32_t(cell)) << axis;
+    }
+    return code;
+}
+
+template <typename T>
+inline uint64_t ray_sort_key(const basic_ray<T>& r, const basic_aabb<T>& bounds) {
+    // The octant is the most significant part, so each octant's rays end up in one run.
+    return (uint64_t(direction_octant(r.direction())) << 30) | morton_code(r.origin(), bounds);
+}
+
+
+// Stable least-significant-digit radix sort of 33-bit keys, in three passes of 11 bits. The
+// buffers are kept between calls, so sorting every bounce of a frame allocates only once.
+class ray_sorter {
+  public:
+    const std::vector<uint32_t>& sort(const std::vector<uint64_t>& keys) {
+        // Returns the order that sorts keys: keys[order[0]] is the smallest.
+        auto n = keys.size();
+        key_buffer.assign(keys.begin(), keys.end());
+        key_scratch.resize(n);
+        order.resize(n);
+        order_scratch.resize(n);
+        for (size_t i = 0; i < n; i++)
+            order[i] = uint32_t(i);
+
+        for (int shift = 0; shift < key_bits; shift += digit_bits) {
+            uint32_t start[buckets + 1] = {};
+            for (size_t i = 0; i < n; i++)
+                start[digit(key_buffer[i], shift) + 1]++;
+            for (int b = 0; b < buckets; b++)
+                start[b + 1] += start[b];
+
+            for (size_t i = 0; i < n; i++) {
+                auto slot = start[digit(key_buffer[i], shift)]++;
+                key_scratch[slot] = key_buffer[i];
+                order_scratch[slot] = order[i];
+            }
+            key_buffer.swap(key_scratch);
+            order.swap(order_scratch);
+        }
+        return order;
+    }
+
+  private:
+    static const int key_bits = 33;
+    static const int digit_bits = 11;
+    static const int buckets = 1 << digit_bits;
+
+    std::vector<uint64_t> key_buffer, key_scratch;
+    std::vector<uint32_t> order, order_scratch;
+
+    static uint32_t digit(uint64_t key, int shift) {
+        return uint32_t(key >> shift) & (buckets - 1);
+    }
+};
+
+
+#endif
@@ -0,0 +1,72 @@
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+// Russian roulette against fixed-depth paths. Reports rays traced per bounce depth, render
+// time and error for both, and the speedup at equal variance (ratio of time times MSE).
+//
+//   make roulette && ./roulette [scene] [spp] [reference_spp]
+
+#include "rtweekend.h"
+
+#include "image_error.h"
+#include "scenes.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+
+int main(int argc, char** argv) {
+    int scene         = (argc > 1) ? std::atoi(argv[1]) : 1;
+    int spp           = (argc > 2) ? std::atoi(argv[2]) : 16;
+    int reference_spp = (argc > 3) ? std::atoi(argv[3]) : 1024;
+
+    hittable_list world;
+    light_bvh lights;
+    camera cam;
+    switch (scene) {
+        case 2:  many_lights(world, lights, cam);   break;
+        default: three_spheres(world, lights, cam); break;
+    }
+    cam.image_width = 160;
+
+    seed_random(1);
+    cam.russian_roulette = false;
+    cam.samples_per_pixel = reference_spp;
+    auto reference = cam.render_image(world, lights);
+
+    double seconds[2], error[2];
+    std::vector<long long> counts[2];
+    cam.samples_per_pixel = spp;
+    for (int rr = 0; rr < 2; rr++) {
+        seed_random(2);
+        cam.russian_roulette = (rr == 1);
+        auto start = std::chrono::steady_clock::now();
+        auto image = cam.render_image(world, lights);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        seconds[rr] = elapsed.count();
+        error[rr] = mse(image, reference);
+        counts[rr] = cam.ray_counts();
+    }
+
+    std::printf("depth  rays (fixed depth)  rays (roulette)\n");
+    long long total[2] = {0, 0};
+    for (size_t d = 0; d < counts[0].size(); d++) {
+        total[0] += counts[0][d];
+        total[1] += counts[1][d];
+        if (counts[0][d] || counts[1][d])
+            std::printf("%5zu  %18lld  %15lld\n", d, counts[0][d], counts[1][d]);
+    }
+    std::printf("total  %18lld  %15lld\n\n", total[0], total[1]);
+
+    std::printf("fixed depth: %.3f s, MSE %.3e\n", seconds[0], error[0]);
+    std::printf("roulette:    %.3f s, MSE %.3e\n", seconds[1], error[1]);
+    std::printf("speedup at equal variance: %.2fx\n",
+                (seconds[0] * error[0]) / (seconds[1] * error[1]));
+}
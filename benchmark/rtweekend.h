@@ -9,12 +9,18 @@
 // along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
 //==============================================================================================
 
+#include <chrono>
 #include <cmath>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <limits>
 #include <memory>
 
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
 
 // C++ Std Usings
 
@@ -28,15 +34,68 @@ const double infinity = std::numeric_limits<double>::infinity();
 const double pi = 3.1415926535897932385;
 
 
+// Multiversioning
+
+// Hot functions marked MULTIVERSION are compiled for each x86-64 level (SSE4.2, AVX2 with FMA,
+// AVX-512) next to the baseline, and the loader picks the copy for the CPU it runs on. GCC
+// cannot do this for virtual functions, so hit() and scatter() stay baseline unless inlined.
+// Builds for one fixed target (-march=native) define NO_MULTIVERSION.
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) && !defined(NO_MULTIVERSION)
+#define MULTIVERSION \
+    __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#else
+#define MULTIVERSION
+#endif
+
+
+// Precision
+
+// Scalar types the integrator is instantiated with. Geometry, traversal and shading use real;
+// the few steps that lose too much accuracy in float (the sphere quadratic, far from the
+// origin of a large sphere) use robust.
+
+struct double_precision {
+    using real = double;
+    using robust = double;
+};
+
+struct single_precision {
+    using real = float;
+    using robust = float;
+};
+
+struct mixed_precision {
+    using real = float;
+    using robust = double;
+};
+
+
 // Utility Functions
 
 inline double degrees_to_radians(double degrees) {
     return degrees * pi / 180.0;
 }
 
+inline uint64_t& random_state() {
+    // State of the generator behind random_double(). It is a single integer so a render can
+    // save it in a checkpoint and later continue the exact same random sequence.
+    static uint64_t state = 0x853c49e6748fea9bull;
+    return state;
+}
+
+inline void seed_random(uint64_t seed) {
+    random_state() = seed * 0x9e3779b97f4a7c15ull + 0x853c49e6748fea9bull;
+}
+
 inline double random_double() {
-    // Returns a random real in [0,1).
-    return std::rand() / (RAND_MAX + 1.0);
+    // Returns a random real in [0,1), from a PCG32 generator (O'Neill 2014).
+    uint64_t old = random_state();
+    random_state() = old * 6364136223846793005ull + 1442695040888963407ull;
+    uint32_t shifted = uint32_t(((old >> 18) ^ old) >> 27);
+    uint32_t rot = uint32_t(old >> 59);
+    uint32_t bits = (shifted >> rot) | (shifted << ((32 - rot) & 31));
+    return bits * 0x1p-32;
 }
 
 inline double random_double(double min, double max) {
@@ -44,6 +103,16 @@ inline double random_double(double min, double max) {
     return min + (max-min)*random_double();
 }
 
+inline unsigned long long cycle_count() {
+    // Returns the CPU timestamp counter where there is one, nanoseconds otherwise.
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
 
 // Common Headers
 
@@ -0,0 +1,394 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "vec3.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+
+// Samplers hand out the uniform numbers a path consumes. Each sample of a pixel is a point in a
+// high-dimensional unit cube, and the camera says which dimension it is reading with
+// set_dimension(), so a given bounce always reads the same dimensions no matter how many
+// numbers earlier bounces used. Low-discrepancy samplers can then stratify each of them.
+class sampler {
+  public:
+    virtual ~sampler() = default;
+
+    // Called once per render before any samples are taken.
+    virtual void init(int) {}
+
+    // Starts sample number sample_index of pixel (i, j), at dimension 0.
+    virtual void start_pixel_sample(int, int, int) {
+        dimension = 0;
+    }
+
+    void set_dimension(int d) { dimension = d; }
+
+    virtual double get_1d() = 0;
+
+    // Returns two uniform numbers in x() and y(); z() is zero.
+    virtual vec3 get_2d() = 0;
+
+  protected:
+    int dimension = 0;
+};
+
+
+// Bit and hashing helpers shared by the low-discrepancy samplers.
+
+inline uint64_t mix_bits(uint64_t v) {
+    v ^= (v >> 31);
+    v *= 0x7fb5d329728ea185ull;
+    v ^= (v >> 27);
+    v *= 0x81dadef4bc2dd44dull;
+    v ^= (v >> 33);
+    return v;
+}
+
+inline uint32_t hash_sample(int i, int j, int dimension, uint32_t salt = 0) {
+    return uint32_t(mix_bits((uint64_t(uint32_t(i)) << 40) ^ (uint64_t(uint32_t(j)) << 20)
+                             ^ uint64_t(uint32_t(dimension)) ^ (uint64_t(salt) << 52)));
+}
+
+inline uint32_t reverse_bits(uint32_t x) {
+    // Branch-free, so loops over many values vectorize.
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+}
+
+inline uint32_t owen_scramble(uint32_t x, uint32_t seed) {
+    // Hash-based nested uniform (Owen) scrambling of the bits of x, after Burley 2020,
+    // "Practical Hash-based Owen Scrambling". The Laine-Karras style hash only lets each bit
+    // depend on the bits below it, so it is applied to the reversed value.
+    x = reverse_bits(x);
+    x ^= x * 0x3d20adeau;
+    x += seed;
+    x *= (seed >> 16) | 1;
+    x ^= x * 0x05526c56u;
+    x ^= x * 0x53a22864u;
+    return reverse_bits(x);
+}
+
+inline uint32_t permutation_element(uint32_t i, uint32_t l, uint32_t p) {
+    // Element i of a pseudo-random permutation of [0, l) selected by p (Kensler 2013,
+    // "Correlated Multi-Jittered Sampling").
+    uint32_t w = l - 1;
+    w |= w >> 1;
+    w |= w >> 2;
+    w |= w >> 4;
+    w |= w >> 8;
+    w |= w >> 16;
+    do {
+        i ^= p;             i *= 0xe170893d;
+        i ^= p >> 16;       i ^= (i & w) >> 4;
+        i ^= p >> 8;        i *= 0x0929eb3f;
+        i ^= p >> 23;       i ^= (i & w) >> 1;
+        i *= 1 | p >> 27;   i *= 0x6935fa69;
+        i ^= (i & w) >> 11; i *= 0x74dcb303;
+        i ^= (i & w) >> 2;  i *= 0x9e501cc3;
+        i ^= (i & w) >> 2;  i *= 0xc860a3df;
+        i &= w;
+        i ^= i >> 5;
+    } while (i >= l);
+    return (i + p) % l;
+}
+
+inline double to_unit_float(uint32_t x) {
+    // Maps 32 bits to [0,1), staying strictly below 1.
+    return std::fmin(x * 0x1p-32, 1 - 1e-16);
+}
+
+
+class independent_sampler : public sampler {
+  // Independent uniform numbers from random_double(), the original behaviour.
+  public:
+    double get_1d() override { return random_double(); }
+
+    vec3 get_2d() override {
+        auto x = random_double();
+        auto y = random_double();
+        return vec3(x, y, 0);
+    }
+};
+
+
+class sobol_sampler : public sampler {
+  // Owen-scrambled Sobol points, padded: every 1D or 2D request uses the first two Sobol
+  // dimensions (which form a (0,2)-sequence), with its own scrambling seed and its own shuffle of
+  // the sample order. Each pixel and dimension gets a decorrelated but well stratified set.
+  public:
+    void init(int samples_per_pixel) override {
+        spp = samples_per_pixel;
+        pixel_i = pixel_j = -1;
+    }
+
+    void start_pixel_sample(int i, int j, int sample_index) override {
+        sampler::start_pixel_sample(i, j, sample_index);
+        index = uint32_t(sample_index);
+
+        // The pixel jitter for all of a pixel's samples is generated in one batch.
+        if (i != pixel_i || j != pixel_j) {
+            pixel_i = i;
+            pixel_j = j;
+            jitter_x.resize(spp);
+            jitter_y.resize(spp);
+            generate_2d(hash_sample(i, j, 0), 0, spp, jitter_x.data(), jitter_y.data());
+        }
+    }
+
+    double get_1d() override {
+        auto seed = hash_sample(pixel_i, pixel_j, dimension++, 1);
+        return to_unit_float(owen_scramble(reverse_bits(shuffle(index, seed)), uint32_t(mix_bits(seed))));
+    }
+
+    vec3 get_2d() override {
+        if (dimension == 0 && index < jitter_x.size()) {
+            dimension += 2;
+            return vec3(jitter_x[index], jitter_y[index], 0);
+        }
+        double x, y;
+        generate_2d(hash_sample(pixel_i, pixel_j, dimension, 0), index, 1, &x, &y);
+        dimension += 2;
+        return vec3(x, y, 0);
+    }
+
+    static void generate_2d(uint32_t seed, uint32_t first, int count, double* xs, double* ys) {
+        // Points first .. first+count-1 of one scrambled 2D stream.
+        uint32_t seed_x = uint32_t(mix_bits(seed ^ 0x5bd1e995u));
+        uint32_t seed_y = uint32_t(mix_bits(seed ^ 0x68e31da4u));
+        for (int k = 0; k < count; k++) {
+            uint32_t s = shuffle(first + uint32_t(k), seed);
+            xs[k] = to_unit_float(owen_scramble(reverse_bits(s), seed_x));
+            ys[k] = to_unit_float(owen_scramble(sobol_1(s), seed_y));
+        }
+    }
+
+  private:
+    int spp = 1;
+    int pixel_i = -1, pixel_j = -1;
+    uint32_t index = 0;
+    std::vector<double> jitter_x, jitter_y;
+
+    static uint32_t shuffle(uint32_t index, uint32_t seed) {
+        // Owen-scrambling the index permutes the order of the points while keeping every
+        // power-of-two prefix a valid (scrambled) Sobol set.
+        return owen_scramble(index, seed);
+    }
+
+    static uint32_t sobol_1(uint32_t index) {
+        // Second Sobol dimension (primitive polynomial x + 1). Its generator matrix is Pascal's
+        // triangle mod 2, so in bit-reversed form bit p of the result is the parity of the index
+        // bits at every superset k of p. That superset sum takes five shift-and-xor steps and no
+        // loop over the index bits, which keeps generate_2d() branch-free.
+        uint32_t x = index;
+        x ^= (x >> 1) & 0x55555555u;
+        x ^= (x >> 2) & 0x33333333u;
+        x ^= (x >> 4) & 0x0f0f0f0fu;
+        x ^= (x >> 8) & 0x00ff00ffu;
+        x ^= (x >> 16) & 0x0000ffffu;
+        return reverse_bits(x);
+    }
+};
+
+
+class lattice_sampler : public sampler {
+  // Randomized rank-1 lattice. The samples of a pixel form the lattice {i/n, i*g/n} with n the
+  // sample count and g chosen at init() to maximise the minimum point distance. Every dimension
+  // pair gets a random shift (Cranley-Patterson rotation) and its own permutation of the points.
+  public:
+    void init(int samples_per_pixel) override {
+        n = std::max(1, samples_per_pixel);
+        generator = best_generator(n);
+    }
+
+    void start_pixel_sample(int i, int j, int sample_index) override {
+        sampler::start_pixel_sample(i, j, sample_index);
+        pixel_i = i;
+        pixel_j = j;
+        index = uint32_t(sample_index) % uint32_t(n);
+    }
+
+    double get_1d() override {
+        auto seed = hash_sample(pixel_i, pixel_j, dimension++, 2);
+        auto k = permutation_element(index, n, seed);
+        return fract((k + 0.5) / n + to_unit_float(uint32_t(mix_bits(seed))));
+    }
+
+    vec3 get_2d() override {
+        auto seed = hash_sample(pixel_i, pixel_j, dimension, 3);
+        dimension += 2;
+        auto k = permutation_element(index, n, seed);
+        auto shift = mix_bits(seed);
+        auto x = fract(double(k) / n + to_unit_float(uint32_t(shift)));
+        auto y = fract(double(uint64_t(k) * generator % n) / n + to_unit_float(uint32_t(shift >> 32)));
+        return vec3(x, y, 0);
+    }
+
+  private:
+    uint32_t n = 1;
+    uint32_t generator = 1;
+    int pixel_i = 0, pixel_j = 0;
+    uint32_t index = 0;
+
+    static double fract(double x) { return x - std::floor(x); }
+
+    static uint32_t best_generator(uint32_t n) {
+        // Exhaustive search over Korobov generators (1, g), O(n^2). For a lattice the minimum
+        // distance between any two points is the minimum distance from the origin.
+        uint32_t best = 1;
+        double best_distance = -1;
+        for (uint32_t g = 1; g < n; g++) {
+            double min_distance = 2;
+            for (uint32_t i = 1; i < n && min_distance > best_distance; i++) {
+                auto x = double(i) / n;
+                auto y = double(uint64_t(i) * g % n) / n;
+                x = std::fmin(x, 1 - x);
+                y = std::fmin(y, 1 - y);
+                min_distance = std::fmin(min_distance, x*x + y*y);
+            }
+            if (min_distance > best_distance) {
+                best_distance = min_distance;
+                best = g;
+            }
+        }
+        return best;
+    }
+};
+
+
+class blue_noise_sampler : public sampler {
+  // Kronecker (R2) low-discrepancy sequence, shifted per pixel by a blue-noise texture. Nearby
+  // pixels get very different shifts with no low-frequency structure, so the remaining error
+  // shows up as high-frequency, blue-noise-like grain. Each dimension reads the texture at its
+  // own toroidal offset.
+  public:
+    void start_pixel_sample(int i, int j, int sample_index) override {
+        sampler::start_pixel_sample(i, j, sample_index);
+        pixel_i = i;
+        pixel_j = j;
+        index = uint32_t(sample_index);
+    }
+
+    double get_1d() override {
+        auto shift = mask_value(dimension++);
+        return fract(0.5 + index * 0.6180339887498949 + shift);
+    }
+
+    vec3 get_2d() override {
+        // Generalised golden ratio for two dimensions (Roberts 2018).
+        auto sx = mask_value(dimension);
+        auto sy = mask_value(dimension + 1);
+        dimension += 2;
+        return vec3(fract(0.5 + index * 0.7548776662466927 + sx),
+                    fract(0.5 + index * 0.5698402909980532 + sy), 0);
+    }
+
+  private:
+    static const int size = 64;
+    int pixel_i = 0, pixel_j = 0;
+    uint32_t index = 0;
+
+    static double fract(double x) { return x - std::floor(x); }
+
+    double mask_value(int dim) const {
+        auto offset = mix_bits(uint64_t(dim) + 0x9e3779b9u);
+        int x = (pixel_i + int(offset & (size - 1))) & (size - 1);
+        int y = (pixel_j + int((offset >> 8) & (size - 1))) & (size - 1);
+        return (mask()[y*size + x] + 0.5) / (size*size);
+    }
+
+    static const std::vector<int>& mask() {
+        // Blue-noise dither mask ranked by void-and-cluster (Ulichney 1993), built once at
+        // startup.
+        static const std::vector<int> m = void_and_cluster();
+        return m;
+    }
+
+    static std::vector<int> void_and_cluster() {
+        const int n = size*size;
+        const double sigma = 1.5;
+
+        // Toroidal Gaussian energy kernel.
+        std::vector<double> kernel(n);
+        for (int y = 0; y < size; y++) {
+            for (int x = 0; x < size; x++) {
+                int dx = std::min(x, size - x), dy = std::min(y, size - y);
+                kernel[y*size + x] = std::exp(-(dx*dx + dy*dy) / (2*sigma*sigma));
+            }
+        }
+
+        std::vector<char> on(n, 0);
+        std::vector<double> energy(n, 0);
+        auto splat = [&](int p, double sign) {
+            int px = p % size, py = p / size;
+            for (int y = 0; y < size; y++)
+                for (int x = 0; x < size; x++)
+                    energy[y*size + x] += sign * kernel[((y - py) & (size-1))*size + ((x - px) & (size-1))];
+        };
+        auto tightest_cluster = [&] {
+            int best = -1;
+            for (int p = 0; p < n; p++)
+                if (on[p] && (best < 0 || energy[p] > energy[best])) best = p;
+            return best;
+        };
+        auto largest_void = [&] {
+            int best = -1;
+            for (int p = 0; p < n; p++)
+                if (!on[p] && (best < 0 || energy[p] < energy[best])) best = p;
+            return best;
+        };
+
+        // Initial pattern: a sparse random set, relaxed by moving the tightest cluster point
+        // into the largest void until that would undo the move.
+        uint64_t state = 1;
+        int initial = n / 10;
+        for (int placed = 0; placed < initial; ) {
+            state = mix_bits(state + 1);
+            int p = int(state % n);
+            if (!on[p]) { on[p] = 1; splat(p, 1); placed++; }
+        }
+        for (int iteration = 0; iteration < n; iteration++) {
+            int cluster = tightest_cluster();
+            on[cluster] = 0; splat(cluster, -1);
+            int hole = largest_void();
+            on[hole] = 1; splat(hole, 1);
+            if (hole == cluster)
+                break;
+        }
+
+        // Rank the initial points by removing clusters, then fill voids for the rest.
+        std::vector<int> rank(n, 0);
+        std::vector<char> initial_on = on;
+        std::vector<double> initial_energy = energy;
+        for (int r = initial - 1; r >= 0; r--) {
+            int cluster = tightest_cluster();
+            on[cluster] = 0; splat(cluster, -1);
+            rank[cluster] = r;
+        }
+        on = initial_on;
+        energy = initial_energy;
+        for (int r = initial; r < n; r++) {
+            int hole = largest_void();
+            on[hole] = 1; splat(hole, 1);
+            rank[hole] = r;
+        }
+        return rank;
+    }
+};
+
+
+#endif
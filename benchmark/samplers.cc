@@ -0,0 +1,119 @@
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+// Compares the samplers. By default prints CSV rows of sampler, samples per pixel, seconds and
+// RMSE against an independent-sampling reference, for plotting error against render time. With
+// "speed" as the first argument it reports how fast each sampler generates points instead.
+//
+//   make samplers && ./samplers [scene] [reference_spp] > samplers.csv
+//   ./samplers speed
+
+#include "rtweekend.h"
+
+#include "image_error.h"
+#include "scenes.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+
+struct named_sampler {
+    const char* name;
+    shared_ptr<sampler> instance;
+};
+
+
+std::vector<named_sampler> all_samplers() {
+    return {
+        { "independent", make_shared<independent_sampler>() },
+        { "sobol_owen",  make_shared<sobol_sampler>()       },
+        { "lattice",     make_shared<lattice_sampler>()     },
+        { "blue_noise",  make_shared<blue_noise_sampler>()  },
+    };
+}
+
+
+double seconds_since(std::chrono::steady_clock::time_point start) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
+
+
+void generation_speed() {
+    // Points as the camera requests them: a pixel sample, then 2D requests in successive
+    // dimensions, as a path of 8 bounces would.
+    const int spp = 64, pixels = 20000, dims = 8;
+    for (auto& s : all_samplers()) {
+        s.instance->init(spp);
+        double sink = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (int p = 0; p < pixels; p++) {
+            for (int k = 0; k < spp; k++) {
+                s.instance->start_pixel_sample(p % 200, p / 200, k);
+                for (int d = 0; d < dims; d++)
+                    sink += s.instance->get_2d().x();
+            }
+        }
+        auto seconds = seconds_since(start);
+        std::printf("%-12s %8.1f M 2D points/s   (checksum %.0f)\n",
+                    s.name, double(pixels) * spp * dims / seconds * 1e-6, sink);
+    }
+
+    // The batched Sobol path the camera uses for pixel jitter.
+    const int batch = 1 << 20;
+    std::vector<double> xs(batch), ys(batch);
+    auto start = std::chrono::steady_clock::now();
+    for (int r = 0; r < 16; r++)
+        sobol_sampler::generate_2d(uint32_t(r), 0, batch, xs.data(), ys.data());
+    auto seconds = seconds_since(start);
+    std::printf("%-12s %8.1f M 2D points/s   (batched generate_2d)\n",
+                "sobol_owen", 16.0 * batch / seconds * 1e-6);
+}
+
+
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "speed") == 0) {
+        generation_speed();
+        return 0;
+    }
+
+    int scene         = (argc > 1) ? std::atoi(argv[1]) : 1;
+    int reference_spp = (argc > 2) ? std::atoi(argv[2]) : 1024;
+
+    hittable_list world;
+    light_bvh lights;
+    camera cam;
+    switch (scene) {
+        case 2:  many_lights(world, lights, cam);   break;
+        default: three_spheres(world, lights, cam); break;
+    }
+    cam.image_width = 160;
+    cam.max_depth   = 8;
+
+    seed_random(1);
+    cam.samples_per_pixel = reference_spp;
+    auto reference = cam.render_image(world, lights);
+
+    std::cout << "sampler,spp,seconds,rmse\n";
+    for (auto& s : all_samplers()) {
+        cam.pixel_sampler = s.instance;
+        for (int spp = 1; spp <= 64; spp *= 2) {
+            seed_random(2);
+            cam.samples_per_pixel = spp;
+            auto start = std::chrono::steady_clock::now();
+            auto image = cam.render_image(world, lights);
+            auto seconds = seconds_since(start);
+
+            std::cout << s.name << ',' << spp << ',' << seconds << ','
+                      << rmse(image, reference) << std::endl;
+        }
+    }
+}
@@ -0,0 +1,127 @@
+#ifndef SCENES_H
+#define SCENES_H
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+#include "rtweekend.h"
+
+#include "arena.h"
+#include "bvh.h"
+#include "camera.h"
+#include "hittable.h"
+#include "hittable_list.h"
+#include "light_bvh.h"
+#include "material.h"
+#include "sphere.h"
+
+
+template <typename P>
+void setup_camera(basic_camera<P>& cam) {
+    // The view shared with the main project: 800x600, 90 degree field of view down -z.
+    cam.aspect_ratio      = 4.0 / 3.0;
+    cam.image_width       = 800;
+    cam.samples_per_pixel = 1;
+    cam.max_depth         = 50;
+
+    cam.vfov     = 90;
+    cam.lookfrom = point3(0,0,0);
+    cam.lookat   = point3(0,0,-1);
+    cam.vup      = vec3(0,1,0);
+
+    cam.defocus_angle = 0.0;
+    cam.focus_dist    = 1.0;
+}
+
+
+template <typename P>
+void three_spheres(basic_hittable_list<P>& world, basic_light_bvh<P>& lights, basic_camera<P>& cam,
+                   arena* memory = nullptr) {
+    // Objects go in the memory arena when one is given, which must then outlive the world.
+    using lambertian = basic_lambertian<P>;
+    using sphere = basic_sphere<P>;
+
+    auto material_center = make_shared_in<lambertian>(memory, color(0.7, 0.2, 0.2)); // Red
+    auto material_left   = make_shared_in<lambertian>(memory, color(0.7, 0.2, 0.2));
+    auto material_right  = make_shared_in<lambertian>(memory, color(0.7, 0.2, 0.2));
+
+    world.add(make_shared_in<sphere>(memory, point3( 0.0, 0.0, -3.0), 1.0, material_center));
+    world.add(make_shared_in<sphere>(memory, point3(-2.0, 0.0, -4.0), 1.0, material_left));
+    world.add(make_shared_in<sphere>(memory, point3( 2.0, 0.0, -4.0), 1.0, material_right));
+
+    setup_camera(cam);
+    lights.build();
+}
+
+
+template <typename P>
+void many_lights(basic_hittable_list<P>& world, basic_light_bvh<P>& lights, basic_camera<P>& cam,
+                 arena* memory = nullptr, int light_count = 2000) {
+    // The three spheres on a ground plane, lit only by a cloud of small emissive spheres.
+    using hittable_list = basic_hittable_list<P>;
+    using lambertian = basic_lambertian<P>;
+    using diffuse_light = basic_diffuse_light<P>;
+    using sphere = basic_sphere<P>;
+    using bvh_node = basic_bvh_node<P>;
+
+    auto ground = make_shared_in<lambertian>(memory, color(0.5, 0.5, 0.5));
+    auto red    = make_shared_in<lambertian>(memory, color(0.7, 0.2, 0.2));
+
+    hittable_list list;
+    list.add(make_shared_in<sphere>(memory, point3(0,-1001,-4), 1000, ground));
+    list.add(make_shared_in<sphere>(memory, point3( 0.0, 0.0, -3.0), 1.0, red));
+    list.add(make_shared_in<sphere>(memory, point3(-2.0, 0.0, -4.0), 1.0, red));
+    list.add(make_shared_in<sphere>(memory, point3( 2.0, 0.0, -4.0), 1.0, red));
+
+    for (int i = 0; i < light_count; i++) {
+        point3 center(random_double(-10, 10), random_double(1.2, 5), random_double(-14, -1.5));
+        auto emission = (color::random(0.2, 1) * 30.0);
+        auto light = make_shared_in<sphere>(memory, center, 0.04,
+                                            make_shared_in<diffuse_light>(memory, emission));
+        list.add(light);
+        lights.add(light, emission);
+    }
+
+    world.add(make_shared_in<bvh_node>(memory, list, memory));
+    lights.build();
+
+    setup_camera(cam);
+    cam.sky_background = false;
+}
+
+
+template <typename P>
+void many_spheres(basic_hittable_list<P>& world, basic_light_bvh<P>& lights, basic_camera<P>& cam,
+                  arena* memory = nullptr, int count = 1000000) {
+    // A field of small spheres under the sky, each with a material of its own, filling the
+    // view. Made to stress scene construction and memory layout rather than shading.
+    using hittable_list = basic_hittable_list<P>;
+    using lambertian = basic_lambertian<P>;
+    using sphere = basic_sphere<P>;
+    using bvh_node = basic_bvh_node<P>;
+
+    hittable_list list;
+    list.objects.reserve(count);
+    auto radius = 2.0 / std::cbrt(double(count));
+
+    for (int i = 0; i < count; i++) {
+        point3 center(random_double(-16, 16), random_double(-12, 12), random_double(-40, -4));
+        auto albedo = color::random(0.2, 0.9);
+        list.add(make_shared_in<sphere>(memory, center, radius * random_double(0.5, 1.5),
+                                        make_shared_in<lambertian>(memory, albedo)));
+    }
+
+    world.add(make_shared_in<bvh_node>(memory, list, memory));
+    lights.build();
+
+    setup_camera(cam);
+    cam.max_depth = 8;
+}
+
+
+#endif
@@ -0,0 +1,368 @@
+//==============================================================================================
+// To the extent possible under law, the author(s) have dedicated all copyright and related and
+// neighboring rights to this software to the public domain worldwide. This software is
+// distributed without any warranty.
+//
+// You should have received a copy (see file COPYING.txt) of the CC0 Public Domain Dedication
+// along with this software. If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+//==============================================================================================
+
+// Ray reordering for the bounces after the first diffuse hit, on the million-sphere scene.
+// Paths are traced breadth first: every bounce of a sample is one batch of rays, traced, then
+// shaded into the next batch. The batches of secondary rays are traced either in path order
+// or sorted by direction octant and origin Morton code (ray_sort.h), and either one ray at a
+// time or in groups that share each BVH node fetch (hittable::hit_group). Reports trace speed
+// for camera rays and for secondary rays, the cost of sorting, and cache misses per secondary
+// ray where the kernel gives access to the hardware counters. Every path reads its random
+// numbers from a hash of its pixel, sample and dimension, so all four runs must produce the
+// same image.
+//
+//   make sorting && ./sorting [count] [width] [spp]
+
+#include "rtweekend.h"
+
+#include "arena.h"
+#include "ray_sort.h"
+#include "scenes.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+
+static double seconds_since(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+// Cache references, last-level misses and L1 data read misses of this thread, counted only
+// while enabled. Virtual machines and locked-down kernels often have no hardware counters,
+// and then available() is false.
+class cache_counters {
+  public:
+    static const int count = 3;
+
+    cache_counters() {
+        const uint64_t configs[count][2] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                  | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+        };
+        for (int c = 0; c < count; c++) {
+            perf_event_attr attr;
+            std::memset(&attr, 0, sizeof(attr));
+            attr.size = sizeof(attr);
+            attr.type = uint32_t(configs[c][0]);
+            attr.config = configs[c][1];
+            attr.disabled = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            fds[c] = int(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+    }
+
+    ~cache_counters() {
+        for (int fd : fds)
+            if (fd >= 0)
+                close(fd);
+    }
+
+    bool available() const { return fds[0] >= 0 && fds[1] >= 0 && fds[2] >= 0; }
+
+    void start() { control(PERF_EVENT_IOC_ENABLE); }
+    void stop()  { control(PERF_EVENT_IOC_DISABLE); }
+
+    void reset() {
+        control(PERF_EVENT_IOC_RESET);
+    }
+
+    uint64_t read_value(int c) const {
+        uint64_t value = 0;
+        if (fds[c] < 0 || read(fds[c], &value, sizeof(value)) != ssize_t(sizeof(value)))
+            return 0;
+        return value;
+    }
+
+  private:
+    int fds[count];
+
+    void control(unsigned long request) {
+        for (int fd : fds)
+            if (fd >= 0)
+                ioctl(fd, request, 0);
+    }
+};
+
+
+// Random numbers from a hash of pixel, sample and dimension, so they do not depend on the
+// order in which paths are traced.
+class path_sampler : public sampler {
+  public:
+    void start_pixel_sample(int i, int j, int sample_index) override {
+        pixel_i = i;
+        pixel_j = j;
+        sample = uint32_t(sample_index);
+        dimension = 0;
+    }
+
+    double get_1d() override {
+        return hash_sample(pixel_i, pixel_j, dimension++, sample) * 0x1p-32;
+    }
+
+    vec3 get_2d() override {
+        auto x = get_1d();
+        auto y = get_1d();
+        return vec3(x, y, 0);
+    }
+
+  private:
+    int pixel_i = 0, pixel_j = 0;
+    uint32_t sample = 0;
+};
+
+
+// One bounce's worth of paths, as parallel arrays so the rays are contiguous for hit_group().
+struct path_batch {
+    std::vector<ray> rays;
+    std::vector<color> throughput;
+    std::vector<uint32_t> pixels;
+
+    size_t size() const { return rays.size(); }
+
+    void clear() {
+        rays.clear();
+        throughput.clear();
+        pixels.clear();
+    }
+
+    void add(const ray& r, const color& t, uint32_t pixel) {
+        rays.push_back(r);
+        throughput.push_back(t);
+        pixels.push_back(pixel);
+    }
+};
+
+
+struct run_result {
+    std::vector<color> image;
+    long long primary_rays = 0, secondary_rays = 0;
+    double primary_seconds = 0, secondary_seconds = 0, sort_seconds = 0;
+    uint64_t counters[cache_counters::count] = {};
+};
+
+
+class wavefront_tracer {
+  public:
+    wavefront_tracer(const hittable& world, const camera& cam, int width, int height, int max_depth)
+      : world(world), bounds(world.bounding_box()), width(width), height(height), max_depth(max_depth)
+    {
+        // The scene's camera looks down -z from the origin with no defocus.
+        auto h = std::tan(degrees_to_radians(cam.vfov) / 2);
+        viewport_height = 2 * h * cam.focus_dist;
+        viewport_width = viewport_height * double(width) / height;
+        focus_dist = cam.focus_dist;
+    }
+
+    run_result render(int spp, bool sort, bool grouped, cache_counters& counters) {
+        run_result result;
+        result.image.assign(size_t(width) * height, color(0,0,0));
+        counters.reset();
+
+        for (int sample = 0; sample < spp; sample++) {
+            batch.clear();
+            for (int j = 0; j < height; j++)
+                for (int i = 0; i < width; i++) {
+                    s.start_pixel_sample(i, j, sample);
+                    batch.add(camera_ray(i, j), color(1,1,1), uint32_t(j * width + i));
+                }
+
+            for (int depth = 0; depth < max_depth && batch.size() > 0; depth++) {
+                auto start = std::chrono::steady_clock::now();
+                if (sort && depth > 0) {
+                    reorder();
+                    result.sort_seconds += seconds_since(start);
+                    start = std::chrono::steady_clock::now();
+                }
+
+                if (depth > 0)
+                    counters.start();
+                trace(grouped);
+                if (depth > 0)
+                    counters.stop();
+
+                if (depth == 0) {
+                    result.primary_seconds += seconds_since(start);
+                    result.primary_rays += batch.size();
+                } else {
+                    result.secondary_seconds += seconds_since(start);
+                    result.secondary_rays += batch.size();
+                }
+
+                shade(sample, depth, result.image);
+            }
+        }
+
+        for (int c = 0; c < cache_counters::count; c++)
+            result.counters[c] = counters.read_value(c);
+        for (auto& pixel : result.image)
+            pixel /= spp;
+        return result;
+    }
+
+  private:
+    const hittable& world;
+    aabb bounds;
+    int width, height, max_depth;
+    double viewport_width, viewport_height, focus_dist;
+
+    path_sampler s;
+    ray_sorter sorter;
+    path_batch batch, next;
+    std::vector<uint64_t> keys;
+    std::vector<double> t_max;
+    std::vector<hit_record> recs;
+
+    ray camera_ray(int i, int j) {
+        auto offset = s.get_2d();
+        auto u = (i + offset.x()) / width - 0.5;
+        auto v = 0.5 - (j + offset.y()) / height;
+        return ray(point3(0,0,0), vec3(u * viewport_width, v * viewport_height, -focus_dist));
+    }
+
+    void reorder() {
+        // Sorts the batch by ray_sort_key, moving the paths themselves so traversal reads the
+        // rays in order.
+        keys.resize(batch.size());
+        for (size_t k = 0; k < batch.size(); k++)
+            keys[k] = ray_sort_key(batch.rays[k], bounds);
+        const auto& order = sorter.sort(keys);
+
+        next.clear();
+        for (auto k : order)
+            next.add(batch.rays[k], batch.throughput[k], batch.pixels[k]);
+        std::swap(batch, next);
+    }
+
+    void trace(bool grouped) {
+        // Closest hit of every ray in the batch; t_max stays infinite for the ones that miss.
+        auto n = batch.size();
+        t_max.assign(n, infinity);
+        recs.resize(n);
+        const interval ray_t(0.001, infinity);
+
+        if (!grouped) {
+            for (size_t k = 0; k < n; k++)
+                if (world.hit(batch.rays[k], ray_t, recs[k]))
+                    t_max[k] = recs[k].t;
+            return;
+        }
+
+        int active[hittable::max_group];
+        for (size_t first = 0; first < n; first += hittable::max_group) {
+            int count = int(std::min<size_t>(hittable::max_group, n - first));
+            for (int k = 0; k < count; k++)
+                active[k] = k;
+            world.hit_group(&batch.rays[first], active, count, ray_t.min,
+                            &t_max[first], &recs[first]);
+        }
+    }
+
+    void shade(int sample, int depth, std::vector<color>& image) {
+        // Diffuse bounce for the rays that hit; the ones that missed pick up the sky.
+        next.clear();
+        for (size_t k = 0; k < batch.size(); k++) {
+            auto pixel = batch.pixels[k];
+            if (t_max[k] == infinity) {
+                image[pixel] += batch.throughput[k] * sky(batch.rays[k]);
+                continue;
+            }
+
+            s.start_pixel_sample(int(pixel % width), int(pixel / width), sample);
+            s.set_dimension(2 + 2 * depth);
+            ray scattered;
+            color attenuation;
+            if (recs[k].mat->scatter(batch.rays[k], recs[k], attenuation, scattered, s))
+                next.add(scattered, batch.throughput[k] * attenuation, pixel);
+        }
+        std::swap(batch, next);
+    }
+
+    static color sky(const ray& r) {
+        // The gradient of camera::background().
+        auto a = 0.5*(unit_vector(r.direction()).y() + 1.0);
+        return (1.0-a)*color(0.2, 0.3, 0.5) + a*color(0.6, 0.8, 1.0);
+    }
+};
+
+
+int main(int argc, char** argv) {
+    int count = (argc > 1) ? std::atoi(argv[1]) : 1000000;
+    int width = (argc > 2) ? std::atoi(argv[2]) : 160;
+    int spp   = (argc > 3) ? std::atoi(argv[3]) : 2;
+
+    arena scene_memory(size_t(16) << 20);
+    hittable_list world;
+    light_bvh lights;
+    camera cam;
+    seed_random(1);
+    many_spheres(world, lights, cam, &scene_memory, count);
+
+    int height = std::max(1, int(width / cam.aspect_ratio));
+    wavefront_tracer tracer(world, cam, width, height, cam.max_depth);
+    cache_counters counters;
+
+    struct configuration { const char* name; bool sort, grouped; };
+    const configuration configurations[] = {
+        { "path order, per ray", false, false },
+        { "path order, grouped", false, true },
+        { "sorted, per ray",     true,  false },
+        { "sorted, grouped",     true,  true },
+    };
+
+    std::printf("%d spheres, %dx%d at %d spp, depth %d\n\n", count, width, height, spp, cam.max_depth);
+    std::printf("%-20s %14s %18s %11s %12s %12s %13s %13s %11s\n", "", "camera Mrays/s",
+                "secondary Mrays/s", "incl. sort", "speedup", "sort ns/ray", "L1D miss/ray",
+                "LLC miss/ray", "LLC miss %");
+
+    std::vector<color> reference;
+    double baseline = 0;
+    bool same = true;
+    for (const auto& config : configurations) {
+        // An untimed run first, so every configuration starts with the same warm caches.
+        tracer.render(spp, config.sort, config.grouped, counters);
+        auto result = tracer.render(spp, config.sort, config.grouped, counters);
+
+        // Speedup is for secondary rays including the sort, against the first configuration.
+        auto secondary = double(result.secondary_rays);
+        auto with_sort = secondary / (result.secondary_seconds + result.sort_seconds) / 1e6;
+        if (baseline == 0)
+            baseline = with_sort;
+        std::printf("%-20s %14.3f %18.3f %11.3f %11.2fx %12.1f", config.name,
+                    result.primary_rays / result.primary_seconds / 1e6,
+                    secondary / result.secondary_seconds / 1e6, with_sort, with_sort / baseline,
+                    result.sort_seconds / secondary * 1e9);
+        if (counters.available())
+            std::printf(" %13.2f %13.2f %10.1f%%\n", result.counters[2] / secondary,
+                        result.counters[1] / secondary,
+                        result.counters[0] ? 100.0 * result.counters[1] / result.counters[0] : 0.0);
+        else
+            std::printf(" %13s %13s %11s\n", "n/a", "n/a", "n/a");
+
+        if (reference.empty())
+            reference = result.image;
+        for (size_t i = 0; same && i < reference.size(); i++)
+            for (int c = 0; c < 3; c++)
+                same = same && reference[i][c] == result.image[i][c];
+    }
+
+    if (!counters.available())
+        std::printf("\nno hardware cache counters here (perf_event_open failed)\n");
+    std::printf("\nimages %s\n", same ? "identical" : "DIFFER");
+    return same ? 0 : 1;
+}
@@ -12,18 +12,37 @@
 //==============================================================================================
 
 #include "hittable.h"
+#include "onb.h"
 
 
-class sphere : public hittable {
+template <typename P>
+class basic_sphere : public basic_hittable<P> {
   public:
-    sphere(const point3& center, double radius, shared_ptr<material> mat)
-      : center(center), radius(std::fmax(0,radius)), mat(mat) {}
+    using real = typename P::real;
+    using robust = typename P::robust;
+    using vec = basic_vec3<real>;
+    using ray = basic_ray<real>;
+    using interval = basic_interval<real>;
+    using aabb = basic_aabb<real>;
+    using hit_record = basic_hit_record<P>;
+
+    basic_sphere(const point3& center, double radius, shared_ptr<basic_material<P>> mat)
+      : center(center), radius(real(std::fmax(0,radius))), mat(mat)
+    {
+        auto rvec = vec(real(radius), real(radius), real(radius));
+        bbox = aabb(this->center - rvec, this->center + rvec);
+    }
 
     bool hit(const ray& r, interval ray_t, hit_record& rec) const override {
-        vec3 oc = center - r.origin();
-        auto a = r.direction().length_squared();
-        auto h = dot(r.direction(), oc);
-        auto c = oc.length_squared() - radius*radius;
+        // The quadratic is solved in robust precision: for a large sphere c is the small
+        // difference of two large numbers, and in float the roots would wander by more than
+        // the self-intersection epsilon.
+        using wide = basic_vec3<robust>;
+        wide oc = wide(center) - wide(r.origin());
+        wide direction(r.direction());
+        auto a = direction.length_squared();
+        auto h = dot(direction, oc);
+        auto c = oc.length_squared() - robust(radius)*radius;
 
         auto discriminant = h*h - a*c;
         if (discriminant < 0)
@@ -32,27 +51,67 @@ class sphere : public hittable {
         auto sqrtd = std::sqrt(discriminant);
 
         // Find the nearest root that lies in the acceptable range.
-        auto root = (h - sqrtd) / a;
+        auto root = real((h - sqrtd) / a);
         if (!ray_t.surrounds(root)) {
-            root = (h + sqrtd) / a;
+            root = real((h + sqrtd) / a);
             if (!ray_t.surrounds(root))
                 return false;
         }
 
         rec.t = root;
         rec.p = r.at(rec.t);
-        vec3 outward_normal = (rec.p - center) / radius;
+        vec outward_normal = (rec.p - center) / radius;
         rec.set_face_normal(r, outward_normal);
-        rec.mat = mat;
+        rec.mat = mat.get();
+        rec.object = this;
 
         return true;
     }
 
+    aabb bounding_box() const override { return bbox; }
+
+    real pdf_value(const vec& origin, const vec& direction) const override {
+        // Solid angle density of random(origin); zero for directions that miss the sphere.
+        hit_record rec;
+        if (!this->hit(ray(origin, direction), interval(0.001, infinity), rec))
+            return 0;
+
+        // 1 - cos_theta_max is tiny for small, distant lights, so it is kept in robust.
+        auto dist_squared = (basic_vec3<robust>(center) - basic_vec3<robust>(origin)).length_squared();
+        auto cos_theta_max = std::sqrt(1 - robust(radius)*radius/dist_squared);
+        auto solid_angle = 2*pi*(1-cos_theta_max);
+
+        return real(1 / solid_angle);
+    }
+
+    vec random(const vec& origin, sampler& s) const override {
+        // Uniformly samples the cone of directions from origin that hit the sphere.
+        vec direction = center - origin;
+        auto distance_squared = (basic_vec3<robust>(center) - basic_vec3<robust>(origin)).length_squared();
+        basic_onb<real> uvw(direction);
+        return uvw.transform(vec(random_to_sphere(radius, distance_squared, s.get_2d())));
+    }
+
   private:
-    point3 center;
-    double radius;
-    shared_ptr<material> mat;
+    vec center;
+    real radius;
+    shared_ptr<basic_material<P>> mat;
+    aabb bbox;
+
+    static basic_vec3<robust> random_to_sphere(robust radius, robust distance_squared, const vec3& u) {
+        auto r1 = robust(u.x());
+        auto r2 = robust(u.y());
+        auto z = 1 + r2*(std::sqrt(1-radius*radius/distance_squared) - 1);
+
+        auto phi = 2*robust(pi)*r1;
+        auto x = std::cos(phi) * std::sqrt(1-z*z);
+        auto y = std::sin(phi) * std::sqrt(1-z*z);
+
+        return basic_vec3<robust>(x, y, z);
+    }
 };
 
+using sphere = basic_sphere<double_precision>;
+
 
 #endif
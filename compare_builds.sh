@@ -0,0 +1,55 @@
+#!/bin/bash
+# Builds every configuration of the top-level Makefile and times the standard
+# scenes with each: best of REPEATS runs, in seconds, and the speedup over the
+# first configuration (portable: baseline x86-64, no dispatch, no LTO). The
+# programs of each configuration are copied aside and the runs go round the
+# configurations in turn, so a machine that speeds up or slows down affects
+# them all alike.
+#
+#   ./compare_builds.sh [repeats] [configs...]
+
+cd "$(dirname "$0")"
+REPEATS=${1:-5}
+shift
+CONFIGS=(${@:-portable release native lto pgo})
+STAGE=${TMPDIR:-/tmp}/compare_builds
+
+mapfile -t SCENES < <(make -s scenes)
+
+rm -rf "$STAGE"
+for config in "${CONFIGS[@]}"; do
+    if [ "$config" = pgo ]; then
+        make pgo > /dev/null 2>&1 || { echo "make pgo failed"; exit 1; }
+    else
+        make CONFIG=$config -j"$(nproc)" > /dev/null 2>&1 || { echo "make CONFIG=$config failed"; exit 1; }
+    fi
+    mkdir -p "$STAGE/$config"
+    cp -r src benchmark cuda_src "$STAGE/$config/"
+done
+
+# Nanoseconds taken by one run of scene $2 with configuration $1
+run_time() {
+    local start=$(date +%s%N)
+    (cd "$STAGE/$1" && sh -c "$2" > /dev/null 2>&1)
+    echo $(($(date +%s%N) - start))
+}
+
+declare -A best
+for ((r = 0; r < REPEATS; r++)); do
+    for scene in "${SCENES[@]}"; do
+        for config in "${CONFIGS[@]}"; do
+            t=$(run_time "$config" "$scene")
+            key="$config|$scene"
+            if [ -z "${best[$key]}" ] || [ "$t" -lt "${best[$key]}" ]; then best[$key]=$t; fi
+        done
+    done
+done
+
+for config in "${CONFIGS[@]}"; do
+    echo "$config"
+    for scene in "${SCENES[@]}"; do
+        awk -v s="$scene" -v t="${best[$config|$scene]}" -v b="${best[${CONFIGS[0]}|$scene]}" \
+            'BEGIN { printf "  %-46s %8.3f s  %5.2fx\n", s, t / 1e9, b / t }'
+    done
+done
+rm -rf "$STAGE"
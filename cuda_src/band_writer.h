@@ -0,0 +1,124 @@
+#ifndef BAND_WRITERH
+#define BAND_WRITERH
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+#include "vec3.h"
+
+// Streams a P6 image to disk in bands of rows while the GPU renders the next
+// band. The host owns `slots` band buffers: the render loop fills a free slot
+// and pushes its index through a single-producer single-consumer ring, and a
+// writer thread converts that band to bytes, fwrites it and hands the slot
+// back. Host memory stays at slots * band_rows rows however tall the image is.
+//
+// Bands go top row first, so band b holds image rows j = ny-1-b*band_rows
+// downwards, matching the old whole-frame writer.
+class band_writer {
+    public:
+        band_writer(const char *path, int nx, int ny, int band_rows, int slots)
+            : nx(nx), ny(ny), band_rows(band_rows), slots(slots),
+              buffers(slots), ready(slots + 1), head(0), tail(0), free_count(slots), closing(false), failed(false),
+              busy_seconds(0.0), bytes((size_t)band_rows * nx * 3) {
+            out = std::fopen(path, "wb");
+            if (!out) return;
+            std::fprintf(out, "P6\n%d %d\n255\n", nx, ny);
+            for (int s = 0; s < slots; s++)
+                buffers[s].resize((size_t)band_rows * nx);
+            worker = std::thread(&band_writer::run, this);
+        }
+
+        ~band_writer() { finish(); }
+
+        bool is_open() const { return out != nullptr; }
+        int band_count() const { return (ny + band_rows - 1) / band_rows; }
+
+        // Rows of band b, top row first: image rows [j_lo, j_hi) with j_hi - 1 written first
+        void band_rows_of(int b, int &j_lo, int &j_hi) const {
+            j_hi = ny - b * band_rows;
+            j_lo = j_hi - band_rows < 0 ? 0 : j_hi - band_rows;
+        }
+
+        // Waits for a free slot and returns its buffer, rows stored bottom to top like fb
+        vec3 *acquire(int &slot) {
+            while (free_count.load(std::memory_order_acquire) == 0)
+                std::this_thread::yield();
+            free_count.fetch_sub(1, std::memory_order_acq_rel);
+            slot = next_slot;
+            next_slot = (next_slot + 1) % slots;
+            return buffers[slot].data();
+        }
+
+        // Queues the slot holding band b for writing
+        void submit(int slot, int b) {
+            size_t h = head.load(std::memory_order_relaxed);
+            ready[h % ready.size()] = entry{slot, b};
+            head.store(h + 1, std::memory_order_release);
+        }
+
+        bool finish() {
+            if (!out) return false;
+            closing.store(true, std::memory_order_release);
+            worker.join();
+            bool ok = !failed && std::fclose(out) == 0;
+            out = nullptr;
+            return ok;
+        }
+
+        double writer_busy_seconds() const { return busy_seconds; }
+
+    private:
+        struct entry { int slot, band; };
+
+        void run() {
+            while (true) {
+                size_t t = tail.load(std::memory_order_relaxed);
+                if (t == head.load(std::memory_order_acquire)) {
+                    if (closing.load(std::memory_order_acquire) && t == head.load(std::memory_order_acquire))
+                        return;
+                    std::this_thread::sleep_for(std::chrono::microseconds(500));
+                    continue;
+                }
+                entry e = ready[t % ready.size()];
+                tail.store(t + 1, std::memory_order_release);
+
+                auto start = std::chrono::steady_clock::now();
+                write_band(buffers[e.slot].data(), e.band);
+                busy_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                free_count.fetch_add(1, std::memory_order_acq_rel);
+            }
+        }
+
+        void write_band(const vec3 *band, int b) {
+            int j_lo, j_hi;
+            band_rows_of(b, j_lo, j_hi);
+            size_t n = 0;
+            for (int j = j_hi - 1; j >= j_lo; j--) {
+                const vec3 *row = band + (size_t)(j - j_lo) * nx;
+                for (int i = 0; i < nx; i++) {
+                    bytes[n++] = (unsigned char)(255.99 * row[i].r());
+                    bytes[n++] = (unsigned char)(255.99 * row[i].g());
+                    bytes[n++] = (unsigned char)(255.99 * row[i].b());
+                }
+            }
+            if (std::fwrite(bytes.data(), 1, n, out) != n)
+                failed = true;
+        }
+
+        int nx, ny, band_rows, slots;
+        int next_slot = 0;
+        std::vector<std::vector<vec3>> buffers;
+        std::vector<entry> ready;              // ring of filled slots, one spare entry
+        std::atomic<size_t> head, tail;
+        std::atomic<int> free_count;
+        std::atomic<bool> closing;
+        bool failed;
+        double busy_seconds;
+        std::vector<unsigned char> bytes;      // one band converted to P6 bytes
+        std::FILE *out = nullptr;
+        std::thread worker;
+};
+
+#endif
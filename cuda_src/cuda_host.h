@@ -0,0 +1,97 @@
+#ifndef CUDA_HOSTH
+#define CUDA_HOSTH
+
+// Lets the kernels build with a plain C++ compiler, so they can be run,
+// profiled and trained on machines without a GPU. Under nvcc this only
+// defines KERNEL_LAUNCH. Elsewhere __host__ and __device__ go away, device
+// memory is host memory, and a launch runs the blocks of the grid on host
+// threads, the threads of each block one after another. Kernels must not use
+// shared memory or __syncthreads().
+//
+// Each __global__ kernel is compiled once per x86-64 level (SSE4.2, AVX2 +
+// FMA, AVX-512) and the loader picks the copy for the CPU, the same as the hot
+// loops of the CPU renderer. Define NO_MULTIVERSION for a fixed-target build.
+
+#ifdef __CUDACC__
+
+#define KERNEL_LAUNCH(kernel, grid, block, ...) kernel<<<grid, block>>>(__VA_ARGS__)
+
+#else
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) && !defined(NO_MULTIVERSION)
+#define __global__ __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#else
+#define __global__
+#endif
+#define __device__
+#define __host__
+
+struct uint3 {
+    unsigned int x, y, z;
+};
+
+struct dim3 {
+    unsigned int x, y, z;
+    dim3(unsigned int x = 1, unsigned int y = 1, unsigned int z = 1) : x(x), y(y), z(z) {}
+};
+
+// Set for the kernel call running on this host thread
+inline thread_local uint3 threadIdx, blockIdx;
+inline thread_local dim3 blockDim, gridDim;
+
+enum cudaError_t { cudaSuccess = 0, cudaErrorMemoryAllocation = 2 };
+enum cudaMemcpyKind { cudaMemcpyHostToHost, cudaMemcpyHostToDevice, cudaMemcpyDeviceToHost, cudaMemcpyDeviceToDevice };
+
+inline cudaError_t cudaMalloc(void **ptr, size_t size) {
+    *ptr = std::malloc(size);
+    return *ptr ? cudaSuccess : cudaErrorMemoryAllocation;
+}
+inline cudaError_t cudaFree(void *ptr) { std::free(ptr); return cudaSuccess; }
+inline cudaError_t cudaMemcpy(void *dst, const void *src, size_t size, cudaMemcpyKind) {
+    std::memcpy(dst, src, size);
+    return cudaSuccess;
+}
+inline cudaError_t cudaGetLastError() { return cudaSuccess; }
+inline cudaError_t cudaDeviceSynchronize() { return cudaSuccess; }
+inline cudaError_t cudaDeviceReset() { return cudaSuccess; }
+
+// Runs the whole grid before returning; host threads take blocks in order
+template <typename... Params, typename... Args>
+void host_launch(void (*kernel)(Params...), dim3 grid, dim3 block, Args... args) {
+    size_t blocks = (size_t)grid.x * grid.y * grid.z;
+    std::atomic<size_t> next(0);
+    auto work = [&]() {
+        gridDim = grid;
+        blockDim = block;
+        for (size_t b = next++; b < blocks; b = next++) {
+            blockIdx = uint3{(unsigned int)(b % grid.x), (unsigned int)(b / grid.x % grid.y),
+                             (unsigned int)(b / grid.x / grid.y)};
+            for (unsigned int z = 0; z < block.z; z++)
+                for (unsigned int y = 0; y < block.y; y++)
+                    for (unsigned int x = 0; x < block.x; x++) {
+                        threadIdx = uint3{x, y, z};
+                        kernel(args...);
+                    }
+        }
+    };
+    size_t threads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), blocks);
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < threads; t++)
+        pool.emplace_back(work);
+    work();
+    for (std::thread &t : pool)
+        t.join();
+}
+
+#define KERNEL_LAUNCH(kernel, grid, block, ...) host_launch(kernel, grid, block, __VA_ARGS__)
+
+#endif
+
+#endif
@@ -12,6 +12,7 @@ struct hit_record
 
 class hitable  {
     public:
+        __device__ virtual ~hitable() {}
         __device__ virtual bool hit(const ray& r, float t_min, float t_max, hit_record& rec) const = 0;
 };
 
@@ -3,15 +3,21 @@
 #include <float.h>
 #include <curand_kernel.h>
 #include <vector>
+#include <chrono>
 #include "vec3.h"
 #include "ray.h"
 #include "sphere.h"
 #include "hitable_list.h"
+#include "band_writer.h"
 #include "camera.h"
+#include "sampler.h"
 
 #define IMAGEX 800
 #define IMAGEY 600
 #define FOV 90
+#define BAND_ROWS 64   // rows rendered per kernel launch and written per fwrite
+#define BAND_SLOTS 3   // host band buffers shared with the writer thread
+#define SOBOL_JITTER 1 // 0 falls back to independent curand_uniform jitter
 
 __device__ vec3 color(const ray& ray, hitable **obj){
     hit_record rec;
@@ -43,20 +49,28 @@ __global__ void render_init(int max_x, int max_y, curandState *rand_state) {
     curand_init(2000, pixel_index, 0, &rand_state[pixel_index]);
 }
 
-__global__ void render(vec3 *fb, int max_x, int max_y, int ns, camera **cam, hitable **world, curandState *rand_state) {
+// Renders image rows [j0, j1) into band, which holds just those rows
+__global__ void render(vec3 *band, int max_x, int max_y, int j0, int j1, int ns, camera **cam, hitable **world, curandState *rand_state) {
     int i = threadIdx.x + blockIdx.x * blockDim.x;
-    int j = threadIdx.y + blockIdx.y * blockDim.y;
-    if((i >= max_x) || (j >= max_y)) return;
+    int j = j0 + threadIdx.y + blockIdx.y * blockDim.y;
+    if((i >= max_x) || (j >= j1)) return;
     int pixel_index = j*max_x + i;
     curandState local_rand_state = rand_state[pixel_index];
     vec3 col(0,0,0);
     for(int s=0; s < ns; s++) {
-        float u = float(i + curand_uniform(&local_rand_state)) / float(max_x);
-        float v = float(j + curand_uniform(&local_rand_state)) / float(max_y);
+#if SOBOL_JITTER
+        float jx, jy;
+        sobol_jitter(pixel_index, s, jx, jy);
+#else
+        float jx = curand_uniform(&local_rand_state);
+        float jy = curand_uniform(&local_rand_state);
+#endif
+        float u = float(i + jx) / float(max_x);
+        float v = float(j + jy) / float(max_y);
         ray r = (*cam)->get_ray(u,v);
         col += color(r, world);
     }
-    fb[pixel_index] = col/float(ns);
+    band[(j-j0)*max_x + i] = col/float(ns);
 }
 
 __global__ void create_world(hitable **d_list, hitable **d_world, camera **d_camera) {
@@ -94,11 +108,10 @@ int main(int argc, char **argv) {
     std::cerr << "in " << tx << "x" << ty << " blocks.\n";
 
     int num_pixels = nx*ny;
-    size_t fb_size = num_pixels*sizeof(vec3);
 
-    // allocate everything
-    vec3 *fb;
-    cudaMallocManaged((void **)&fb, fb_size);
+    // allocate everything; only one band of the frame lives on the device
+    vec3 *d_band;
+    cudaMalloc((void **)&d_band, BAND_ROWS*nx*sizeof(vec3));
 
     curandState *d_rand_state;
     cudaMalloc((void **)&d_rand_state, num_pixels*sizeof(curandState));
@@ -117,44 +130,44 @@ int main(int argc, char **argv) {
     create_world<<<1,1>>>(d_list,d_world,d_camera);
     cudaDeviceSynchronize();
 
+    // Bands are rendered top to bottom; while the GPU works on one band the
+    // writer thread converts and writes the previous one
+    band_writer writer("output1.ppm", nx, ny, BAND_ROWS, BAND_SLOTS);
+    if (!writer.is_open()){
+        std::cerr << "Failed to open output1.ppm for writing" << std::endl;
+        return 1;
+    }
+
+    auto wall_start = std::chrono::steady_clock::now();
     clock_t start, stop;
     start = clock();
-    // Render our buffer
     dim3 blocks(nx/tx+1,ny/ty+1);
     dim3 threads(tx,ty);
-
+    dim3 band_blocks(nx/tx+1,BAND_ROWS/ty+1);
     render_init<<<blocks, threads>>>(nx, ny, d_rand_state);
     cudaDeviceSynchronize();
-    render<<<blocks, threads>>>(fb, nx, ny,  ns, d_camera, d_world, d_rand_state);
-    cudaDeviceSynchronize();
-
-    stop = clock();
-    double timer_seconds = ((double)(stop - start)) / CLOCKS_PER_SEC;
-    std::cerr << "took " << timer_seconds << " seconds.\n";
-
-    // Convert vec3 framebuffer to unsigned char array for PPM
-    std::vector<unsigned char> pixels(nx * ny * 3);
-    for (int j = ny-1; j >= 0; j--) {
-        for (int i = 0; i < nx; i++) {
-            size_t pixel_index = j*nx + i;
-            int write_index = ((ny-1-j)*nx + i) * 3;
-            
-            vec3 col = fb[pixel_index];
-            pixels[write_index + 0] = (unsigned char)(255.99 * col.r());
-            pixels[write_index + 1] = (unsigned char)(255.99 * col.g());
-            pixels[write_index + 2] = (unsigned char)(255.99 * col.b());
-        }
+    double render_seconds = 0.0;
+    for (int b = 0; b < writer.band_count(); b++) {
+        int j0, j1;
+        writer.band_rows_of(b, j0, j1);
+        auto band_start = std::chrono::steady_clock::now();
+        render<<<band_blocks, threads>>>(d_band, nx, ny, j0, j1, ns, d_camera, d_world, d_rand_state);
+        int slot;
+        vec3 *host_band = writer.acquire(slot);
+        cudaMemcpy(host_band, d_band, (j1-j0)*nx*sizeof(vec3), cudaMemcpyDeviceToHost);
+        render_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - band_start).count();
+        writer.submit(slot, b);
     }
-
-    // Write PPM
-    std::FILE *out = std::fopen("output1.ppm", "wb");
-    if (!out){
-        std::cerr << "Failed to open output1.ppm for writing" << std::endl;
+    stop = clock();
+    if (!writer.finish()){
+        std::cerr << "Failed to write output1.ppm" << std::endl;
         return 1;
     }
-    std::fprintf(out, "P6\n%d %d\n255\n", nx, ny);
-    std::fwrite(pixels.data(), 1, pixels.size(), out);
-    std::fclose(out);
+    double timer_seconds = ((double)(stop - start)) / CLOCKS_PER_SEC;
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    std::cerr << "took " << timer_seconds << " seconds.\n";
+    std::cerr << "wall clock " << wall_seconds << " s: " << render_seconds << " s rendering bands, "
+              << writer.writer_busy_seconds() << " s converting and writing behind them.\n";
 
     std::cout << "Wrote output1.ppm (" << nx << "x" << ny << ")" << std::endl;
 
@@ -167,7 +180,7 @@ int main(int argc, char **argv) {
     cudaFree(d_world);
     cudaFree(d_camera);
     cudaFree(d_rand_state);
-    cudaFree(fb);
+    cudaFree(d_band);
 
     cudaDeviceReset();
 }
\ No newline at end of file
@@ -2,10 +2,22 @@
 #include <time.h>
 #include <float.h>
 #include <vector>
+#include <chrono>
+#include "cuda_host.h"
 #include "vec3.h"
 #include "ray.h"
 #include "sphere.h"
 #include "hitable_list.h"
+#include "band_writer.h"
+
+#define BAND_ROWS 64   // rows rendered per kernel launch and written per fwrite
+#define BAND_SLOTS 3   // host band buffers shared with the writer thread
+
+#ifdef __CUDACC__
+#define OUTPUT_PATH "output1.ppm"
+#else
+#define OUTPUT_PATH "output_host.ppm"   // the host build leaves the GPU render alone
+#endif
 
 
 __device__ vec3 color(const ray& ray, hitable **obj){
@@ -29,17 +41,17 @@ __device__ vec3 color(const ray& ray, hitable **obj){
     }
 }
 
-__global__ void render(vec3 *fb, int max_x, int max_y,
+// Renders image rows [j0, j1) into band, which holds just those rows
+__global__ void render(vec3 *band, int max_x, int max_y, int j0, int j1,
                        vec3 lower_left_corner, vec3 horizontal, vec3 vertical, vec3 origin,
                        hitable **world) {
     int i = threadIdx.x + blockIdx.x * blockDim.x;
-    int j = threadIdx.y + blockIdx.y * blockDim.y;
-    if((i >= max_x) || (j >= max_y)) return;
-    int pixel_index = j*max_x + i;
+    int j = j0 + threadIdx.y + blockIdx.y * blockDim.y;
+    if((i >= max_x) || (j >= j1)) return;
     float u = float(i) / float(max_x);
     float v = float(j) / float(max_y);
     ray r(origin, lower_left_corner + u*horizontal + v*vertical);
-    fb[pixel_index] = color(r, world);
+    band[(j-j0)*max_x + i] = color(r, world);
 }
 
 __global__ void create_world(hitable **d_list, hitable **d_world) {
@@ -63,72 +75,70 @@ int main() {
     std::cerr << "Rendering a " << nx << "x" << ny << " image ";
     std::cerr << "in " << tx << "x" << ty << " blocks.\n";
 
-    int num_pixels = nx*ny;
-    size_t fb_size = num_pixels*sizeof(vec3);
-
-    // allocate FB
-    vec3 *fb;
-    cudaMallocManaged((void **)&fb, fb_size);
+    // allocate one band of the frame on the device
+    vec3 *d_band;
+    cudaMalloc((void **)&d_band, BAND_ROWS*nx*sizeof(vec3));
 
     // make our world of hitables
     hitable **d_list;
     cudaMalloc((void **)&d_list, 1*sizeof(hitable *));
     hitable **d_world;
     cudaMalloc((void **)&d_world, sizeof(hitable *));
-    create_world<<<1,1>>>(d_list,d_world);
+    KERNEL_LAUNCH(create_world, 1, 1, d_list, d_world);
     cudaGetLastError();
     cudaDeviceSynchronize();
 
+    // Bands are rendered top to bottom; while the GPU works on one band the
+    // writer thread converts and writes the previous one
+    band_writer writer(OUTPUT_PATH, nx, ny, BAND_ROWS, BAND_SLOTS);
+    if (!writer.is_open()){
+        std::cerr << "Failed to open " OUTPUT_PATH " for writing" << std::endl;
+        return 1;
+    }
+
+    auto wall_start = std::chrono::steady_clock::now();
     clock_t start, stop;
     start = clock();
-    // Render our buffer
-    dim3 blocks(nx/tx+1,ny/ty+1);
     dim3 threads(tx,ty);
-    render<<<blocks, threads>>>(fb, nx, ny,
-                                vec3(-2.0, -1.0, -1.0),
-                                vec3(4.0, 0.0, 0.0),
-                                vec3(0.0, 2.0, 0.0),
-                                vec3(0.0, 0.0, 0.0),
-                                d_world);
-    cudaGetLastError();
-    cudaDeviceSynchronize();
-    stop = clock();
-    double timer_seconds = ((double)(stop - start)) / CLOCKS_PER_SEC;
-    std::cerr << "took " << timer_seconds << " seconds.\n";
-
-    // Convert vec3 framebuffer to unsigned char array for PPM
-    std::vector<unsigned char> pixels(nx * ny * 3);
-    for (int j = ny-1; j >= 0; j--) {
-        for (int i = 0; i < nx; i++) {
-            size_t pixel_index = j*nx + i;
-            int write_index = ((ny-1-j)*nx + i) * 3;
-            
-            vec3 col = fb[pixel_index];
-            pixels[write_index + 0] = (unsigned char)(255.99 * col.r());
-            pixels[write_index + 1] = (unsigned char)(255.99 * col.g());
-            pixels[write_index + 2] = (unsigned char)(255.99 * col.b());
-        }
+    dim3 band_blocks(nx/tx+1,BAND_ROWS/ty+1);
+    double render_seconds = 0.0;
+    for (int b = 0; b < writer.band_count(); b++) {
+        int j0, j1;
+        writer.band_rows_of(b, j0, j1);
+        auto band_start = std::chrono::steady_clock::now();
+        KERNEL_LAUNCH(render, band_blocks, threads, d_band, nx, ny, j0, j1,
+                      vec3(-2.0, -1.0, -1.0),
+                      vec3(4.0, 0.0, 0.0),
+                      vec3(0.0, 2.0, 0.0),
+                      vec3(0.0, 0.0, 0.0),
+                      d_world);
+        cudaGetLastError();
+        int slot;
+        vec3 *host_band = writer.acquire(slot);
+        cudaMemcpy(host_band, d_band, (j1-j0)*nx*sizeof(vec3), cudaMemcpyDeviceToHost);
+        render_seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - band_start).count();
+        writer.submit(slot, b);
     }
-
-    // Write PPM
-    std::FILE *out = std::fopen("output1.ppm", "wb");
-    if (!out){
-        std::cerr << "Failed to open output1.ppm for writing" << std::endl;
+    stop = clock();
+    if (!writer.finish()){
+        std::cerr << "Failed to write " OUTPUT_PATH << std::endl;
         return 1;
     }
-    std::fprintf(out, "P6\n%d %d\n255\n", nx, ny);
-    std::fwrite(pixels.data(), 1, pixels.size(), out);
-    std::fclose(out);
+    double timer_seconds = ((double)(stop - start)) / CLOCKS_PER_SEC;
+    double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - wall_start).count();
+    std::cerr << "took " << timer_seconds << " seconds.\n";
+    std::cerr << "wall clock " << wall_seconds << " s: " << render_seconds << " s rendering bands, "
+              << writer.writer_busy_seconds() << " s converting and writing behind them.\n";
 
-    std::cout << "Wrote output1.ppm (" << nx << "x" << ny << ")" << std::endl;
+    std::cout << "Wrote " OUTPUT_PATH " (" << nx << "x" << ny << ")" << std::endl;
 
     // clean up
     cudaDeviceSynchronize();
-    free_world<<<1,1>>>(d_list,d_world);
+    KERNEL_LAUNCH(free_world, 1, 1, d_list, d_world);
     cudaGetLastError();
     cudaFree(d_list);
     cudaFree(d_world);
-    cudaFree(fb);
+    cudaFree(d_band);
 
     // useful for cuda-memcheck --leak-check full
     cudaDeviceReset();
@@ -0,0 +1,64 @@
+#ifndef SAMPLERH
+#define SAMPLERH
+
+// Owen-scrambled Sobol pixel jitter, the device side of benchmark/sampler.h.
+// Every pixel gets its own scrambled and shuffled copy of the first two Sobol
+// dimensions, so its ns samples are stratified instead of independent.
+
+__host__ __device__ inline unsigned int reverse_bits32(unsigned int x) {
+#ifdef __CUDA_ARCH__
+    return __brev(x);
+#else
+    x = (x << 16) | (x >> 16);
+    x = ((x & 0x00ff00ffu) << 8) | ((x & 0xff00ff00u) >> 8);
+    x = ((x & 0x0f0f0f0fu) << 4) | ((x & 0xf0f0f0f0u) >> 4);
+    x = ((x & 0x33333333u) << 2) | ((x & 0xccccccccu) >> 2);
+    x = ((x & 0x55555555u) << 1) | ((x & 0xaaaaaaaau) >> 1);
+    return x;
+#endif
+}
+
+__host__ __device__ inline unsigned int hash32(unsigned int x) {
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+// Burley 2020 hash-based Owen scrambling, applied to the bit-reversed value
+__host__ __device__ inline unsigned int owen_scramble(unsigned int x, unsigned int seed) {
+    x = reverse_bits32(x);
+    x ^= x * 0x3d20adeau;
+    x += seed;
+    x *= (seed >> 16) | 1;
+    x ^= x * 0x05526c56u;
+    x ^= x * 0x53a22864u;
+    return reverse_bits32(x);
+}
+
+// Second Sobol dimension: superset parity of the index bits, then reversed
+__host__ __device__ inline unsigned int sobol_1(unsigned int index) {
+    unsigned int x = index;
+    x ^= (x >> 1) & 0x55555555u;
+    x ^= (x >> 2) & 0x33333333u;
+    x ^= (x >> 4) & 0x0f0f0f0fu;
+    x ^= (x >> 8) & 0x00ff00ffu;
+    x ^= (x >> 16) & 0x0000ffffu;
+    return reverse_bits32(x);
+}
+
+__host__ __device__ inline float to_unit_float(unsigned int x) {
+    return fminf(x * 2.3283064365386963e-10f, 0.99999994f);
+}
+
+// Sample s of pixel pixel_index, as a jitter in [0,1)^2
+__host__ __device__ inline void sobol_jitter(int pixel_index, int s, float &jx, float &jy) {
+    unsigned int seed = hash32(pixel_index * 0x9e3779b9u + 0x632be5abu);
+    unsigned int index = owen_scramble((unsigned int)s, seed);
+    jx = to_unit_float(owen_scramble(reverse_bits32(index), hash32(seed ^ 0x5bd1e995u)));
+    jy = to_unit_float(owen_scramble(sobol_1(index), hash32(seed ^ 0x68e31da4u)));
+}
+
+#endif
@@ -0,0 +1,87 @@
+#include "aov.hpp"
+#include <sstream>
+
+bool parseAovChannels(const std::string &list, unsigned &mask){
+    static const struct { const char *name; unsigned channels; } names[] = {
+        {"depth", AOV_DEPTH}, {"normal", AOV_NORMAL}, {"albedo", AOV_ALBEDO},
+        {"id", AOV_OBJECT_ID}, {"hits", AOV_HIT_COUNT}, {"all", AOV_ALL},
+    };
+    mask = 0;
+    std::istringstream in(list);
+    std::string name;
+    while (std::getline(in, name, ',')) {
+        bool known = false;
+        for (const auto &entry : names)
+            if (name == entry.name) {
+                mask |= entry.channels;
+                known = true;
+            }
+        if (!known)
+            return false;
+    }
+    return true;
+}
+
+AovBuffer::AovBuffer(int width, int height, unsigned mask)
+    : width(width), height(height), mask(mask){
+    size_t n = (size_t)width * height;
+    if (mask & AOV_DEPTH)
+        depth.resize(n);
+    for (int c = 0; c < 3; c++) {
+        if (mask & AOV_NORMAL)
+            normal[c].resize(n);
+        if (mask & AOV_ALBEDO)
+            albedo[c].resize(n);
+    }
+    if (mask & AOV_OBJECT_ID)
+        objectId.resize(n);
+    if (mask & AOV_HIT_COUNT)
+        hitCount.resize(n);
+}
+
+void AovBuffer::storeTile(const Tile &tile, const AovSample *samples){
+    // One pass over the tile per picked channel, each writing contiguous rows of its planes
+    for (int y = 0; y < tile.height; y++) {
+        const AovSample *row = samples + (size_t)y * tile.width;
+        size_t first = (size_t)(tile.y0 + y) * width + tile.x0;
+        if (mask & AOV_DEPTH)
+            for (int x = 0; x < tile.width; x++)
+                depth[first + x] = row[x].depth;
+        if (mask & AOV_NORMAL)
+            for (int c = 0; c < 3; c++)
+                for (int x = 0; x < tile.width; x++)
+                    normal[c][first + x] = row[x].normal[c];
+        if (mask & AOV_ALBEDO)
+            for (int c = 0; c < 3; c++)
+                for (int x = 0; x < tile.width; x++)
+                    albedo[c][first + x] = row[x].albedo[c];
+        if (mask & AOV_OBJECT_ID)
+            for (int x = 0; x < tile.width; x++)
+                objectId[first + x] = (float)row[x].objectId;
+        if (mask & AOV_HIT_COUNT)
+            for (int x = 0; x < tile.width; x++)
+                hitCount[first + x] = (float)row[x].hitCount;
+    }
+}
+
+std::vector<ExrChannel> AovBuffer::exrChannels() const{
+    // Depth and IDs in full float: half has 11 bits, too few for either
+    std::vector<ExrChannel> channels;
+    if (mask & AOV_DEPTH)
+        channels.push_back({"Z", depth.data(), 1, ExrPixelType::Float});
+    if (mask & AOV_NORMAL) {
+        const char *names[3] = {"normal.X", "normal.Y", "normal.Z"};
+        for (int c = 0; c < 3; c++)
+            channels.push_back({names[c], normal[c].data(), 1, ExrPixelType::Half});
+    }
+    if (mask & AOV_ALBEDO) {
+        const char *names[3] = {"albedo.R", "albedo.G", "albedo.B"};
+        for (int c = 0; c < 3; c++)
+            channels.push_back({names[c], albedo[c].data(), 1, ExrPixelType::Half});
+    }
+    if (mask & AOV_OBJECT_ID)
+        channels.push_back({"objectId", objectId.data(), 1, ExrPixelType::Float});
+    if (mask & AOV_HIT_COUNT)
+        channels.push_back({"hitCount", hitCount.data(), 1, ExrPixelType::Half});
+    return channels;
+}
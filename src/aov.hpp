@@ -0,0 +1,68 @@
+#ifndef AOV_HPP
+#define AOV_HPP
+
+#include "glm/glm.hpp"
+#include "hdr_image.hpp"
+#include "renderer.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Arbitrary output variables: passes written next to the colour in the same
+// render, for compositing and debugging. Channels are picked at run time as a
+// mask; a channel that is not picked gets no memory and is never written.
+enum AovChannel : unsigned {
+    AOV_DEPTH = 1u << 0,      // distance from the camera to the first hit, TRACE_DISTANCE on a miss
+    AOV_NORMAL = 1u << 1,     // surface normal at the first hit
+    AOV_ALBEDO = 1u << 2,     // base colour at the first hit, the background on a miss
+    AOV_OBJECT_ID = 1u << 3,  // sphere index + 1 at the first hit, 0 on a miss
+    AOV_HIT_COUNT = 1u << 4   // rays of the pixel that hit a sphere (camera and shadow)
+};
+
+#define AOV_ALL (AOV_DEPTH | AOV_NORMAL | AOV_ALBEDO | AOV_OBJECT_ID | AOV_HIT_COUNT)
+
+// Parses a comma-separated list of channel names (depth, normal, albedo, id,
+// hits, or all) into a mask. Returns false on an unknown name.
+bool parseAovChannels(const std::string &list, unsigned &mask);
+
+// Everything the renderer found for one pixel; the buffer keeps only the
+// picked channels of it
+struct AovSample {
+    float depth;
+    glm::vec3 normal;
+    glm::vec3 albedo;
+    uint32_t objectId;
+    uint32_t hitCount;
+};
+
+// Full-frame passes in structure-of-arrays layout: one float plane per
+// component of every picked channel, so a layer is written to the file as it
+// lies in memory. Tiles can be stored from several threads at once.
+class AovBuffer {
+    private:
+        int width, height;
+        unsigned mask;
+        std::vector<float> depth;
+        std::vector<float> normal[3];
+        std::vector<float> albedo[3];
+        std::vector<float> objectId;
+        std::vector<float> hitCount;
+
+    public:
+        AovBuffer(int width, int height, unsigned mask);
+
+        unsigned getMask() const { return mask; }
+        bool empty() const { return mask == 0; }
+
+        // Copies the picked channels of tile.width * tile.height samples, row by row
+        void storeTile(const Tile &tile, const AovSample *samples);
+
+        // Planes of width * height floats, row by row; empty unless picked
+        const std::vector<float> &getDepth() const { return depth; }
+        const std::vector<float> &getObjectId() const { return objectId; }
+
+        // The planes as EXR channels named by layer (Z, normal.X, albedo.R, ...)
+        std::vector<ExrChannel> exrChannels() const;
+};
+
+#endif // AOV_HPP
@@ -0,0 +1,153 @@
+// Wall-clock cost of writing the image: the old render, then convert, then
+// fwrite sequence against the asynchronous tile pipeline in image_writer.hpp.
+//
+//   make bench && ./bench/async_output [width] [height] [sphereCount] [outputDir]
+
+#include "image_writer.hpp"
+#include "renderer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define FOV 90
+#define TILE_SIZE 32
+#define WINDOW_ROWS 128
+#define REPEATS 3
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Runs work(tileIndex) for every tile on all hardware threads, tiles claimed in order
+template <typename Work>
+static void forEachTile(size_t tileCount, Work work){
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> threads;
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 0; t < threadCount; t++)
+        threads.emplace_back([&](){
+            for (size_t i = next++; i < tileCount; i = next++)
+                work(i);
+        });
+    for (std::thread &t : threads)
+        t.join();
+}
+
+static std::string readFile(const std::string &path){
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+int main(int argc, char **argv){
+    int width = argc > 1 ? std::atoi(argv[1]) : 4000;
+    int height = argc > 2 ? std::atoi(argv[2]) : 3000;
+    int sphereCount = argc > 3 ? std::atoi(argv[3]) : 2000;
+    std::string dir = argc > 4 ? argv[4] : ".";
+    std::string serialPath = dir + "/async_output_serial.ppm";
+    std::string asyncPath = dir + "/async_output_async.ppm";
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> xy(-20.0f, 20.0f), depth(5.0f, 45.0f), radius(0.2f, 0.6f);
+    std::vector<Sphere> spheres;
+    for (int i = 0; i < sphereCount; i++)
+        spheres.push_back(Sphere(glm::vec3(xy(rng), xy(rng), depth(rng)), radius(rng)));
+
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(glm::vec3(0.0f), axis, FOV, (float)width / height);
+    Renderer renderer(cam, spheres, glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)), width, height);
+    std::vector<Tile> tiles = makeTiles(width, height, TILE_SIZE);
+
+    // The two paths alternate so drift in machine load hits both equally
+    double serialRender = 1e30, serialWrite = 1e30, serialTotal = 1e30;
+    size_t serialBytes = 0;
+    double asyncRender = 1e30, asyncTotal = 1e30, asyncBusy = 0.0;
+    size_t asyncBytes = 0;
+    for (int r = 0; r < REPEATS; r++) {
+        // Whole frame in memory, converted and written only after the last tile
+        auto start = std::chrono::steady_clock::now();
+        std::vector<glm::vec3> frame((size_t)width * height);
+        forEachTile(tiles.size(), [&](size_t i){
+            const Tile &tile = tiles[i];
+            std::vector<glm::vec3> pixels((size_t)tile.width * tile.height);
+            renderer.renderTile(tile, pixels.data());
+            for (int y = 0; y < tile.height; y++)
+                std::copy_n(&pixels[(size_t)y * tile.width], tile.width, &frame[(size_t)(tile.y0 + y) * width + tile.x0]);
+        });
+        double renderTime = secondsSince(start);
+
+        auto writeStart = std::chrono::steady_clock::now();
+        std::vector<unsigned char> bytes(frame.size() * 3);
+        for (size_t i = 0; i < frame.size(); i++) {
+            bytes[i * 3 + 0] = toByte(frame[i].r);
+            bytes[i * 3 + 1] = toByte(frame[i].g);
+            bytes[i * 3 + 2] = toByte(frame[i].b);
+        }
+        std::FILE *out = std::fopen(serialPath.c_str(), "wb");
+        if (!out) {
+            std::fprintf(stderr, "cannot open %s\n", serialPath.c_str());
+            return 1;
+        }
+        std::fprintf(out, "P6\n%d %d\n255\n", width, height);
+        std::fwrite(bytes.data(), 1, bytes.size(), out);
+        std::fclose(out);
+
+        serialRender = std::min(serialRender, renderTime);
+        serialWrite = std::min(serialWrite, secondsSince(writeStart));
+        serialTotal = std::min(serialTotal, secondsSince(start));
+        serialBytes = frame.size() * sizeof(glm::vec3) + bytes.size();
+
+        // Tiles streamed to the writer thread as they finish
+        start = std::chrono::steady_clock::now();
+        AsyncImageWriter writer(asyncPath, width, height, std::max(WINDOW_ROWS, TILE_SIZE));
+        if (!writer.isOpen()) {
+            std::fprintf(stderr, "cannot open %s\n", asyncPath.c_str());
+            return 1;
+        }
+        forEachTile(tiles.size(), [&](size_t i){
+            const Tile &tile = tiles[i];
+            writer.waitForRows(tile.y0 + tile.height);
+            auto result = std::make_unique<TileResult>();
+            result->tile = tile;
+            result->pixels.resize((size_t)tile.width * tile.height);
+            renderer.renderTile(tile, result->pixels.data());
+            writer.submit(std::move(result));
+        });
+        renderTime = secondsSince(start);
+        if (!writer.finish()) {
+            std::fprintf(stderr, "writing %s failed\n", asyncPath.c_str());
+            return 1;
+        }
+        double total = secondsSince(start);
+        if (total < asyncTotal) {
+            asyncTotal = total;
+            asyncRender = renderTime;
+            asyncBusy = writer.getBusySeconds();
+        }
+        asyncBytes = writer.windowBytes();
+    }
+
+    std::printf("%dx%d, %d spheres, %zu tiles, %u threads\n", width, height, sphereCount, tiles.size(),
+                std::max(1u, std::thread::hardware_concurrency()));
+    std::printf("serial: %7.3f s total = %.3f s render + %.3f s convert and write, %8.1f MB frame buffers\n",
+                serialTotal, serialRender, serialWrite, serialBytes / 1e6);
+    std::printf("async:  %7.3f s total, render done at %.3f s, writer busy %.3f s, %8.1f MB row window\n",
+                asyncTotal, asyncRender, asyncBusy, asyncBytes / 1e6);
+    std::printf("overlap saved %.3f s (%.1f%%)\n", serialTotal - asyncTotal, 100.0 * (serialTotal - asyncTotal) / serialTotal);
+
+    if (readFile(serialPath) != readFile(asyncPath)) {
+        std::fprintf(stderr, "async output differs from serial output\n");
+        return 1;
+    }
+    std::remove(serialPath.c_str());
+    std::remove(asyncPath.c_str());
+    return 0;
+}
@@ -0,0 +1,158 @@
+// Distributed rendering on loopback: worker processes forked from here, a
+// Coordinator handing them jobs, and the frame checked bit for bit against
+// the same sample split rendered in this process. Runs with healthy workers,
+// with one killed mid-frame, with one stalled (SIGSTOP) mid-frame and with one
+// that stops halfway through its first answer.
+//
+//   make bench && ./bench/distributed [workers] [width] [height] [spp]
+
+#include "coordinator.hpp"
+#include "render_server.hpp"
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define FOV 90
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct LocalWorker { pid_t pid; std::string address; };
+
+// A worker that acknowledges the scene and camera, then sends half of the
+// answer to its first job and nothing more
+static void serveHalfAnswer(int listenFd){
+    int fd = accept(listenFd, nullptr, nullptr);
+    MessageType type;
+    std::vector<unsigned char> payload;
+    RenderDone done{0, 0.0f};
+    while (recvMessage(fd, type, payload)) {
+        if (type != MessageType::Job) {
+            sendMessage(fd, MessageType::Done, &done, sizeof(done));
+            continue;
+        }
+        SampleJob job;
+        std::memcpy(&job, payload.data(), sizeof(job));
+        std::vector<glm::vec3> sums((size_t)job.width * job.height, glm::vec3(0.0f));
+        MessageHeader header{(uint32_t)MessageType::Samples, (uint32_t)(sizeof(job) + sums.size() * sizeof(glm::vec3))};
+        send(fd, &header, sizeof(header), MSG_NOSIGNAL);
+        send(fd, &job, sizeof(job), MSG_NOSIGNAL);
+        send(fd, sums.data(), sums.size() * sizeof(glm::vec3) / 2, MSG_NOSIGNAL);
+        while (true)
+            pause();
+    }
+}
+
+// Each worker listens on a free port, picked before the fork so the parent
+// knows it. With halfAnswer set the last one is serveHalfAnswer().
+static std::vector<LocalWorker> startWorkers(int count, bool halfAnswer = false){
+    std::vector<LocalWorker> workers;
+    for (int i = 0; i < count; i++) {
+        int fd = listenTcp(0);
+        int port = boundPort(fd);
+        pid_t pid = fork();
+        if (pid == 0) {
+            if (halfAnswer && i == count - 1) {
+                serveHalfAnswer(fd);
+                _exit(0);
+            }
+            RenderServer server(fd, 1);
+            server.serve();
+            _exit(0);
+        }
+        close(fd);
+        workers.push_back(LocalWorker{pid, "127.0.0.1:" + std::to_string(port)});
+    }
+    return workers;
+}
+
+static void stopWorkers(const std::vector<LocalWorker> &workers){
+    for (const LocalWorker &w : workers) {
+        kill(w.pid, SIGCONT);
+        kill(w.pid, SIGKILL);
+        waitpid(w.pid, nullptr, 0);
+    }
+}
+
+int main(int argc, char **argv){
+    int workerCount = argc > 1 ? std::max(2, std::atoi(argv[1])) : 3;
+    FrameSettings settings;
+    settings.width = argc > 2 ? std::atoi(argv[2]) : 320;
+    settings.height = argc > 3 ? std::atoi(argv[3]) : 240;
+    settings.samplesPerPixel = argc > 4 ? std::atoi(argv[4]) : 64;
+    settings.samplesPerJob = 8;
+
+    std::vector<Sphere> spheres;
+    spheres.push_back(Sphere(glm::vec3(0.0f, 0.0f, 3.0f), 1.0f));
+    spheres.push_back(Sphere(glm::vec3(2.0f, 0.0f, 4.0f), 1.0f));
+    spheres.push_back(Sphere(glm::vec3(-2.0f, 0.0f, 4.0f), 1.0f));
+    glm::vec3 lightDir = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f));
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    float aspect = (float)settings.width / settings.height;
+    Camera camera(glm::vec3(0.0f), axis, FOV, aspect);
+    CameraState cameraState = makeCameraState(glm::vec3(0.0f), axis, FOV, aspect);
+
+    auto start = std::chrono::steady_clock::now();
+    Renderer renderer(camera, spheres, lightDir, settings.width, settings.height);
+    std::vector<glm::vec3> reference;
+    renderSamplesLocally(renderer, settings, reference);
+    double localSeconds = secondsSince(start);
+    std::printf("%dx%d, %d spp in jobs of %d, %u hardware threads\n", settings.width, settings.height,
+                settings.samplesPerPixel, settings.samplesPerJob, std::thread::hardware_concurrency());
+    std::printf("%-28s %8.3f s\n", "in process", localSeconds);
+
+    // Scenario: what happens to the last worker partway through the frame
+    enum Fault { None, Kill, Stall, HalfAnswer };
+    struct Scenario { const char *name; int workers; Fault fault; } scenarios[] = {
+        {"1 worker", 1, None},
+        {"workers", workerCount, None},
+        {"workers, one killed", workerCount, Kill},
+        {"workers, one stalled", workerCount, Stall},
+        {"workers, one cut off", workerCount, HalfAnswer},
+    };
+    bool allIdentical = true;
+    for (const Scenario &s : scenarios) {
+        std::vector<LocalWorker> workers = startWorkers(s.workers, s.fault == HalfAnswer);
+        std::vector<std::string> addresses;
+        for (const LocalWorker &w : workers)
+            addresses.push_back(w.address);
+        Coordinator coordinator(addresses);
+
+        std::thread fault;
+        if (s.fault == Kill || s.fault == Stall) {
+            pid_t victim = workers.back().pid;
+            double after = localSeconds / 4;
+            fault = std::thread([=](){
+                std::this_thread::sleep_for(std::chrono::duration<double>(after));
+                kill(victim, s.fault == Kill ? SIGKILL : SIGSTOP);
+            });
+        }
+        std::vector<glm::vec3> image;
+        start = std::chrono::steady_clock::now();
+        bool ok = coordinator.render(spheres, lightDir, cameraState, settings, image);
+        double seconds = secondsSince(start);
+        if (fault.joinable())
+            fault.join();
+        stopWorkers(workers);
+
+        bool identical = ok && image.size() == reference.size()
+                         && std::memcmp(image.data(), reference.data(), image.size() * sizeof(glm::vec3)) == 0;
+        allIdentical = allIdentical && identical;
+        std::string name = s.workers > 1 ? std::to_string(s.workers) + " " + s.name : s.name;
+        std::printf("%-28s %8.3f s  %s, %d jobs given out twice\n", name.c_str(), seconds,
+                    !ok ? coordinator.getError().c_str() : identical ? "identical" : "DIFFERENT", coordinator.getReissuedJobs());
+        for (const WorkerStats &w : coordinator.getWorkerStats())
+            std::printf("    %-18s %-5s %5d used %3d wasted %3d lost\n", w.address.c_str(), w.alive ? "up" : "gone",
+                        w.jobsDone, w.jobsWasted, w.jobsLost);
+    }
+    return allIdentical ? 0 : 1;
+}
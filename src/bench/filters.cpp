@@ -0,0 +1,143 @@
+// Reconstruction filters applied by splatting through per-tile buffers and by
+// importance sampling, against the plain box mean of renderTileSamples. For
+// each filter and sample count: milliseconds for the frame (splatting
+// includes the merge of the tile borders) and RMSE against a high sample
+// count render with the same filter, which both approaches converge to.
+// The last table times splatting on 1, 2, 4 ... threads.
+//
+//   make bench && ./bench/filters [width] [height] [referenceSpp]
+
+#include "filter.hpp"
+#include "renderer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <thread>
+#include <vector>
+
+#define FOV 90
+#define TILE_SIZE 32
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double rmse(const std::vector<glm::vec3> &image, const std::vector<glm::vec3> &reference){
+    double sum = 0.0;
+    for (size_t i = 0; i < image.size(); i++) {
+        glm::vec3 d = image[i] - reference[i];
+        sum += glm::dot(d, d) / 3.0;
+    }
+    return std::sqrt(sum / image.size());
+}
+
+static std::vector<glm::vec3> renderBox(const Renderer &renderer, int spp, unsigned threads){
+    int width = renderer.getWidth(), height = renderer.getHeight();
+    std::vector<glm::vec3> image((size_t)width * height);
+    std::vector<Tile> tiles = makeTiles(width, height, TILE_SIZE);
+    forEachTile(tiles.size(), threads, [&](size_t i){
+        const Tile &tile = tiles[i];
+        std::vector<glm::vec3> sums((size_t)tile.width * tile.height);
+        renderer.renderTileSamples(tile, 0, spp, sums.data());
+        for (int y = 0; y < tile.height; y++)
+            for (int x = 0; x < tile.width; x++)
+                image[(size_t)(tile.y0 + y) * width + tile.x0 + x] = sums[(size_t)y * tile.width + x] / (float)spp;
+    });
+    return image;
+}
+
+static std::vector<glm::vec3> renderSplat(const Renderer &renderer, const ReconstructionFilter &filter, int spp,
+                                          unsigned threads){
+    int width = renderer.getWidth(), height = renderer.getHeight();
+    std::vector<Tile> tiles = makeTiles(width, height, TILE_SIZE);
+    SplatImage splat(width, height, TILE_SIZE, tiles, filter.getBorder());
+    forEachTile(tiles.size(), threads, [&](size_t i){
+        renderer.splatTileSamples(tiles[i], 0, spp, filter, splat.buffer(i).pixels.data());
+    });
+    std::vector<glm::vec3> image;
+    splat.resolve(image, threads);
+    return image;
+}
+
+static std::vector<glm::vec3> renderImportance(const Renderer &renderer, const FilterSampler &sampler, int spp,
+                                               unsigned threads){
+    int width = renderer.getWidth(), height = renderer.getHeight();
+    std::vector<glm::vec3> image((size_t)width * height);
+    std::vector<Tile> tiles = makeTiles(width, height, TILE_SIZE);
+    forEachTile(tiles.size(), threads, [&](size_t i){
+        const Tile &tile = tiles[i];
+        std::vector<glm::vec3> sums((size_t)tile.width * tile.height);
+        renderer.renderTileFiltered(tile, 0, spp, sampler, sums.data());
+        for (int y = 0; y < tile.height; y++)
+            for (int x = 0; x < tile.width; x++)
+                image[(size_t)(tile.y0 + y) * width + tile.x0 + x] = sums[(size_t)y * tile.width + x] / (float)spp;
+    });
+    return image;
+}
+
+// Best of three, since the machine may be busy
+template <typename Render>
+static double bestMilliseconds(Render render, std::vector<glm::vec3> &image){
+    double best = 1e30;
+    for (int r = 0; r < 3; r++) {
+        auto start = std::chrono::steady_clock::now();
+        image = render();
+        best = std::min(best, secondsSince(start) * 1000.0);
+    }
+    return best;
+}
+
+int main(int argc, char **argv){
+    int width = argc > 1 ? std::atoi(argv[1]) : 320;
+    int height = argc > 2 ? std::atoi(argv[2]) : 240;
+    int referenceSpp = argc > 3 ? std::atoi(argv[3]) : 256;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(glm::vec3(0.0f), axis, FOV, (float)width / height);
+    std::vector<Sphere> spheres;
+    spheres.push_back(Sphere(glm::vec3(0.0f, 0.0f, 3.0f), 1.0f));
+    spheres.push_back(Sphere(glm::vec3(2.0f, 0.0f, 4.0f), 1.0f));
+    spheres.push_back(Sphere(glm::vec3(-2.0f, 0.0f, 4.0f), 1.0f));
+    Renderer renderer(cam, spheres, glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)), width, height);
+
+    std::printf("%dx%d, %u threads, references at %d spp\n\n", width, height, threads, referenceSpp);
+    std::printf("%-16s %4s %12s %10s %14s %10s\n", "filter", "spp", "splat ms", "rmse", "importance ms", "rmse");
+
+    const int sampleCounts[] = {1, 4, 16};
+    const FilterType types[] = {FilterType::Box, FilterType::Gaussian, FilterType::Mitchell, FilterType::BlackmanHarris};
+    for (FilterType type : types) {
+        ReconstructionFilter filter(type);
+        FilterSampler sampler(filter);
+        std::vector<glm::vec3> reference = renderSplat(renderer, filter, referenceSpp, threads);
+        for (int spp : sampleCounts) {
+            std::vector<glm::vec3> splatted, sampled;
+            double splatMs = bestMilliseconds([&](){ return renderSplat(renderer, filter, spp, threads); }, splatted);
+            double sampledMs = bestMilliseconds([&](){ return renderImportance(renderer, sampler, spp, threads); }, sampled);
+            std::printf("%-16s %4d %12.2f %10.5f %14.2f %10.5f\n", filterName(type), spp, splatMs,
+                        rmse(splatted, reference), sampledMs, rmse(sampled, reference));
+        }
+    }
+
+    // The box mean as it was, for the cost of filtering at all
+    std::vector<glm::vec3> boxReference = renderSplat(renderer, ReconstructionFilter(FilterType::Box), referenceSpp, threads);
+    std::printf("\n%-16s %4s %12s %10s\n", "box mean", "spp", "ms", "rmse");
+    for (int spp : sampleCounts) {
+        std::vector<glm::vec3> image;
+        double ms = bestMilliseconds([&](){ return renderBox(renderer, spp, threads); }, image);
+        std::printf("%-16s %4d %12.2f %10.5f\n", "renderTileSamples", spp, ms, rmse(image, boxReference));
+    }
+
+    // Tiles never share a buffer, so splatting needs no synchronisation and
+    // scales like the plain render; the merge is a second parallel pass
+    ReconstructionFilter mitchell(FilterType::Mitchell);
+    std::printf("\n%-8s %14s\n", "threads", "mitchell 4 spp ms");
+    for (unsigned t = 1; t <= std::max(threads, 4u); t *= 2) {
+        std::vector<glm::vec3> image;
+        double ms = bestMilliseconds([&](){ return renderSplat(renderer, mitchell, 4, t); }, image);
+        std::printf("%-8u %14.2f\n", t, ms);
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Throughput of Camera::generateRay and Sphere::intersect with the math layer
+// of this build (vecmath.hpp). Build and run it once per setting to compare:
+//
+//   make clean && make bench && ./bench/glm_simd
+//   make clean && make bench GLM_SIMD=1 && ./bench/glm_simd
+
+#include "camera.hpp"
+#include "sphere.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#define IMAGEX 800
+#define IMAGEY 600
+#define FOV 90
+#define SPHERE_COUNT 64
+#define REPEATS 7
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv){
+    int repeats = argc > 1 ? std::atoi(argv[1]) : REPEATS;
+
+#ifdef GLM_FORCE_INTRINSICS
+    std::printf("math layer: aligned glm::vec4, GLM SIMD paths\n");
+#else
+    std::printf("math layer: glm::vec3, scalar\n");
+#endif
+
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(glm::vec3(0.0f), axis, FOV, (float)IMAGEX / IMAGEY);
+
+    // Every camera ray of a frame, made once untimed for the intersection test below
+    std::vector<Ray> rays;
+    for (int y = 0; y < IMAGEY; y++)
+        for (int x = 0; x < IMAGEX; x++)
+            rays.push_back(cam.generateRay(x, y, IMAGEX, IMAGEY));
+
+    // The sum of directions keeps the loop from being dropped
+    double generateTime = 1e30;
+    rtVec3 directionSum(0.0f);
+    for (int r = 0; r < repeats; r++) {
+        directionSum = rtVec3(0.0f);
+        auto start = std::chrono::steady_clock::now();
+        for (int y = 0; y < IMAGEY; y++)
+            for (int x = 0; x < IMAGEX; x++)
+                directionSum += cam.generateRay(x, y, IMAGEX, IMAGEY).direction;
+        generateTime = std::min(generateTime, secondsSince(start));
+    }
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> xy(-8.0f, 8.0f), depth(5.0f, 20.0f), radius(0.3f, 1.5f);
+    std::vector<Sphere> spheres;
+    for (int i = 0; i < SPHERE_COUNT; i++)
+        spheres.push_back(Sphere(glm::vec3(xy(rng), xy(rng), depth(rng)), radius(rng)));
+
+    // Every ray against every sphere, the inner loop of a BVH leaf without the traversal
+    long hits = 0;
+    double tSum = 0.0;
+    double intersectTime = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        hits = 0;
+        tSum = 0.0;
+        auto start = std::chrono::steady_clock::now();
+        for (const Ray &ray : rays)
+            for (const Sphere &s : spheres) {
+                float t;
+                if (s.intersect(ray, t)) {
+                    hits++;
+                    tSum += t;
+                }
+            }
+        intersectTime = std::min(intersectTime, secondsSince(start));
+    }
+
+    double rayCount = (double)rays.size();
+    std::printf("generateRay      %7.2f Mrays/s  (%.4f s per %dx%d frame)\n",
+                rayCount / generateTime * 1e-6, generateTime, IMAGEX, IMAGEY);
+    std::printf("Sphere::intersect %6.2f Mtests/s (%ld hits, t sum %.6e)\n",
+                rayCount * SPHERE_COUNT / intersectTime * 1e-6, hits, tSum);
+    std::printf("direction sum %.6f %.6f %.6f\n", directionSum.x, directionSum.y, directionSum.z);
+    return 0;
+}
@@ -0,0 +1,158 @@
+// HDR output: float-to-half conversion paths and the size and encode time of
+// each output format for one rendered frame.
+//
+//   make bench && ./bench/hdr_output [width] [height] [outputDir]
+
+#include "hdr_image.hpp"
+#include "image_writer.hpp"
+#include "renderer.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#define FOV 90
+#define TILE_SIZE 32
+#define REPEATS 5
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static long fileSize(const std::string &path){
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 ? (long)st.st_size : -1;
+}
+
+static bool isHalfNan(uint16_t h){
+    return (h & 0x7c00) == 0x7c00 && (h & 0x03ff) != 0;
+}
+
+template <typename Encode>
+static double bestTime(Encode encode){
+    double best = 1e30;
+    for (int r = 0; r < REPEATS; r++) {
+        auto start = std::chrono::steady_clock::now();
+        if (!encode()) {
+            std::fprintf(stderr, "encode failed\n");
+            std::exit(1);
+        }
+        best = std::min(best, secondsSince(start));
+    }
+    return best;
+}
+
+int main(int argc, char **argv){
+    int width = argc > 1 ? std::atoi(argv[1]) : 1920;
+    int height = argc > 2 ? std::atoi(argv[2]) : 1080;
+    std::string dir = argc > 3 ? argv[3] : ".";
+
+    // Conversion: every float bit pattern through SSE2 and F16C, which must agree
+    // bit for bit apart from NaN payloads (F16C keeps them, SSE2 returns a quiet NaN)
+    bool f16c = cpuHasF16C();
+    const size_t chunk = 1 << 20;
+    std::vector<float> values(chunk);
+    std::vector<uint16_t> a(chunk), b(chunk), g(chunk);
+    uint64_t mismatches = 0, glmDiffers = 0, glmOffByMore = 0;
+    for (uint64_t base = 0; base < (1ull << 32); base += chunk) {
+        for (size_t i = 0; i < chunk; i++) {
+            uint32_t bits = (uint32_t)(base + i);
+            std::memcpy(&values[i], &bits, sizeof(float));
+        }
+        floatToHalfSSE2(values.data(), a.data(), chunk);
+        if (f16c) {
+            floatToHalfF16C(values.data(), b.data(), chunk);
+            for (size_t i = 0; i < chunk; i++)
+                mismatches += a[i] != b[i] && !(isHalfNan(a[i]) && isHalfNan(b[i]));
+        }
+        // glm rounds ties away from zero and flushes below half the smallest subnormal
+        if ((base >> 20) % 64 == 0) {
+            floatToHalfScalar(values.data(), g.data(), chunk);
+            for (size_t i = 0; i < chunk; i++) {
+                if (a[i] == g[i] || std::isnan(values[i]))
+                    continue;
+                glmDiffers++;
+                glmOffByMore += std::abs((int)(a[i] & 0x7fff) - (int)(g[i] & 0x7fff)) > 1;
+            }
+        }
+    }
+    std::printf("all 2^32 floats: SSE2 vs F16C %s (%llu mismatches)\n", f16c ? "checked" : "skipped, no F16C",
+                (unsigned long long)mismatches);
+    std::printf("1/64 sample vs glm::packHalf1x16: %llu differ, %llu by more than one ulp\n",
+                (unsigned long long)glmDiffers, (unsigned long long)glmOffByMore);
+
+    // Conversion throughput on radiance-like values
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<float> radiance(0.0f, 4.0f);
+    const size_t count = 1 << 24;
+    std::vector<float> in(count);
+    std::vector<uint16_t> out(count);
+    for (float &v : in)
+        v = radiance(rng);
+    struct { const char *name; void (*convert)(const float *, uint16_t *, size_t); } paths[] = {
+        {"glm::packHalf1x16", floatToHalfScalar},
+        {"SSE2", floatToHalfSSE2},
+        {"F16C", floatToHalfF16C},
+    };
+    for (const auto &path : paths) {
+        if (path.convert == floatToHalfF16C && !f16c)
+            continue;
+        double t = bestTime([&](){ path.convert(in.data(), out.data(), count); return true; });
+        std::printf("%-18s %8.1f M values/s\n", path.name, count / t * 1e-6);
+    }
+
+    // Formats for one frame of a random sphere scene
+    std::vector<Sphere> spheres;
+    std::uniform_real_distribution<float> xy(-20.0f, 20.0f), depth(5.0f, 45.0f), radius(0.2f, 0.6f);
+    for (int i = 0; i < 2000; i++)
+        spheres.push_back(Sphere(glm::vec3(xy(rng), xy(rng), depth(rng)), radius(rng)));
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(glm::vec3(0.0f), axis, FOV, (float)width / height);
+    Renderer renderer(cam, spheres, glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)), width, height);
+    std::vector<glm::vec3> frame((size_t)width * height);
+    for (const Tile &tile : makeTiles(width, height, TILE_SIZE)) {
+        std::vector<glm::vec3> pixels((size_t)tile.width * tile.height);
+        renderer.renderTile(tile, pixels.data());
+        for (int y = 0; y < tile.height; y++)
+            std::copy_n(&pixels[(size_t)y * tile.width], tile.width, &frame[(size_t)(tile.y0 + y) * width + tile.x0]);
+    }
+
+    std::string ppm = dir + "/hdr_output.ppm", pfm = dir + "/hdr_output.pfm";
+    std::string exrRaw = dir + "/hdr_output_raw.exr", exrRle = dir + "/hdr_output_rle.exr";
+    struct Format { const char *name; std::string path; double seconds; };
+    Format formats[] = {
+        {"P6 8-bit (clamped)", ppm, bestTime([&](){
+            std::vector<unsigned char> bytes(frame.size() * 3);
+            for (size_t i = 0; i < frame.size(); i++) {
+                bytes[i * 3 + 0] = toByte(frame[i].r);
+                bytes[i * 3 + 1] = toByte(frame[i].g);
+                bytes[i * 3 + 2] = toByte(frame[i].b);
+            }
+            std::FILE *f = std::fopen(ppm.c_str(), "wb");
+            if (!f)
+                return false;
+            std::fprintf(f, "P6\n%d %d\n255\n", width, height);
+            std::fwrite(bytes.data(), 1, bytes.size(), f);
+            return std::fclose(f) == 0;
+        })},
+        {"PFM float32", pfm, bestTime([&](){ return writePFM(pfm, width, height, frame); })},
+        {"EXR half", exrRaw, bestTime([&](){ return writeEXR(exrRaw, width, height, frame, ExrCompression::None); })},
+        {"EXR half + RLE", exrRle, bestTime([&](){ return writeEXR(exrRle, width, height, frame, ExrCompression::RLE); })},
+    };
+
+    double rawBytes = (double)frame.size() * sizeof(glm::vec3);
+    std::printf("%dx%d frame, %.1f MB as floats\n", width, height, rawBytes / 1e6);
+    for (const Format &f : formats) {
+        long size = fileSize(f.path);
+        std::printf("%-20s %9.2f MB  %6.1f%% of float  encode %7.2f ms  %8.1f MB/s of input\n",
+                    f.name, size / 1e6, 100.0 * size / rawBytes, f.seconds * 1e3, rawBytes / f.seconds * 1e-6);
+        std::remove(f.path.c_str());
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,119 @@
+// Turnaround of single-object edits through IncrementalRenderer against a
+// full re-render. Each edit moves or recolours one visible sphere of a random
+// field. For each: tiles re-traced for the first hits and milliseconds until
+// the frame is up to date but for shadows, then tiles queued for shadows and
+// milliseconds to refine them away, REFINE_TILES tiles per pass. After the
+// last pass the frame must match a full render of the edited scene by a newly
+// built renderer, pixel for pixel.
+//
+//   make bench && ./bench/incremental [width] [height] [sphereCount] [edits]
+
+#include "incremental.hpp"
+#include "tile_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define FOV 90
+#define TILE_SIZE 32
+#define REFINE_TILES 16
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv){
+    int width = argc > 1 ? std::atoi(argv[1]) : 800;
+    int height = argc > 2 ? std::atoi(argv[2]) : 600;
+    int sphereCount = argc > 3 ? std::atoi(argv[3]) : 2000;
+    int edits = argc > 4 ? std::atoi(argv[4]) : 12;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> xy(-20.0f, 20.0f), depth(5.0f, 45.0f), radius(0.2f, 0.6f);
+    std::vector<Sphere> spheres;
+    for (int i = 0; i < sphereCount; i++)
+        spheres.push_back(Sphere(glm::vec3(xy(rng), xy(rng), depth(rng)), radius(rng)));
+    const glm::vec3 lightDir = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f));
+
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(glm::vec3(0.0f), axis, FOV, (float)width / height);
+    Renderer renderer(cam, spheres, lightDir, width, height);
+    TilePool pool(threads);
+    IncrementalRenderer incremental(renderer, pool, TILE_SIZE);
+
+    auto start = std::chrono::steady_clock::now();
+    incremental.renderAll();
+    double fullMs = secondsSince(start) * 1000.0;
+    std::printf("%dx%d, %d spheres, %zu tiles, %u threads: full render %.2f ms\n\n", width, height, sphereCount,
+                incremental.tileCount(), threads, fullMs);
+    std::printf("%-7s %6s %7s %10s %8s %8s %10s %8s\n", "edit", "sphere", "tiles", "ms", "shadow", "passes",
+                "refine ms", "diff");
+
+    std::uniform_real_distribution<float> nudge(-1.0f, 1.0f), channel(0.0f, 1.0f);
+    std::vector<glm::vec3> colors(sphereCount, glm::vec3(0.7f, 0.2f, 0.2f));
+    double editMs = 0.0, refineMs = 0.0;
+    size_t mismatches = 0;
+    for (int e = 0; e < edits; e++) {
+        // A sphere that is in view, so the edit shows
+        int index;
+        do
+            index = (int)(rng() % sphereCount);
+        while (incremental.getFootprint(index).empty());
+
+        bool move = e % 3 != 2;
+        start = std::chrono::steady_clock::now();
+        size_t tiles;
+        if (move) {
+            const Sphere &s = spheres[index];
+            spheres[index] = Sphere(toVec3(s.getCenter()) + glm::vec3(nudge(rng), nudge(rng), nudge(rng)), s.getRadius());
+            tiles = incremental.moveSphere(index, spheres[index]);
+        } else {
+            colors[index] = glm::vec3(channel(rng), channel(rng), channel(rng));
+            tiles = incremental.setSphereColor(index, colors[index]);
+        }
+        double ms = secondsSince(start) * 1000.0;
+
+        size_t shadowTiles = incremental.pendingTiles();
+        int passes = 0;
+        start = std::chrono::steady_clock::now();
+        while (incremental.pendingTiles() > 0) {
+            incremental.refine(REFINE_TILES);
+            passes++;
+        }
+        double refine = secondsSince(start) * 1000.0;
+
+        // The edited scene from scratch
+        Renderer fresh(cam, spheres, lightDir, width, height);
+        for (int i = 0; i < sphereCount; i++)
+            fresh.setSphereColor(i, colors[i]);
+        std::vector<glm::vec3> reference((size_t)width * height);
+        for (const Tile &tile : makeTiles(width, height, TILE_SIZE)) {
+            std::vector<glm::vec3> pixels((size_t)tile.width * tile.height);
+            fresh.renderTile(tile, pixels.data());
+            for (int y = 0; y < tile.height; y++)
+                std::copy_n(&pixels[(size_t)y * tile.width], tile.width, &reference[(size_t)(tile.y0 + y) * width + tile.x0]);
+        }
+        size_t diff = 0;
+        for (size_t p = 0; p < reference.size(); p++)
+            diff += reference[p] != incremental.getImage()[p];
+        mismatches += diff;
+
+        std::printf("%-7s %6d %7zu %10.2f %8zu %8d %10.2f %8zu\n", move ? "move" : "colour", index, tiles, ms,
+                    shadowTiles, passes, refine, diff);
+        editMs += ms;
+        refineMs += refine;
+    }
+    if (edits > 0)
+        std::printf("\nmean turnaround %.2f ms (%.1fx faster than a full render), %.2f ms more for shadows\n",
+                    editMs / edits, fullMs * edits / editMs, refineMs / edits);
+    if (mismatches > 0) {
+        std::fprintf(stderr, "%zu pixels differ from a full render\n", mismatches);
+        return 1;
+    }
+    return 0;
+}
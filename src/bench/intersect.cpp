@@ -0,0 +1,385 @@
+// Accuracy and throughput of the intersection kernels (intersect.hpp) against
+// the quadratic Sphere::intersect used before and GLM's ray tests.
+//
+//   make bench && ./bench/intersect
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include "glm/gtx/intersect.hpp"
+#include "camera.hpp"
+#include "intersect.hpp"
+#include "multiversion.hpp"
+#include "sphere.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+#define IMAGEX 800
+#define IMAGEY 600
+#define FOV 90
+#define PRIMITIVE_COUNT 64
+#define ACCURACY_RAYS 100000
+#define MESH_SIZE 32
+#define REPEATS 5
+
+// The sphere test Sphere::intersect had before intersect.hpp
+static bool textbookSphere(const Ray &ray, const rtVec3 &center, float radius, float &t){
+    rtVec3 oc = ray.origin - center;
+    float a = glm::dot(ray.direction, ray.direction);
+    float b = 2.0f * glm::dot(oc, ray.direction);
+    float c = glm::dot(oc, oc) - radius * radius;
+    float discriminant = b * b - 4 * a * c;
+    if (discriminant < 0.0f)
+        return false;
+    float sqrtD = std::sqrt(discriminant);
+    float t0 = (-b - sqrtD) / (2.0f * a);
+    float t1 = (-b + sqrtD) / (2.0f * a);
+    if (t0 < 0.0f && t1 < 0.0f)
+        return false;
+    t = (t0 > 0.0f) ? t0 : t1;
+    return true;
+}
+
+static bool glmSphere(const Ray &ray, const rtVec3 &center, float radius, float &t){
+    return glm::intersectRaySphere(toVec3(ray.origin), toVec3(ray.direction), toVec3(center), radius * radius, t);
+}
+
+static bool robustSphere(const Ray &ray, const rtVec3 &center, float radius, float &t){
+    return intersectSphere(ray, center, radius, INFINITY, t);
+}
+
+// Nearest hit of the float ray in long double, or -1. Its inputs are floats,
+// so the products are exact and only the square root and division round
+static long double referenceSphere(const Ray &ray, const rtVec3 &center, float radius){
+    long double f[3], d[3];
+    for (int k = 0; k < 3; k++) {
+        f[k] = (long double)ray.origin[k] - center[k];
+        d[k] = ray.direction[k];
+    }
+    long double a = d[0] * d[0] + d[1] * d[1] + d[2] * d[2];
+    long double b = (f[0] * d[0] + f[1] * d[1] + f[2] * d[2]) / a;
+    long double c = (f[0] * f[0] + f[1] * f[1] + f[2] * f[2] - (long double)radius * radius) / a;
+    long double discriminant = b * b - c;
+    if (discriminant < 0.0L)
+        return -1.0L;
+    long double s = std::sqrt(discriminant);
+    long double t0 = -b - s, t1 = -b + s;
+    return t0 > 0.0L ? t0 : (t1 > 0.0L ? t1 : -1.0L);
+}
+
+typedef bool (*SphereTest)(const Ray &, const rtVec3 &, float, float &);
+
+static const struct { const char *name; SphereTest test; } sphereTests[] = {
+    {"textbook quadratic", textbookSphere},
+    {"glm::intersectRaySphere", glmSphere},
+    {"intersectSphere", robustSphere},
+};
+
+static glm::vec3 randomUnit(std::mt19937 &rng){
+    std::normal_distribution<float> n;
+    return glm::normalize(glm::vec3(n(rng), n(rng), n(rng)));
+}
+
+// Rays from the origin aimed inside a unit sphere further and further away:
+// error of t in units of the radius, and rays that miss
+static void sphereDistanceAccuracy(){
+    std::printf("\nsphere of radius 1 at distance D, %d rays aimed inside it: max |t - t_exact|, misses\n",
+                ACCURACY_RAYS);
+    std::printf("  %-24s", "D");
+    for (float distance : {1e1f, 1e2f, 1e3f, 1e4f, 1e5f})
+        std::printf(" %20.0e", distance);
+    std::printf("\n");
+    for (const auto &kernel : sphereTests) {
+        std::printf("  %-24s", kernel.name);
+        for (float distance : {1e1f, 1e2f, 1e3f, 1e4f, 1e5f}) {
+            std::mt19937 rng(7);
+            rtVec3 center = toRtVec3(distance * glm::normalize(glm::vec3(0.3f, 0.2f, 1.0f)));
+            double maxError = 0.0;
+            int misses = 0;
+            for (int i = 0; i < ACCURACY_RAYS; i++) {
+                Ray ray(rtVec3(0.0f), center + toRtVec3(0.95f * randomUnit(rng)));
+                long double exact = referenceSphere(ray, center, 1.0f);
+                float t;
+                if (exact < 0.0L)
+                    continue;
+                if (!kernel.test(ray, center, 1.0f, t))
+                    misses++;
+                else
+                    maxError = std::max(maxError, (double)std::fabs(t - exact));
+            }
+            std::printf(" %11.2e %8d", maxError, misses);
+        }
+        std::printf("\n");
+    }
+}
+
+// Rays leaving a sphere from points on its surface, rounded to float the way
+// the origins of shadow and bounce rays are. Rounding puts half of them just
+// inside, and those hit the sphere again at a small t even in exact
+// arithmetic: the largest such t is the epsilon a renderer needs whatever the
+// kernel. What the kernel decides is how often it gets hit or miss wrong and
+// how far off t is
+static void sphereSelfIntersection(){
+    const float radii[] = {1.0f, 1e2f, 1e3f, 1e4f};
+    std::printf("\nrays leaving the surface of a sphere of radius R, %d rays: wrong hit/miss, max |t - t_exact|\n",
+                ACCURACY_RAYS);
+    std::printf("  %-24s", "R");
+    for (float radius : radii)
+        std::printf(" %20.0e", radius);
+    std::printf("\n");
+
+    long double worstExact[4] = {};
+    for (const auto &kernel : sphereTests) {
+        std::printf("  %-24s", kernel.name);
+        for (int k = 0; k < 4; k++) {
+            float radius = radii[k];
+            std::mt19937 rng(11);
+            rtVec3 center = toRtVec3(glm::vec3(0.0f, -radius, 0.0f) + glm::vec3(3.0f, 1.0f, -2.0f));
+            double maxError = 0.0;
+            int wrong = 0;
+            for (int i = 0; i < ACCURACY_RAYS; i++) {
+                glm::vec3 n = randomUnit(rng);
+                glm::vec3 d = randomUnit(rng);
+                if (glm::dot(d, n) < 0.0f)
+                    d = -d;
+                Ray ray(center + toRtVec3(radius * n), toRtVec3(d));
+                long double exact = referenceSphere(ray, center, radius);
+                worstExact[k] = std::max(worstExact[k], exact);
+                float t;
+                bool hit = kernel.test(ray, center, radius, t);
+                if (hit != (exact > 0.0L))
+                    wrong++;
+                else if (hit)
+                    maxError = std::max(maxError, (double)std::fabs(t - exact));
+            }
+            std::printf(" %8d %11.2e", wrong, maxError);
+        }
+        std::printf("\n");
+    }
+    std::printf("  %-24s", "largest exact t");
+    for (long double t : worstExact)
+        std::printf(" %20.2Le", t);
+    std::printf("\n");
+}
+
+struct Triangle {
+    glm::vec3 p0, p1, p2;
+};
+
+// Rays through the shared edges and vertices of a jittered grid of triangles
+// away from the origin; a ray that hits none of them went through a crack
+static void triangleWatertightness(){
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<float> jitter(-0.3f, 0.3f), along(0.0f, 1.0f);
+    glm::vec3 base(1000.0f, 700.0f, 1300.0f);
+    glm::vec3 axisU = glm::normalize(glm::vec3(1.0f, 0.2f, -0.3f));
+    glm::vec3 axisV = glm::normalize(glm::cross(glm::vec3(0.1f, 0.3f, 1.0f), axisU));
+    glm::vec3 normal = glm::cross(axisU, axisV);
+
+    std::vector<glm::vec3> grid;
+    for (int j = 0; j <= MESH_SIZE; j++)
+        for (int i = 0; i <= MESH_SIZE; i++)
+            grid.push_back(base + (i + jitter(rng)) * axisU + (j + jitter(rng)) * axisV);
+    auto vertex = [&](int i, int j){ return grid[j * (MESH_SIZE + 1) + i]; };
+
+    std::vector<Triangle> mesh;
+    std::vector<glm::vec3> targets;
+    for (int j = 0; j < MESH_SIZE; j++)
+        for (int i = 0; i < MESH_SIZE; i++) {
+            glm::vec3 a = vertex(i, j), b = vertex(i + 1, j), c = vertex(i + 1, j + 1), d = vertex(i, j + 1);
+            mesh.push_back(Triangle{a, b, c});
+            mesh.push_back(Triangle{a, c, d});
+            // The diagonal, and the edges shared with the next cells
+            for (int k = 0; k < 4; k++)
+                targets.push_back(glm::mix(a, c, along(rng)));
+            if (i + 1 < MESH_SIZE)
+                targets.push_back(glm::mix(b, c, along(rng)));
+            if (j + 1 < MESH_SIZE)
+                targets.push_back(glm::mix(c, d, along(rng)));
+            if (i > 0 && j > 0)
+                targets.push_back(a);
+        }
+
+    glm::vec3 eye = base + glm::vec3(MESH_SIZE * 0.5f) * (axisU + axisV) + 40.0f * normal + glm::vec3(0.37f, -0.21f, 0.0f);
+    int leaksGlm = 0, leaksWatertight = 0, leaksPacket = 0, packetMismatches = 0;
+    for (size_t r = 0; r + 16 <= targets.size(); r += 16) {
+        RayPacket<16> packet;
+        std::vector<Ray> rays;
+        for (int lane = 0; lane < 16; lane++) {
+            rays.push_back(Ray(toRtVec3(eye), toRtVec3(targets[r + lane] - eye)));
+            packet.set(lane, rays.back());
+        }
+        TriangleRayPacket<16> prepared(packet);
+
+        int packetHits = 0;
+        for (const Triangle &tri : mesh) {
+            float tMax[16], t[16], u[16], v[16];
+            std::fill(tMax, tMax + 16, INFINITY);
+            int mask = intersectTriangle(prepared, tri.p0, tri.p1, tri.p2, tMax, t, u, v);
+            packetHits |= mask;
+            for (int lane = 0; lane < 16; lane++) {
+                float ts, us, vs;
+                bool scalar = intersectTriangle(prepared.rays[lane], tri.p0, tri.p1, tri.p2, INFINITY, ts, us, vs);
+                bool packed = (mask >> lane) & 1;
+                if (scalar != packed || (scalar && (ts != t[lane] || us != u[lane] || vs != v[lane])))
+                    packetMismatches++;
+            }
+        }
+
+        for (int lane = 0; lane < 16; lane++) {
+            bool hitGlm = false, hitWatertight = false;
+            glm::vec3 origin = toVec3(rays[lane].origin), direction = toVec3(rays[lane].direction);
+            for (const Triangle &tri : mesh) {
+                glm::vec2 bary;
+                float t, u, v;
+                hitGlm |= glm::intersectRayTriangle(origin, direction, tri.p0, tri.p1, tri.p2, bary, t) && t > 0.0f;
+                hitWatertight |= intersectTriangle(prepared.rays[lane], tri.p0, tri.p1, tri.p2, INFINITY, t, u, v);
+            }
+            leaksGlm += !hitGlm;
+            leaksWatertight += !hitWatertight;
+            leaksPacket += !((packetHits >> lane) & 1);
+        }
+    }
+    size_t rayCount = targets.size() / 16 * 16;
+    std::printf("\n%zu triangles, %zu rays through shared edges and vertices: rays that hit no triangle\n",
+                mesh.size(), rayCount);
+    std::printf("  %-24s %8d\n", "glm::intersectRayTriangle", leaksGlm);
+    std::printf("  %-24s %8d\n", "intersectTriangle", leaksWatertight);
+    std::printf("  %-24s %8d  (%d tests differ from the scalar one)\n", "16-wide packets", leaksPacket,
+                packetMismatches);
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Best time of REPEATS runs of work(), which returns a hit count
+template <typename Work>
+static void timeTests(const char *name, double tests, Work work){
+    double best = 1e30;
+    long hits = 0;
+    for (int r = 0; r < REPEATS; r++) {
+        auto start = std::chrono::steady_clock::now();
+        hits = work();
+        best = std::min(best, secondsSince(start));
+    }
+    std::printf("  %-24s %8.1f Mtests/s (%ld hits)\n", name, tests / best * 1e-6, hits);
+}
+
+template <int N>
+static long spherePackets(const std::vector<RayPacket<N>> &packets, const std::vector<Sphere> &spheres){
+    float tMax[N], t[N];
+    std::fill(tMax, tMax + N, INFINITY);
+    long hits = 0;
+    for (const RayPacket<N> &packet : packets)
+        for (const Sphere &s : spheres)
+            hits += __builtin_popcount(intersectSphere(packet, toVec3(s.getCenter()), s.getRadius(), tMax, t));
+    return hits;
+}
+
+template <int N>
+static long trianglePackets(const std::vector<TriangleRayPacket<N>> &packets, const std::vector<Triangle> &triangles){
+    float tMax[N], t[N], u[N], v[N];
+    std::fill(tMax, tMax + N, INFINITY);
+    long hits = 0;
+    for (const TriangleRayPacket<N> &packet : packets)
+        for (const Triangle &tri : triangles)
+            hits += __builtin_popcount(intersectTriangle(packet, tri.p0, tri.p1, tri.p2, tMax, t, u, v));
+    return hits;
+}
+
+template <int N>
+static std::vector<RayPacket<N>> makePackets(const std::vector<Ray> &rays){
+    std::vector<RayPacket<N>> packets(rays.size() / N);
+    for (size_t i = 0; i < packets.size() * N; i++)
+        packets[i / N].set(i % N, rays[i]);
+    return packets;
+}
+
+template <int N>
+static std::vector<TriangleRayPacket<N>> makeTrianglePackets(const std::vector<Ray> &rays){
+    std::vector<TriangleRayPacket<N>> packets;
+    for (const RayPacket<N> &packet : makePackets<N>(rays))
+        packets.push_back(TriangleRayPacket<N>(packet));
+    return packets;
+}
+
+static void throughput(){
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(glm::vec3(0.0f), axis, FOV, (float)IMAGEX / IMAGEY);
+    std::vector<Ray> rays;
+    for (int y = 0; y < IMAGEY; y++)
+        for (int x = 0; x < IMAGEX; x++)
+            rays.push_back(cam.generateRay(x, y, IMAGEX, IMAGEY));
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> xy(-8.0f, 8.0f), depth(5.0f, 20.0f), radius(0.3f, 1.5f);
+    std::vector<Sphere> spheres;
+    std::vector<Triangle> triangles;
+    for (int i = 0; i < PRIMITIVE_COUNT; i++) {
+        glm::vec3 c(xy(rng), xy(rng), depth(rng));
+        float r = radius(rng);
+        spheres.push_back(Sphere(c, r));
+        triangles.push_back(Triangle{c + r * randomUnit(rng), c + r * randomUnit(rng), c + r * randomUnit(rng)});
+    }
+    double tests = (double)rays.size() * PRIMITIVE_COUNT;
+
+    std::printf("\n%zu camera rays x %d spheres, kernels for %s\n", rays.size(), PRIMITIVE_COUNT, multiversionIsa());
+    for (const auto &kernel : sphereTests)
+        timeTests(kernel.name, tests, [&](){
+            long hits = 0;
+            for (const Ray &ray : rays)
+                for (const Sphere &s : spheres) {
+                    float t;
+                    hits += kernel.test(ray, s.getCenter(), s.getRadius(), t);
+                }
+            return hits;
+        });
+    std::vector<RayPacket<4>> packets4 = makePackets<4>(rays);
+    std::vector<RayPacket<8>> packets8 = makePackets<8>(rays);
+    std::vector<RayPacket<16>> packets16 = makePackets<16>(rays);
+    timeTests("4-wide packets", tests, [&](){ return spherePackets(packets4, spheres); });
+    timeTests("8-wide packets", tests, [&](){ return spherePackets(packets8, spheres); });
+    timeTests("16-wide packets", tests, [&](){ return spherePackets(packets16, spheres); });
+
+    std::printf("\n%zu camera rays x %d triangles\n", rays.size(), PRIMITIVE_COUNT);
+    timeTests("glm::intersectRayTriangle", tests, [&](){
+        long hits = 0;
+        for (const Ray &ray : rays) {
+            glm::vec3 origin = toVec3(ray.origin), direction = toVec3(ray.direction);
+            for (const Triangle &tri : triangles) {
+                glm::vec2 bary;
+                float t;
+                hits += glm::intersectRayTriangle(origin, direction, tri.p0, tri.p1, tri.p2, bary, t) && t > 0.0f;
+            }
+        }
+        return hits;
+    });
+    timeTests("intersectTriangle", tests, [&](){
+        long hits = 0;
+        for (const Ray &ray : rays) {
+            TriangleRay prepared(ray);
+            for (const Triangle &tri : triangles) {
+                float t, u, v;
+                hits += intersectTriangle(prepared, tri.p0, tri.p1, tri.p2, INFINITY, t, u, v);
+            }
+        }
+        return hits;
+    });
+    std::vector<TriangleRayPacket<4>> triangles4 = makeTrianglePackets<4>(rays);
+    std::vector<TriangleRayPacket<8>> triangles8 = makeTrianglePackets<8>(rays);
+    std::vector<TriangleRayPacket<16>> triangles16 = makeTrianglePackets<16>(rays);
+    timeTests("4-wide packets", tests, [&](){ return trianglePackets(triangles4, triangles); });
+    timeTests("8-wide packets", tests, [&](){ return trianglePackets(triangles8, triangles); });
+    timeTests("16-wide packets", tests, [&](){ return trianglePackets(triangles16, triangles); });
+}
+
+int main(){
+    sphereDistanceAccuracy();
+    sphereSelfIntersection();
+    triangleWatertightness();
+    throughput();
+    return 0;
+}
@@ -0,0 +1,184 @@
+// Peak resident memory and throughput of writing a large image through a
+// memory-mapped file (mapped_image.hpp) against holding the frame in RAM and
+// fwriting it at the end.
+//
+//   make bench && ./bench/mmap_output [width] [height] [outputDir]
+
+#include "image_writer.hpp"
+#include "mapped_image.hpp"
+#include "renderer.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define FOV 90
+#define TILE_SIZE 32
+#define RSS_POLL_MS 5
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static size_t residentBytes(){
+    long pages = 0, resident = 0;
+    std::FILE *f = std::fopen("/proc/self/statm", "r");
+    if (f) {
+        if (std::fscanf(f, "%ld %ld", &pages, &resident) != 2)
+            resident = 0;
+        std::fclose(f);
+    }
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+// Polls resident memory on a side thread while run() executes; returns the peak growth
+template <typename Run>
+static size_t peakResidentGrowth(Run run){
+    size_t base = residentBytes();
+    std::atomic<bool> done{false};
+    std::atomic<size_t> peak{base};
+    std::thread poller([&](){
+        while (!done) {
+            peak = std::max(peak.load(), residentBytes());
+            std::this_thread::sleep_for(std::chrono::milliseconds(RSS_POLL_MS));
+        }
+    });
+    run();
+    peak = std::max(peak.load(), residentBytes());
+    done = true;
+    poller.join();
+    return peak - base;
+}
+
+template <typename Work>
+static void forEachTile(size_t tileCount, Work work){
+    std::atomic<size_t> next{0};
+    std::vector<std::thread> threads;
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned t = 0; t < threadCount; t++)
+        threads.emplace_back([&](){
+            for (size_t i = next++; i < tileCount; i = next++)
+                work(i);
+        });
+    for (std::thread &t : threads)
+        t.join();
+}
+
+int main(int argc, char **argv){
+    int width = argc > 1 ? std::atoi(argv[1]) : 12000;
+    int height = argc > 2 ? std::atoi(argv[2]) : 12000;
+    std::string dir = argc > 3 ? argv[3] : ".";
+    std::string ramPath = dir + "/mmap_output_ram.ppm";
+    std::string mappedPath = dir + "/mmap_output_mapped.ppm";
+    std::string floatPath = dir + "/mmap_output_mapped.pfm";
+
+    std::vector<Sphere> spheres;
+    spheres.push_back(Sphere(glm::vec3(0.0f, 0.0f, 3.0f), 1.0f));
+    spheres.push_back(Sphere(glm::vec3(2.0f, 0.0f, 4.0f), 1.0f));
+    spheres.push_back(Sphere(glm::vec3(-2.0f, 0.0f, 4.0f), 1.0f));
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(glm::vec3(0.0f), axis, FOV, (float)width / height);
+    Renderer renderer(cam, spheres, glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)), width, height);
+    double megapixels = (double)width * height * 1e-6;
+
+    // Mapped runs go first so the in-RAM frame cannot inflate their baseline
+    bool ok = true;
+    double mappedTime = 0.0, floatTime = 0.0, ramTime = 0.0;
+    int bandRows = 0, floatBandRows = 0;
+    size_t mappedPeak = peakResidentGrowth([&](){
+        auto start = std::chrono::steady_clock::now();
+        MappedImage image(mappedPath, width, height, MappedFormat::PPM, TILE_SIZE);
+        bandRows = image.getBandRows();
+        std::vector<Tile> tiles = makeTiles(width, height, bandRows);
+        forEachTile(tiles.size(), [&](size_t i){
+            std::vector<glm::vec3> pixels((size_t)tiles[i].width * tiles[i].height);
+            renderer.renderTile(tiles[i], pixels.data());
+            image.storeTile(tiles[i], pixels.data());
+        });
+        ok = image.close() && ok;
+        mappedTime = secondsSince(start);
+    });
+
+    size_t floatPeak = peakResidentGrowth([&](){
+        auto start = std::chrono::steady_clock::now();
+        MappedImage image(floatPath, width, height, MappedFormat::PFM, TILE_SIZE);
+        floatBandRows = image.getBandRows();
+        std::vector<Tile> tiles = makeTiles(width, height, floatBandRows);
+        forEachTile(tiles.size(), [&](size_t i){
+            std::vector<glm::vec3> pixels((size_t)tiles[i].width * tiles[i].height);
+            renderer.renderTile(tiles[i], pixels.data());
+            image.storeTile(tiles[i], pixels.data());
+        });
+        ok = image.close() && ok;
+        floatTime = secondsSince(start);
+    });
+
+    size_t ramPeak = peakResidentGrowth([&](){
+        auto start = std::chrono::steady_clock::now();
+        std::vector<unsigned char> frame((size_t)width * height * 3);
+        std::vector<Tile> tiles = makeTiles(width, height, TILE_SIZE);
+        forEachTile(tiles.size(), [&](size_t i){
+            const Tile &tile = tiles[i];
+            std::vector<glm::vec3> pixels((size_t)tile.width * tile.height);
+            renderer.renderTile(tile, pixels.data());
+            for (int y = 0; y < tile.height; y++) {
+                unsigned char *dst = &frame[((size_t)(tile.y0 + y) * width + tile.x0) * 3];
+                for (int x = 0; x < tile.width; x++) {
+                    const glm::vec3 &c = pixels[(size_t)y * tile.width + x];
+                    dst[x * 3 + 0] = toByte(c.r);
+                    dst[x * 3 + 1] = toByte(c.g);
+                    dst[x * 3 + 2] = toByte(c.b);
+                }
+            }
+        });
+        std::FILE *out = std::fopen(ramPath.c_str(), "wb");
+        ok = out != nullptr && ok;
+        if (out) {
+            std::fprintf(out, "P6\n%d %d\n255\n", width, height);
+            ok = std::fwrite(frame.data(), 1, frame.size(), out) == frame.size() && ok;
+            ok = std::fclose(out) == 0 && ok;
+        }
+        ramTime = secondsSince(start);
+    });
+
+    std::printf("%dx%d, %.1f MB as P6, %.1f MB as PFM\n", width, height, megapixels * 3, megapixels * 12);
+    std::printf("in RAM + fwrite:  %7.2f s  %7.2f Mpixels/s  peak RSS +%8.1f MB\n",
+                ramTime, megapixels / ramTime, ramPeak / 1e6);
+    std::printf("mmap P6:          %7.2f s  %7.2f Mpixels/s  peak RSS +%8.1f MB  (%d-row bands)\n",
+                mappedTime, megapixels / mappedTime, mappedPeak / 1e6, bandRows);
+    std::printf("mmap PFM:         %7.2f s  %7.2f Mpixels/s  peak RSS +%8.1f MB  (%d-row bands)\n",
+                floatTime, megapixels / floatTime, floatPeak / 1e6, floatBandRows);
+
+    // The mapped P6 has a padded header; its pixels must match the in-RAM file exactly
+    std::FILE *a = std::fopen(ramPath.c_str(), "rb");
+    std::FILE *b = std::fopen(mappedPath.c_str(), "rb");
+    if (a && b) {
+        size_t pixelBytes = (size_t)width * height * 3;
+        std::fseek(a, -(long)pixelBytes, SEEK_END);
+        std::fseek(b, -(long)pixelBytes, SEEK_END);
+        std::vector<unsigned char> bufA(1 << 20), bufB(1 << 20);
+        size_t n;
+        while ((n = std::fread(bufA.data(), 1, bufA.size(), a)) > 0)
+            if (std::fread(bufB.data(), 1, n, b) != n || !std::equal(bufA.begin(), bufA.begin() + n, bufB.begin())) {
+                ok = false;
+                std::fprintf(stderr, "mapped P6 pixels differ from the in-RAM file\n");
+                break;
+            }
+    }
+    if (a) std::fclose(a);
+    if (b) std::fclose(b);
+
+    std::remove(ramPath.c_str());
+    std::remove(mappedPath.c_str());
+    std::remove(floatPath.c_str());
+    if (!ok) {
+        std::fprintf(stderr, "writing failed\n");
+        return 1;
+    }
+    return 0;
+}
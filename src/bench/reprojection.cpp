@@ -0,0 +1,117 @@
+// A camera flight through a field of spheres rendered every frame from
+// scratch at the target sample count, and through ReprojectionCache. Reports
+// frames/s, the share of pixels that kept their history, shaded samples per
+// pixel and RMSE against a high sample count render of every frame.
+//
+//   make bench && ./bench/reprojection [width] [height] [sphereCount] [frames] [targetSpp] [referenceSpp]
+
+#include "camera_path.hpp"
+#include "reprojection.hpp"
+#include "tile_pool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define FOV 90
+#define TILE_SIZE 32
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double rmse(const std::vector<glm::vec3> &image, const std::vector<glm::vec3> &reference){
+    double sum = 0.0;
+    for (size_t i = 0; i < image.size(); i++) {
+        glm::vec3 d = image[i] - reference[i];
+        sum += glm::dot(d, d) / 3.0;
+    }
+    return std::sqrt(sum / image.size());
+}
+
+static void renderScratch(const Renderer &renderer, TilePool &pool, const std::vector<Tile> &tiles, int spp,
+                          std::vector<glm::vec3> &image){
+    int width = renderer.getWidth();
+    image.resize((size_t)width * renderer.getHeight());
+    pool.run(tiles.size(), [&](size_t i){
+        const Tile &tile = tiles[i];
+        for (int y = 0; y < tile.height; y++)
+            for (int x = 0; x < tile.width; x++)
+                image[(size_t)(tile.y0 + y) * width + tile.x0 + x] =
+                    renderer.shadeSamples(tile.x0 + x, tile.y0 + y, 0, spp) / (float)spp;
+    });
+}
+
+int main(int argc, char **argv){
+    int width = argc > 1 ? std::atoi(argv[1]) : 320;
+    int height = argc > 2 ? std::atoi(argv[2]) : 240;
+    int sphereCount = argc > 3 ? std::atoi(argv[3]) : 500;
+    int frames = argc > 4 ? std::atoi(argv[4]) : 24;
+    int targetSpp = argc > 5 ? std::atoi(argv[5]) : 16;
+    int referenceSpp = argc > 6 ? std::atoi(argv[6]) : 64;
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> xy(-20.0f, 20.0f), depth(5.0f, 45.0f), radius(0.2f, 0.6f);
+    std::vector<Sphere> spheres;
+    for (int i = 0; i < sphereCount; i++)
+        spheres.push_back(Sphere(glm::vec3(xy(rng), xy(rng), depth(rng)), radius(rng)));
+
+    // A second of a slow dolly with a turn, at 24 frames a second
+    const glm::vec3 up(0.0f, 1.0f, 0.0f);
+    CameraPath path;
+    path.addKeyframe({0.0f, glm::vec3(0.0f, 0.0f, -5.0f), lookRotation(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), up)});
+    path.addKeyframe({1.0f, glm::vec3(1.0f, 0.5f, -3.0f), lookRotation(glm::vec3(0.0f), glm::vec3(0.15f, 0.05f, 1.0f), up)});
+
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(glm::vec3(0.0f), axis, FOV, (float)width / height);
+    Renderer renderer(cam, spheres, glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)), width, height);
+    TilePool pool(threads);
+    std::vector<Tile> tiles = makeTiles(width, height, TILE_SIZE);
+    ReprojectionSettings settings;
+    settings.targetSamples = targetSpp;
+    ReprojectionCache cache(renderer, cam, pool, TILE_SIZE, settings);
+
+    std::printf("%dx%d, %d spheres, %d frames, %d spp target, %u threads, references at %d spp\n\n",
+                width, height, sphereCount, frames, targetSpp, threads, referenceSpp);
+    std::printf("%5s %12s %10s %12s %10s %8s %8s\n", "frame", "scratch ms", "rmse", "reproject ms", "rmse", "kept",
+                "spp");
+
+    double scratchSeconds = 0.0, reprojectSeconds = 0.0, scratchError = 0.0, reprojectError = 0.0;
+    std::vector<glm::vec3> reference, scratch, reprojected;
+    for (int f = 0; f < frames; f++) {
+        path.apply(path.getEndTime() * f / std::max(frames - 1, 1), cam);
+        renderScratch(renderer, pool, tiles, referenceSpp, reference);
+
+        auto start = std::chrono::steady_clock::now();
+        renderScratch(renderer, pool, tiles, targetSpp, scratch);
+        double scratchTime = secondsSince(start);
+
+        start = std::chrono::steady_clock::now();
+        ReprojectionStats stats;
+        cache.render(reprojected, stats);
+        double reprojectTime = secondsSince(start);
+
+        double scratchRmse = rmse(scratch, reference), reprojectRmse = rmse(reprojected, reference);
+        std::printf("%5d %12.2f %10.5f %12.2f %10.5f %7.1f%% %8.2f\n", f, scratchTime * 1000.0, scratchRmse,
+                    reprojectTime * 1000.0, reprojectRmse, 100.0 * stats.kept / stats.pixels,
+                    (double)stats.samples / stats.pixels);
+        // The first frame has no history and costs the same either way
+        if (f > 0) {
+            scratchSeconds += scratchTime;
+            reprojectSeconds += reprojectTime;
+            scratchError += scratchRmse;
+            reprojectError += reprojectRmse;
+        }
+    }
+    if (frames > 1) {
+        int n = frames - 1;
+        std::printf("\nafter the first frame: from scratch %.2f frames/s at rmse %.5f, reprojected %.2f frames/s at "
+                    "rmse %.5f\n", n / scratchSeconds, scratchError / n, n / reprojectSeconds, reprojectError / n);
+    }
+    return 0;
+}
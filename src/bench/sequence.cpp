@@ -0,0 +1,133 @@
+// Frames per second of a camera animation rendered three ways: every frame
+// set up from scratch (renderer and BVH, threads, buffers) and written before
+// the next, as running the program once per frame would; SequenceRenderer
+// with everything kept across frames but writing in line; and the same with
+// writing pipelined behind the next frame's tracing. All three must produce
+// the same files.
+//
+//   make bench && ./bench/sequence [width] [height] [sphereCount] [frames] [outputDir]
+
+#include "camera_path.hpp"
+#include "sequence.hpp"
+#include "tile_pool.hpp"
+#include "tonemap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define FOV 90
+#define TILE_SIZE 32
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::string readFile(const std::string &path){
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// One frame the way a single-frame run makes it, nothing reused
+static bool renderStandalone(const std::vector<Sphere> &spheres, const CameraKeyframe &pose, int width, int height,
+                             unsigned threads, const std::string &path){
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(pose.position, axis, FOV, (float)width / height);
+    cam.setOrientation(pose.orientation);
+    Renderer renderer(cam, spheres, glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)), width, height);
+    std::vector<Tile> tiles = makeTiles(width, height, TILE_SIZE);
+    std::vector<glm::vec3> frame((size_t)width * height);
+    forEachTile(tiles.size(), threads, [&](size_t i){
+        const Tile &tile = tiles[i];
+        std::vector<glm::vec3> pixels((size_t)tile.width * tile.height);
+        renderer.renderTile(tile, pixels.data());
+        for (int y = 0; y < tile.height; y++)
+            std::copy_n(&pixels[(size_t)y * tile.width], tile.width, &frame[(size_t)(tile.y0 + y) * width + tile.x0]);
+    });
+    std::vector<unsigned char> bytes(frame.size() * 3);
+    tonemapImage(&frame[0].r, bytes.data(), width, height, TonemapSettings(), 1);
+    std::FILE *out = std::fopen(path.c_str(), "wb");
+    if (!out)
+        return false;
+    std::fprintf(out, "P6\n%d %d\n255\n", width, height);
+    bool ok = std::fwrite(bytes.data(), 1, bytes.size(), out) == bytes.size();
+    return std::fclose(out) == 0 && ok;
+}
+
+int main(int argc, char **argv){
+    int width = argc > 1 ? std::atoi(argv[1]) : 640;
+    int height = argc > 2 ? std::atoi(argv[2]) : 480;
+    int sphereCount = argc > 3 ? std::atoi(argv[3]) : 100000;
+    int frames = argc > 4 ? std::atoi(argv[4]) : 24;
+    std::string dir = argc > 5 ? argv[5] : ".";
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> xy(-20.0f, 20.0f), depth(5.0f, 45.0f), radius(0.2f, 0.6f);
+    std::vector<Sphere> spheres;
+    for (int i = 0; i < sphereCount; i++)
+        spheres.push_back(Sphere(glm::vec3(xy(rng), xy(rng), depth(rng)), radius(rng)));
+
+    // A dolly into the field of spheres, turning left and then right
+    const glm::vec3 up(0.0f, 1.0f, 0.0f);
+    CameraPath path;
+    path.addKeyframe({0.0f, glm::vec3(0.0f, 0.0f, -10.0f), lookRotation(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), up)});
+    path.addKeyframe({1.0f, glm::vec3(-5.0f, 2.0f, 5.0f), lookRotation(glm::vec3(0.0f), glm::vec3(-1.0f, 0.2f, 1.0f), up)});
+    path.addKeyframe({2.0f, glm::vec3(5.0f, -2.0f, 15.0f), lookRotation(glm::vec3(0.0f), glm::vec3(1.0f, -0.2f, 1.0f), up)});
+
+    std::printf("%dx%d, %d spheres, %d frames, %u threads\n", width, height, sphereCount, frames, threads);
+
+    auto start = std::chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        float time = path.getEndTime() * f / std::max(frames - 1, 1);
+        if (!renderStandalone(spheres, path.evaluate(time), width, height, threads,
+                              sequenceFramePath(dir + "/sequence_standalone", f))) {
+            std::fprintf(stderr, "writing to %s failed\n", dir.c_str());
+            return 1;
+        }
+    }
+    double standalone = secondsSince(start);
+    std::printf("%-26s %8.3f s %8.2f frames/s\n", "set up per frame", standalone, frames / standalone);
+
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(glm::vec3(0.0f), axis, FOV, (float)width / height);
+    start = std::chrono::steady_clock::now();
+    Renderer renderer(cam, spheres, glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)), width, height);
+    TilePool pool(threads);
+    SequenceRenderer sequence(renderer, cam, pool, TILE_SIZE);
+    std::printf("%-26s %8.3f s, once\n", "scene, pool and buffers", secondsSince(start));
+
+    const char *names[2] = {"sequence_persistent", "sequence_pipelined"};
+    for (int pipelined = 0; pipelined < 2; pipelined++) {
+        sequence.setPipelined(pipelined != 0);
+        SequenceStats stats;
+        if (!sequence.render(path, frames, dir + "/" + names[pipelined], stats)) {
+            std::fprintf(stderr, "writing to %s failed\n", dir.c_str());
+            return 1;
+        }
+        std::printf("%-26s %8.3f s %8.2f frames/s: %.3f s tracing, %.3f s writing\n",
+                    pipelined ? "kept, writes pipelined" : "kept, writes in line", stats.seconds,
+                    frames / stats.seconds, stats.renderSeconds, stats.writeSeconds);
+    }
+
+    bool same = true;
+    for (int f = 0; f < frames; f++) {
+        std::string reference = readFile(sequenceFramePath(dir + "/sequence_standalone", f));
+        for (const char *name : names)
+            same = same && readFile(sequenceFramePath(dir + "/" + name, f)) == reference;
+        std::remove(sequenceFramePath(dir + "/sequence_standalone", f).c_str());
+        for (const char *name : names)
+            std::remove(sequenceFramePath(dir + "/" + name, f).c_str());
+    }
+    if (!same) {
+        std::fprintf(stderr, "sequence frames differ from standalone frames\n");
+        return 1;
+    }
+    return 0;
+}
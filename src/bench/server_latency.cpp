@@ -0,0 +1,138 @@
+// Latency of small successive renders: a fresh process per render (process
+// start, scene and BVH construction, render) against a render server that
+// keeps the scene loaded, reached over its Unix domain socket.
+//
+//   make bench && ./bench/server_latency [renders]
+
+#include "render_client.hpp"
+#include "render_server.hpp"
+#include "tonemap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#define FOV 90
+#define TILE_SIZE 32
+
+extern char **environ;
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static std::vector<Sphere> makeScene(int sphereCount){
+    std::vector<Sphere> spheres;
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> xy(-20.0f, 20.0f), depth(5.0f, 45.0f), radius(0.2f, 0.6f);
+    for (int i = 0; i < sphereCount; i++)
+        spheres.push_back(Sphere(glm::vec3(xy(rng), xy(rng), depth(rng)), radius(rng)));
+    return spheres;
+}
+
+static camAxis defaultAxis(){
+    return camAxis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+}
+
+// What a one-shot process does: build everything, render, convert, exit
+static int renderCold(int width, int height, int sphereCount){
+    std::vector<Sphere> spheres = makeScene(sphereCount);
+    Camera camera(glm::vec3(0.0f), defaultAxis(), FOV, (float)width / height);
+    Renderer renderer(camera, spheres, glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)), width, height);
+    std::vector<glm::vec3> pixels((size_t)width * height);
+    renderer.renderTile(Tile{0, 0, width, height}, pixels.data());
+    std::vector<unsigned char> bytes(pixels.size() * 3);
+    tonemapImage(&pixels[0].r, bytes.data(), width, height, TonemapSettings(), 1);
+    return bytes[bytes.size() / 2] == 0 ? 0 : 1;
+}
+
+struct Stats { double median, p90; };
+
+static Stats summarize(std::vector<double> times){
+    std::sort(times.begin(), times.end());
+    return Stats{times[times.size() / 2], times[times.size() * 9 / 10]};
+}
+
+int main(int argc, char **argv){
+    if (argc == 5 && std::strcmp(argv[1], "--cold") == 0) {
+        renderCold(std::atoi(argv[2]), std::atoi(argv[3]), std::atoi(argv[4]));
+        return 0;
+    }
+    int renders = argc > 1 ? std::max(3, std::atoi(argv[1])) : 30;
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+    std::string socketPath = "/tmp/raytracer_latency_" + std::to_string(getpid()) + ".sock";
+    RenderServer server(socketPath, threadCount);
+    if (!server.isOpen()) {
+        std::fprintf(stderr, "cannot listen on %s\n", socketPath.c_str());
+        return 1;
+    }
+    std::thread serverThread([&](){ server.serve(); });
+    RenderClient client(socketPath);
+    if (!client.isConnected()) {
+        std::fprintf(stderr, "%s\n", client.getError().c_str());
+        return 1;
+    }
+
+    std::printf("%d renders each, %u render threads in the server, milliseconds (median / p90)\n", renders, threadCount);
+    std::printf("%-8s %-10s %-21s %-21s %-21s\n", "spheres", "image", "new process", "server, same camera", "server, camera moved");
+    int sphereCounts[] = {3, 20000};
+    int sizes[] = {16, 64, 256};
+    bool ok = true;
+    for (int sphereCount : sphereCounts) {
+        std::vector<Sphere> spheres = makeScene(sphereCount);
+        ok = ok && client.setScene(spheres, glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)));
+        for (int size : sizes) {
+            std::vector<double> cold, warm, moved;
+            std::string w = std::to_string(size), n = std::to_string(sphereCount);
+            char *args[] = {(char *)"/proc/self/exe", (char *)"--cold", (char *)w.c_str(), (char *)w.c_str(),
+                            (char *)n.c_str(), nullptr};
+            for (int r = 0; r < renders; r++) {
+                auto start = std::chrono::steady_clock::now();
+                pid_t pid;
+                int status;
+                if (posix_spawn(&pid, "/proc/self/exe", nullptr, nullptr, args, environ) != 0
+                    || waitpid(pid, &status, 0) != pid) {
+                    std::fprintf(stderr, "spawn failed\n");
+                    return 1;
+                }
+                cold.push_back(secondsSince(start));
+            }
+
+            RenderRequest request{size, size, TILE_SIZE, 0};
+            std::vector<unsigned char> rgb;
+            ok = ok && client.setCamera(makeCameraState(glm::vec3(0.0f), defaultAxis(), FOV, 1.0f));
+            for (int r = 0; r < renders && ok; r++) {
+                auto start = std::chrono::steady_clock::now();
+                ok = client.render(request, rgb);
+                warm.push_back(secondsSince(start));
+            }
+            for (int r = 0; r < renders && ok; r++) {
+                auto start = std::chrono::steady_clock::now();
+                glm::vec3 position(0.01f * r, 0.0f, 0.0f);
+                ok = client.setCamera(makeCameraState(position, defaultAxis(), FOV, 1.0f)) && client.render(request, rgb);
+                moved.push_back(secondsSince(start));
+            }
+            if (!ok)
+                break;
+
+            Stats c = summarize(cold), s = summarize(warm), m = summarize(moved);
+            std::printf("%-8d %4dx%-5d %8.3f / %-10.3f %8.3f / %-10.3f %8.3f / %-10.3f\n", sphereCount, size, size,
+                        c.median * 1e3, c.p90 * 1e3, s.median * 1e3, s.p90 * 1e3, m.median * 1e3, m.p90 * 1e3);
+        }
+    }
+    if (!ok)
+        std::fprintf(stderr, "%s\n", client.getError().c_str());
+
+    client.shutdown();
+    serverThread.join();
+    return ok ? 0 : 1;
+}
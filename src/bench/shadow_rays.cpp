@@ -0,0 +1,122 @@
+// Shadow ray throughput against closest-hit throughput on a random sphere scene.
+//
+//   make bench && ./bench/shadow_rays [sphereCount]
+
+#include "bvh.hpp"
+#include "camera.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+#define IMAGEX 800
+#define IMAGEY 600
+#define FOV 90
+#define REPEATS 5
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char **argv){
+    int sphereCount = argc > 1 ? std::atoi(argv[1]) : 20000;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> xy(-20.0f, 20.0f), depth(5.0f, 45.0f), radius(0.2f, 0.6f);
+    std::vector<Sphere> spheres;
+    for (int i = 0; i < sphereCount; i++)
+        spheres.push_back(Sphere(glm::vec3(xy(rng), xy(rng), depth(rng)), radius(rng)));
+
+    auto buildStart = std::chrono::steady_clock::now();
+    BVH bvh(spheres);
+    std::printf("%d spheres, %zu BVH nodes, built in %.3f s\n", sphereCount, bvh.nodeCount(), secondsSince(buildStart));
+
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(glm::vec3(0.0f), axis, FOV, (float)IMAGEX / IMAGEY);
+    rtVec3 toLight = toRtVec3(glm::normalize(glm::vec3(-1.0f, 1.0f, -1.0f)));
+
+    std::vector<Ray> primary;
+    for (int y = 0; y < IMAGEY; y++)
+        for (int x = 0; x < IMAGEX; x++)
+            primary.push_back(cam.generateRay(x, y, IMAGEX, IMAGEY));
+
+    // Closest hit for every camera ray; the hits seed the shadow rays
+    std::vector<Ray> shadow;
+    double closestTime = 1e30;
+    for (int r = 0; r < REPEATS; r++) {
+        shadow.clear();
+        auto start = std::chrono::steady_clock::now();
+        for (const Ray &ray : primary) {
+            float t;
+            int index = -1;
+            if (bvh.intersect(ray, INFINITY, t, index)) {
+                rtVec3 p = ray.origin + ray.direction * t;
+                rtVec3 n = rtNormalize(p - spheres[index].getCenter());
+                shadow.push_back(Ray(p + n * 1e-3f, toLight));
+            }
+        }
+        closestTime = std::min(closestTime, secondsSince(start));
+    }
+
+    // Shadow rays answered with a closest-hit query, the way main.cpp did it before occluded()
+    int blockedClosest = 0;
+    double closestShadowTime = 1e30;
+    for (int r = 0; r < REPEATS; r++) {
+        blockedClosest = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const Ray &ray : shadow) {
+            float t;
+            int index;
+            blockedClosest += bvh.intersect(ray, INFINITY, t, index);
+        }
+        closestShadowTime = std::min(closestShadowTime, secondsSince(start));
+    }
+
+    int blockedAny = 0;
+    double anyTime = 1e30;
+    for (int r = 0; r < REPEATS; r++) {
+        blockedAny = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (const Ray &ray : shadow)
+            blockedAny += bvh.occluded(ray, INFINITY);
+        anyTime = std::min(anyTime, secondsSince(start));
+    }
+
+    int blockedPacket = 0;
+    double packetTime = 1e30;
+    const float tMax[4] = {INFINITY, INFINITY, INFINITY, INFINITY};
+    for (int r = 0; r < REPEATS; r++) {
+        blockedPacket = 0;
+        auto start = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < shadow.size(); i += 4) {
+            RayPacket4 packet;
+            int active = 0;
+            for (int lane = 0; lane < 4; lane++) {
+                const Ray &ray = shadow[i + lane < shadow.size() ? i + lane : i];
+                packet.set(lane, ray);
+                if (i + lane < shadow.size())
+                    active |= 1 << lane;
+            }
+            int mask = bvh.occluded4(packet, tMax, active);
+            blockedPacket += __builtin_popcount(mask & active);
+        }
+        packetTime = std::min(packetTime, secondsSince(start));
+    }
+
+    std::printf("%zu primary rays, %zu shadow rays\n", primary.size(), shadow.size());
+    std::printf("closest hit (primary):     %8.2f Mrays/s\n", primary.size() / closestTime * 1e-6);
+    std::printf("shadow via closest hit:    %8.2f Mrays/s (%d blocked)\n", shadow.size() / closestShadowTime * 1e-6, blockedClosest);
+    std::printf("shadow via occluded:       %8.2f Mrays/s (%d blocked)\n", shadow.size() / anyTime * 1e-6, blockedAny);
+    std::printf("shadow via occluded4:      %8.2f Mrays/s (%d blocked)\n", shadow.size() / packetTime * 1e-6, blockedPacket);
+
+    // The packet kernel assumes unit directions, so grazing rays may round differently
+    if (blockedAny != blockedClosest) {
+        std::fprintf(stderr, "occluded() disagrees with intersect()\n");
+        return 1;
+    }
+    if (blockedPacket != blockedAny)
+        std::printf("occluded4 differs from occluded on %d rays (rounding)\n", std::abs(blockedPacket - blockedAny));
+    return 0;
+}
@@ -0,0 +1,117 @@
+// Tone mapping stage: accuracy of the fast sRGB paths against std::pow and
+// throughput of each setting on a 4K frame of random radiance.
+//
+//   make bench && ./bench/tonemap [width] [height]
+
+#include "image_writer.hpp"
+#include "tonemap.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <thread>
+#include <vector>
+
+#define REPEATS 5
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename Work>
+static double bestTime(Work work){
+    double best = 1e30;
+    for (int r = 0; r < REPEATS; r++) {
+        auto start = std::chrono::steady_clock::now();
+        work();
+        best = std::min(best, secondsSince(start));
+    }
+    return best;
+}
+
+static TonemapSettings settings(ToneCurve curve, OutputTransfer transfer, bool dither){
+    TonemapSettings s;
+    s.curve = curve;
+    s.transfer = transfer;
+    s.dither = dither;
+    return s;
+}
+
+int main(int argc, char **argv){
+    int width = argc > 1 ? std::atoi(argv[1]) : 3840;
+    int height = argc > 2 ? std::atoi(argv[2]) : 2160;
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
+    std::printf("kernels dispatched to %s, %u hardware threads\n", tonemapIsa(), threadCount);
+
+    // Accuracy: every float in [0,1] through the fast sRGB paths and the std::pow reference
+    const size_t chunk = 3 << 20;
+    std::vector<float> values(chunk);
+    std::vector<unsigned char> exact(chunk), fast(chunk), lut(chunk);
+    uint64_t fastDiffers = 0, lutDiffers = 0;
+    int fastWorst = 0, lutWorst = 0;
+    const uint32_t one = 0x3f800000;
+    for (uint64_t base = 0; base <= one; base += chunk) {
+        size_t count = (size_t)std::min<uint64_t>(chunk, one + 1 - base);
+        for (size_t i = 0; i < count; i++) {
+            uint32_t bits = (uint32_t)(base + i);
+            std::memcpy(&values[i], &bits, sizeof(float));
+        }
+        size_t pixels = (count + 2) / 3;
+        tonemapRow(values.data(), exact.data(), pixels, 0, 0, settings(ToneCurve::None, OutputTransfer::SRGBExact, false));
+        tonemapRow(values.data(), fast.data(), pixels, 0, 0, settings(ToneCurve::None, OutputTransfer::SRGB, false));
+        tonemapRow(values.data(), lut.data(), pixels, 0, 0, settings(ToneCurve::None, OutputTransfer::SRGBLut, false));
+        for (size_t i = 0; i < count; i++) {
+            int f = std::abs(fast[i] - exact[i]), l = std::abs(lut[i] - exact[i]);
+            fastDiffers += f != 0;
+            lutDiffers += l != 0;
+            fastWorst = std::max(fastWorst, f);
+            lutWorst = std::max(lutWorst, l);
+        }
+    }
+    std::printf("all %u floats in [0,1] against std::pow:\n", one + 1);
+    std::printf("  sRGB approximation  %10llu differ, by at most %d\n", (unsigned long long)fastDiffers, fastWorst);
+    std::printf("  sRGB table          %10llu differ, by at most %d\n", (unsigned long long)lutDiffers, lutWorst);
+
+    // Throughput on a frame of radiance, mostly below 1 with a bright tail for the curves
+    std::mt19937 rng(7);
+    std::exponential_distribution<float> radiance(2.0f);
+    std::vector<float> frame((size_t)width * height * 3);
+    for (float &v : frame)
+        v = radiance(rng);
+    std::vector<unsigned char> bytes(frame.size());
+    double inputBytes = (double)frame.size() * sizeof(float);
+    std::printf("%dx%d frame, %.1f MB of float RGB in, GB/s of input:\n", width, height, inputBytes / 1e6);
+    std::printf("  %-34s %8s %8s\n", "", "1 thread", threadCount > 1 ? "all" : "");
+
+    // What the writers did before: toByte per channel
+    double t = bestTime([&](){
+        for (size_t i = 0; i < frame.size(); i++)
+            bytes[i] = toByte(frame[i]);
+    });
+    std::printf("  %-34s %8.2f\n", "toByte loop (scalar reference)", inputBytes / t * 1e-9);
+
+    struct Case { const char *name; TonemapSettings s; } cases[] = {
+        {"linear", settings(ToneCurve::None, OutputTransfer::Linear, false)},
+        {"gamma 2", settings(ToneCurve::None, OutputTransfer::Gamma2, false)},
+        {"sRGB std::pow", settings(ToneCurve::None, OutputTransfer::SRGBExact, false)},
+        {"sRGB approximation", settings(ToneCurve::None, OutputTransfer::SRGB, false)},
+        {"sRGB table", settings(ToneCurve::None, OutputTransfer::SRGBLut, false)},
+        {"Reinhard + sRGB", settings(ToneCurve::Reinhard, OutputTransfer::SRGB, false)},
+        {"ACES + sRGB", settings(ToneCurve::ACES, OutputTransfer::SRGB, false)},
+        {"ACES + sRGB + dither", settings(ToneCurve::ACES, OutputTransfer::SRGB, true)},
+        {"ACES + gamma 2 + dither", settings(ToneCurve::ACES, OutputTransfer::Gamma2, true)},
+    };
+    for (const Case &c : cases) {
+        double single = bestTime([&](){ tonemapImage(frame.data(), bytes.data(), width, height, c.s, 1); });
+        if (threadCount > 1) {
+            double all = bestTime([&](){ tonemapImage(frame.data(), bytes.data(), width, height, c.s, threadCount); });
+            std::printf("  %-34s %8.2f %8.2f\n", c.name, inputBytes / single * 1e-9, inputBytes / all * 1e-9);
+        } else {
+            std::printf("  %-34s %8.2f\n", c.name, inputBytes / single * 1e-9);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,125 @@
+// Cycles per ray spent in BVH::intersect and BVH::occluded, for camera rays
+// and for diffuse bounce rays leaving the visible surfaces, which point every
+// which way. The hit count and distance sum let two builds be checked for
+// the same answers.
+//
+//   make bench && ./bench/traversal [sphereCount]
+
+#include "bvh.hpp"
+#include "camera.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#define IMAGEX 800
+#define IMAGEY 600
+#define FOV 90
+#define REPEATS 7
+
+// Timestamp counter where there is one, nanoseconds otherwise
+static unsigned long long cycleCount(){
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct Timing {
+    double cyclesPerRay;
+    long hits;
+    double tSum;
+};
+
+static Timing timeIntersect(const BVH &bvh, const std::vector<Ray> &rays, int repeats){
+    Timing timing{1e30, 0, 0.0};
+    for (int r = 0; r < repeats; r++) {
+        long hits = 0;
+        double tSum = 0.0;
+        unsigned long long start = cycleCount();
+        for (const Ray &ray : rays) {
+            float t;
+            int index;
+            if (bvh.intersect(ray, INFINITY, t, index)) {
+                hits++;
+                tSum += t;
+            }
+        }
+        timing.cyclesPerRay = std::min(timing.cyclesPerRay, (double)(cycleCount() - start) / rays.size());
+        timing.hits = hits;
+        timing.tSum = tSum;
+    }
+    return timing;
+}
+
+static Timing timeOccluded(const BVH &bvh, const std::vector<Ray> &rays, int repeats){
+    Timing timing{1e30, 0, 0.0};
+    for (int r = 0; r < repeats; r++) {
+        long hits = 0;
+        unsigned long long start = cycleCount();
+        for (const Ray &ray : rays)
+            hits += bvh.occluded(ray, INFINITY);
+        timing.cyclesPerRay = std::min(timing.cyclesPerRay, (double)(cycleCount() - start) / rays.size());
+        timing.hits = hits;
+    }
+    return timing;
+}
+
+int main(int argc, char **argv){
+    int sphereCount = argc > 1 ? std::atoi(argv[1]) : 20000;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> xy(-20.0f, 20.0f), depth(5.0f, 45.0f), radius(0.2f, 0.6f);
+    std::vector<Sphere> spheres;
+    for (int i = 0; i < sphereCount; i++)
+        spheres.push_back(Sphere(glm::vec3(xy(rng), xy(rng), depth(rng)), radius(rng)));
+    BVH bvh(spheres);
+
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    Camera cam(glm::vec3(0.0f), axis, FOV, (float)IMAGEX / IMAGEY);
+
+    std::vector<Ray> primary;
+    for (int y = 0; y < IMAGEY; y++)
+        for (int x = 0; x < IMAGEX; x++)
+            primary.push_back(cam.generateRay(x, y, IMAGEX, IMAGEY));
+
+    // One cosine-weighted bounce from every visible hit point
+    std::vector<Ray> bounce;
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    for (const Ray &ray : primary) {
+        float t;
+        int index;
+        if (!bvh.intersect(ray, INFINITY, t, index))
+            continue;
+        rtVec3 p = ray.origin + ray.direction * t;
+        rtVec3 n = rtNormalize(p - spheres[index].getCenter());
+        glm::vec3 v;
+        do {
+            v = glm::vec3(unit(rng), unit(rng), unit(rng));
+        } while (glm::dot(v, v) > 1.0f || glm::dot(v, v) < 1e-6f);
+        bounce.push_back(Ray(p + n * 1e-3f, n + toRtVec3(glm::normalize(v))));
+    }
+
+    std::printf("%d spheres, %zu BVH nodes, %zu camera rays, %zu bounce rays\n\n",
+                sphereCount, bvh.nodeCount(), primary.size(), bounce.size());
+    std::printf("%-10s %-10s %12s %10s %16s\n", "rays", "query", "cycles/ray", "hits", "t sum");
+
+    const struct { const char *name; const std::vector<Ray> *rays; } sets[] = {
+        {"camera", &primary}, {"bounce", &bounce},
+    };
+    for (const auto &set : sets) {
+        Timing closest = timeIntersect(bvh, *set.rays, REPEATS);
+        Timing any = timeOccluded(bvh, *set.rays, REPEATS);
+        std::printf("%-10s %-10s %12.1f %10ld %16.6e\n", set.name, "intersect", closest.cyclesPerRay,
+                    closest.hits, closest.tSum);
+        std::printf("%-10s %-10s %12.1f %10ld\n", set.name, "occluded", any.cyclesPerRay, any.hits);
+    }
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef BOUNDED_QUEUE_HPP
+#define BOUNDED_QUEUE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Fixed-capacity multi-producer multi-consumer queue after Dmitry Vyukov's
+// bounded MPMC design. Each cell carries a sequence number telling producers
+// and consumers whose turn it is, so push and pop are a single CAS on the
+// head or tail and never take a lock. Both return false instead of waiting.
+template <typename T>
+class BoundedQueue {
+    private:
+        struct Cell {
+            std::atomic<size_t> sequence;
+            T data;
+        };
+
+        // Keep the producer and consumer counters on separate cache lines
+        alignas(64) std::vector<Cell> cells;
+        size_t mask;
+        alignas(64) std::atomic<size_t> enqueuePos{0};
+        alignas(64) std::atomic<size_t> dequeuePos{0};
+
+    public:
+        // Capacity is rounded up to a power of two
+        explicit BoundedQueue(size_t capacity){
+            size_t size = 2;
+            while (size < capacity)
+                size *= 2;
+            cells = std::vector<Cell>(size);
+            for (size_t i = 0; i < size; i++)
+                cells[i].sequence.store(i, std::memory_order_relaxed);
+            mask = size - 1;
+        }
+
+        BoundedQueue(const BoundedQueue &) = delete;
+        BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+        bool push(T &&value){
+            size_t pos = enqueuePos.load(std::memory_order_relaxed);
+            Cell *cell;
+            while (true) {
+                cell = &cells[pos & mask];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+                if (diff == 0) {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (diff < 0) {
+                    return false; // full
+                } else {
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+            cell->data = std::move(value);
+            cell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        bool pop(T &value){
+            size_t pos = dequeuePos.load(std::memory_order_relaxed);
+            Cell *cell;
+            while (true) {
+                cell = &cells[pos & mask];
+                size_t seq = cell->sequence.load(std::memory_order_acquire);
+                intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+                if (diff == 0) {
+                    if (dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (diff < 0) {
+                    return false; // empty
+                } else {
+                    pos = dequeuePos.load(std::memory_order_relaxed);
+                }
+            }
+            value = std::move(cell->data);
+            cell->sequence.store(pos + mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        size_t capacity() const { return mask + 1; }
+};
+
+#endif // BOUNDED_QUEUE_HPP
@@ -0,0 +1,330 @@
+#include "bvh.hpp"
+#include "multiversion.hpp"
+#include "simd.hpp"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+
+#define BVH_MAX_LEAF_SIZE 4
+#define BVH_STACK_SIZE 64
+
+BVH::BVH(const std::vector<Sphere> &input){
+    int n = (int)input.size();
+    sphereIds.resize(n);
+    std::iota(sphereIds.begin(), sphereIds.end(), 0);
+
+    nodes.reserve(n > 0 ? 2 * n : 1);
+    nodes.push_back(BVHNode{glm::vec3(0.0f), 0, glm::vec3(0.0f), 0});
+    spheres = input;
+    if (n > 0)
+        subdivide(0, 0, n);
+
+    // Store the spheres in leaf order so traversal walks memory linearly
+    spheres.clear();
+    spheres.reserve(n);
+    for (int id : sphereIds)
+        spheres.push_back(input[id]);
+}
+
+void BVH::subdivide(int nodeIndex, int first, int count){
+    glm::vec3 boundsMin(INFINITY), boundsMax(-INFINITY);
+    glm::vec3 centroidMin(INFINITY), centroidMax(-INFINITY);
+    for (int i = first; i < first + count; i++) {
+        const Sphere &s = spheres[sphereIds[i]];
+        glm::vec3 c = toVec3(s.getCenter()), r(s.getRadius());
+        boundsMin = glm::min(boundsMin, c - r);
+        boundsMax = glm::max(boundsMax, c + r);
+        centroidMin = glm::min(centroidMin, c);
+        centroidMax = glm::max(centroidMax, c);
+    }
+    nodes[nodeIndex].boundsMin = boundsMin;
+    nodes[nodeIndex].boundsMax = boundsMax;
+    nodes[nodeIndex].leftFirst = first;
+    nodes[nodeIndex].count = count;
+
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = 0;
+    if (extent.y > extent.x) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+    if (count <= BVH_MAX_LEAF_SIZE || extent[axis] <= 0.0f)
+        return;
+
+    // Object median split along the widest centroid axis
+    int mid = first + count / 2;
+    std::nth_element(sphereIds.begin() + first, sphereIds.begin() + mid, sphereIds.begin() + first + count,
+                     [&](int a, int b){ return spheres[a].getCenter()[axis] < spheres[b].getCenter()[axis]; });
+
+    int left = (int)nodes.size();
+    nodes.push_back(BVHNode());
+    nodes.push_back(BVHNode());
+    nodes[nodeIndex].leftFirst = left;
+    nodes[nodeIndex].count = 0;
+
+    subdivide(left, first, mid - first);
+    subdivide(left + 1, mid, first + count - mid);
+}
+
+void BVH::update(int index, const Sphere &sphere){
+    auto slot = std::find(sphereIds.begin(), sphereIds.end(), index);
+    if (slot == sphereIds.end())
+        return;
+    spheres[slot - sphereIds.begin()] = sphere;
+
+    // Children always come after their parent, so a reverse sweep sees both
+    // children of a node before the node itself
+    for (int n = (int)nodes.size() - 1; n >= 0; n--) {
+        BVHNode &node = nodes[n];
+        if (node.isLeaf()) {
+            node.boundsMin = glm::vec3(INFINITY);
+            node.boundsMax = glm::vec3(-INFINITY);
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                glm::vec3 c = toVec3(spheres[i].getCenter()), r(spheres[i].getRadius());
+                node.boundsMin = glm::min(node.boundsMin, c - r);
+                node.boundsMax = glm::max(node.boundsMax, c + r);
+            }
+        } else {
+            const BVHNode &left = nodes[node.leftFirst], &right = nodes[node.leftFirst + 1];
+            node.boundsMin = glm::min(left.boundsMin, right.boundsMin);
+            node.boundsMax = glm::max(left.boundsMax, right.boundsMax);
+        }
+    }
+}
+
+// Bits 0, 1 and 2 set where the x, y and z of the ray direction are negative
+static int directionOctant(const glm::vec3 &invDir){
+    return (int)std::signbit(invDir.x) | (int)std::signbit(invDir.y) << 1 | (int)std::signbit(invDir.z) << 2;
+}
+
+// Entry distance of the ray into the node box, or INFINITY on a miss. The
+// octant fixes which face of each slab the ray meets first, so the near and
+// far distances need no min and max per axis. Fused kernels pass slabOrigin =
+// origin * invDir, precomputed per ray, and each distance is then a single
+// fused multiply-add; the others pass the origin and subtract it first.
+template <int Octant, bool Fused>
+static ALWAYS_INLINE float slabEntry(const BVHNode &node, const glm::vec3 &invDir, const glm::vec3 &slabOrigin,
+                                     float tMax){
+    glm::vec3 nearFace((Octant & 1) ? node.boundsMax.x : node.boundsMin.x,
+                       (Octant & 2) ? node.boundsMax.y : node.boundsMin.y,
+                       (Octant & 4) ? node.boundsMax.z : node.boundsMin.z);
+    glm::vec3 farFace((Octant & 1) ? node.boundsMin.x : node.boundsMax.x,
+                      (Octant & 2) ? node.boundsMin.y : node.boundsMax.y,
+                      (Octant & 4) ? node.boundsMin.z : node.boundsMax.z);
+    glm::vec3 tNear, tFar;
+    if (Fused) {
+        tNear = glm::vec3(std::fma(nearFace.x, invDir.x, -slabOrigin.x), std::fma(nearFace.y, invDir.y, -slabOrigin.y),
+                          std::fma(nearFace.z, invDir.z, -slabOrigin.z));
+        tFar = glm::vec3(std::fma(farFace.x, invDir.x, -slabOrigin.x), std::fma(farFace.y, invDir.y, -slabOrigin.y),
+                         std::fma(farFace.z, invDir.z, -slabOrigin.z));
+    } else {
+        tNear = (nearFace - slabOrigin) * invDir;
+        tFar = (farFace - slabOrigin) * invDir;
+    }
+    // glm::max and min pass values; std::max returns a reference, which GCC
+    // turned into a store and a branch per axis here
+    float tEnter = glm::max(glm::max(tNear.x, tNear.y), glm::max(tNear.z, 0.0f));
+    float tExit = glm::min(glm::min(tFar.x, tFar.y), glm::min(tFar.z, tMax));
+    return tEnter <= tExit ? tEnter : INFINITY;
+}
+
+// Traversal kernels, built once per instruction set (multiversion.hpp), once
+// per direction octant and once per slab form. The BVH methods at the end of
+// the file pick the octant of each ray and forward to them, to the fused
+// kernels where multiversionHasFma() says std::fma is one instruction and to
+// the plain ones elsewhere, where it would be a call to fmaf per slab. The
+// two forms round differently, so box tests can differ in the last bit
+// between CPUs with and without FMA; hits and distances come from the sphere
+// tests, which are the same everywhere.
+
+template <int Octant, bool Fused>
+MULTIVERSION
+static bool intersectNodes(const BVHNode *nodes, const Sphere *spheres, const int *sphereIds, const Ray &ray,
+                           float tMax, float &t, int &index){
+    glm::vec3 invDir = ray.invDirection;
+    glm::vec3 slabOrigin = Fused ? toVec3(ray.origin) * invDir : toVec3(ray.origin);
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    int nodeIndex = 0;
+    bool hit = false;
+
+    if (slabEntry<Octant, Fused>(nodes[0], invDir, slabOrigin, tMax) == INFINITY)
+        return false;
+
+    while (true) {
+        const BVHNode &node = nodes[nodeIndex];
+        if (node.isLeaf()) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                float tHit;
+                if (spheres[i].intersect(ray, tHit) && tHit < tMax) {
+                    tMax = tHit;
+                    index = sphereIds[i];
+                    hit = true;
+                }
+            }
+        } else {
+            int near = node.leftFirst, far = node.leftFirst + 1;
+            float tNear = slabEntry<Octant, Fused>(nodes[near], invDir, slabOrigin, tMax);
+            float tFar = slabEntry<Octant, Fused>(nodes[far], invDir, slabOrigin, tMax);
+            if (tFar < tNear) {
+                std::swap(near, far);
+                std::swap(tNear, tFar);
+            }
+            if (tNear != INFINITY) {
+                if (tFar != INFINITY)
+                    stack[stackSize++] = far;
+                nodeIndex = near;
+                continue;
+            }
+        }
+
+        // Pop, skipping nodes that start beyond the closest hit found so far
+        nodeIndex = -1;
+        while (stackSize > 0) {
+            int candidate = stack[--stackSize];
+            if (slabEntry<Octant, Fused>(nodes[candidate], invDir, slabOrigin, tMax) != INFINITY) {
+                nodeIndex = candidate;
+                break;
+            }
+        }
+        if (nodeIndex < 0)
+            break;
+    }
+
+    if (hit)
+        t = tMax;
+    return hit;
+}
+
+template <int Octant, bool Fused>
+MULTIVERSION
+static bool occludedNodes(const BVHNode *nodes, const Sphere *spheres, const Ray &ray, float tMax){
+    glm::vec3 invDir = ray.invDirection;
+    glm::vec3 slabOrigin = Fused ? toVec3(ray.origin) * invDir : toVec3(ray.origin);
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const BVHNode &node = nodes[stack[--stackSize]];
+        if (slabEntry<Octant, Fused>(node, invDir, slabOrigin, tMax) == INFINITY)
+            continue;
+
+        if (node.isLeaf()) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                float tHit;
+                if (spheres[i].intersect(ray, tHit) && tHit < tMax)
+                    return true;
+            }
+        } else {
+            stack[stackSize++] = node.leftFirst + 1;
+            stack[stackSize++] = node.leftFirst;
+        }
+    }
+    return false;
+}
+
+typedef bool (*IntersectKernel)(const BVHNode *, const Sphere *, const int *, const Ray &, float, float &, int &);
+typedef bool (*OccludedKernel)(const BVHNode *, const Sphere *, const Ray &, float);
+
+// Indexed by octant; the second half of each table holds the fused kernels
+static const IntersectKernel intersectKernels[16] = {
+    intersectNodes<0, false>, intersectNodes<1, false>, intersectNodes<2, false>, intersectNodes<3, false>,
+    intersectNodes<4, false>, intersectNodes<5, false>, intersectNodes<6, false>, intersectNodes<7, false>,
+    intersectNodes<0, true>, intersectNodes<1, true>, intersectNodes<2, true>, intersectNodes<3, true>,
+    intersectNodes<4, true>, intersectNodes<5, true>, intersectNodes<6, true>, intersectNodes<7, true>,
+};
+static const OccludedKernel occludedKernels[16] = {
+    occludedNodes<0, false>, occludedNodes<1, false>, occludedNodes<2, false>, occludedNodes<3, false>,
+    occludedNodes<4, false>, occludedNodes<5, false>, occludedNodes<6, false>, occludedNodes<7, false>,
+    occludedNodes<0, true>, occludedNodes<1, true>, occludedNodes<2, true>, occludedNodes<3, true>,
+    occludedNodes<4, true>, occludedNodes<5, true>, occludedNodes<6, true>, occludedNodes<7, true>,
+};
+
+// Offset of the kernels to use in the tables above
+static int kernelSet(){
+    static const int offset = multiversionHasFma() ? 8 : 0;
+    return offset;
+}
+
+MULTIVERSION
+static int occluded4Nodes(const BVHNode *nodes, const Sphere *spheres, const RayPacket4 &packet, const float tMax[4],
+                          int activeMask){
+    float4 ox = float4::load(packet.ox), oy = float4::load(packet.oy), oz = float4::load(packet.oz);
+    float4 dx = float4::load(packet.dx), dy = float4::load(packet.dy), dz = float4::load(packet.dz);
+    // Inverse directions as Ray has them (safeReciprocal): a zero component
+    // would give 0 * inf = NaN in the slab test for an origin on a box plane
+    float inverse[3][4];
+    for (int i = 0; i < 4; i++) {
+        glm::vec3 r = safeReciprocal(glm::vec3(packet.dx[i], packet.dy[i], packet.dz[i]));
+        inverse[0][i] = r.x;
+        inverse[1][i] = r.y;
+        inverse[2][i] = r.z;
+    }
+    float4 idx = float4::load(inverse[0]), idy = float4::load(inverse[1]), idz = float4::load(inverse[2]);
+    float4 tLimit = float4::load(tMax);
+    float4 zero(0.0f);
+
+    int occludedMask = 0;
+    int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const BVHNode &node = nodes[stack[--stackSize]];
+
+        // Slab test for all four rays against the node box at once
+        float4 tx0 = (float4(node.boundsMin.x) - ox) * idx, tx1 = (float4(node.boundsMax.x) - ox) * idx;
+        float4 ty0 = (float4(node.boundsMin.y) - oy) * idy, ty1 = (float4(node.boundsMax.y) - oy) * idy;
+        float4 tz0 = (float4(node.boundsMin.z) - oz) * idz, tz1 = (float4(node.boundsMax.z) - oz) * idz;
+        float4 tEnter = max(max(min(tx0, tx1), min(ty0, ty1)), max(min(tz0, tz1), zero));
+        float4 tExit = min(min(max(tx0, tx1), max(ty0, ty1)), min(max(tz0, tz1), tLimit));
+        int live = (tEnter <= tExit).bits() & activeMask & ~occludedMask;
+        if (!live)
+            continue;
+
+        if (node.isLeaf()) {
+            for (int i = node.leftFirst; i < node.leftFirst + node.count; i++) {
+                // The robust solve of intersectSphere (intersect.hpp); any root in range occludes
+                const rtVec3 &c = spheres[i].getCenter();
+                float r = spheres[i].getRadius();
+                float4 ocx = ox - float4(c.x), ocy = oy - float4(c.y), ocz = oz - float4(c.z);
+                float4 b = ocx * dx + ocy * dy + ocz * dz;
+                float4 lx = ocx - b * dx, ly = ocy - b * dy, lz = ocz - b * dz;
+                float4 disc = float4(r * r) - (lx * lx + ly * ly + lz * lz);
+                float4 cc = ocx * ocx + ocy * ocy + ocz * ocz - float4(r * r);
+                float4 sqrtD = sqrt(max(disc, zero));
+                float4 q = select(b < zero, sqrtD - b, zero - b - sqrtD);
+                float4 absQ = max(q, zero - q);
+                float4 t0 = min(max(cc / q, zero - absQ), absQ);
+                float4 t1 = q;
+                mask4 hit = (disc >= zero) & (((t0 > zero) & (t0 < tLimit)) | ((t1 > zero) & (t1 < tLimit)));
+                occludedMask |= hit.bits() & live;
+            }
+            if ((occludedMask & activeMask) == activeMask)
+                return occludedMask;
+        } else {
+            stack[stackSize++] = node.leftFirst + 1;
+            stack[stackSize++] = node.leftFirst;
+        }
+    }
+    return occludedMask;
+}
+
+bool BVH::intersect(const Ray &ray, float tMax, float &t, int &index) const{
+    if (spheres.empty())
+        return false;
+    IntersectKernel kernel = intersectKernels[kernelSet() + directionOctant(ray.invDirection)];
+    return kernel(nodes.data(), spheres.data(), sphereIds.data(), ray, tMax, t, index);
+}
+
+bool BVH::occluded(const Ray &ray, float tMax) const{
+    if (spheres.empty())
+        return false;
+    OccludedKernel kernel = occludedKernels[kernelSet() + directionOctant(ray.invDirection)];
+    return kernel(nodes.data(), spheres.data(), ray, tMax);
+}
+
+int BVH::occluded4(const RayPacket4 &packet, const float tMax[4], int activeMask) const{
+    if (spheres.empty() || activeMask == 0)
+        return 0;
+    return occluded4Nodes(nodes.data(), spheres.data(), packet, tMax, activeMask);
+}
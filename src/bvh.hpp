@@ -0,0 +1,51 @@
+#ifndef BVH_HPP
+#define BVH_HPP
+
+#include "glm/glm.hpp"
+#include "ray.hpp"
+#include "sphere.hpp"
+#include <vector>
+
+struct BVHNode {
+    glm::vec3 boundsMin;
+    int leftFirst;   // left child for interior nodes (right is leftFirst + 1), first sphere for leaves
+    glm::vec3 boundsMax;
+    int count;       // number of spheres in a leaf, 0 for interior nodes
+
+    bool isLeaf() const { return count > 0; }
+};
+
+class BVH {
+    private:
+        std::vector<BVHNode> nodes;
+        std::vector<Sphere> spheres;   // reordered so every leaf owns a contiguous range
+        std::vector<int> sphereIds;    // index of each reordered sphere in the input list
+
+        void subdivide(int nodeIndex, int first, int count);
+
+    public:
+        explicit BVH(const std::vector<Sphere> &input);
+
+        // Closest hit along the ray in (0, tMax). Visits the nearer child first
+        // and reports the input index of the sphere that was hit.
+        bool intersect(const Ray &ray, float tMax, float &t, int &index) const;
+
+        // Any hit along the ray in (0, tMax). Returns on the first hit found and
+        // never orders children or computes hit data, so it is the query to use
+        // for shadow rays.
+        bool occluded(const Ray &ray, float tMax) const;
+
+        // Packet version of occluded(). Only lanes set in activeMask are traced;
+        // returns a mask with a bit set for every occluded lane.
+        int occluded4(const RayPacket4 &packet, const float tMax[4], int activeMask = 0xF) const;
+
+        // Replaces sphere index (of the input list) and refits the bounds of
+        // every node. The tree keeps the shape it was built with, so an edit
+        // is cheap, but traversal slows down the further the sphere moves from
+        // where the build placed it; rebuild after large changes.
+        void update(int index, const Sphere &sphere);
+
+        size_t nodeCount() const { return nodes.size(); }
+};
+
+#endif // BVH_HPP
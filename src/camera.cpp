@@ -2,27 +2,43 @@
 #include <cmath>
 
 camAxis::camAxis(const glm::vec3 &x, const glm::vec3 &y, const glm::vec3 &z)
-    : forward(z), right(x), up(y) {}
+    : forward(toRtVec3(z)), right(toRtVec3(x)), up(toRtVec3(y)) {}
 
 Camera::Camera(const glm::vec3 &origin, const camAxis &axis, int fov, float aspectRatio)
-    : position(origin), axis(axis), fov(fov), aspectRatio(aspectRatio) {}
+    : position(toRtVec3(origin)), axis(axis), fov(fov), aspectRatio(aspectRatio) {}
 
 void Camera::movePosition(const glm::vec3 &newPosition){
-    position = newPosition;
+    position = toRtVec3(newPosition);
 }
 
 void Camera::moveDirection(const glm::vec3 &newDirection){
-    // TODO: direction change
+    glm::vec3 forward = glm::normalize(newDirection);
+    glm::vec3 right = glm::cross(toVec3(axis.getUp()), forward);
+    // Looking straight along the old up axis: keep the old right axis instead
+    if (glm::dot(right, right) < 1e-12f)
+        right = toVec3(axis.getRight());
+    right = glm::normalize(right);
+    axis = camAxis(right, glm::cross(forward, right), forward);
 }
 
-void Camera::rotateCam(){
-    // TODO: camera rotation
+void Camera::rotateCam(const glm::quat &rotation){
+    axis = camAxis(rotation * toVec3(axis.getRight()), rotation * toVec3(axis.getUp()),
+                   rotation * toVec3(axis.getForward()));
+}
+
+void Camera::setOrientation(const glm::quat &orientation){
+    axis = camAxis(orientation * glm::vec3(1.0f, 0.0f, 0.0f), orientation * glm::vec3(0.0f, 1.0f, 0.0f),
+                   orientation * glm::vec3(0.0f, 0.0f, 1.0f));
 }
 
 Ray Camera::generateRay(int pixelX, int pixelY, int imageWidth, int imageHeight) const{
+    return generateRay(pixelX + 0.5f, pixelY + 0.5f, imageWidth, imageHeight);
+}
+
+Ray Camera::generateRay(float pixelX, float pixelY, int imageWidth, int imageHeight) const{
     // pixel coordinates -> NDC in [-1,1], (0,0) at center
-    float ndcX = (2.0f * (pixelX + 0.5f) / imageWidth) - 1.0f;
-    float ndcY = 1.0f - (2.0f * (pixelY + 0.5f) / imageHeight);
+    float ndcX = (2.0f * pixelX / imageWidth) - 1.0f;
+    float ndcY = 1.0f - (2.0f * pixelY / imageHeight);
     ndcX *= aspectRatio;
 
     float fovRadians = fov * (M_PI / 180.0f);
@@ -30,9 +46,29 @@ Ray Camera::generateRay(int pixelX, int pixelY, int imageWidth, int imageHeight)
     ndcX *= scale;
     ndcY *= scale;
 
-    glm::vec3 rayDirection = ndcX * axis.getRight() +
+    camVec3 rayDirection = ndcX * axis.getRight() +
                             ndcY * axis.getUp() +
                             axis.getForward();
 
     return Ray(position, rayDirection);
 }
+
+bool Camera::project(const glm::vec3 &point, int imageWidth, int imageHeight, glm::vec2 &pixel) const{
+    glm::vec3 d = point - toVec3(position);
+    float z = glm::dot(d, toVec3(axis.getForward()));
+    if (!(z > 0.0f))
+        return false;
+    float fovRadians = fov * (M_PI / 180.0f);
+    float scale = tan(fovRadians / 2.0f);
+    float ndcX = glm::dot(d, toVec3(axis.getRight())) / (z * scale * aspectRatio);
+    float ndcY = glm::dot(d, toVec3(axis.getUp())) / (z * scale);
+    pixel = glm::vec2((ndcX + 1.0f) * 0.5f * imageWidth, (1.0f - ndcY) * 0.5f * imageHeight);
+    return true;
+}
+
+glm::quat lookRotation(const glm::vec3 &from, const glm::vec3 &target, const glm::vec3 &up){
+    // Columns right, up, forward: the rotation taking x, y, z to the camera axes
+    glm::vec3 forward = glm::normalize(target - from);
+    glm::vec3 right = glm::normalize(glm::cross(up, forward));
+    return glm::quat_cast(glm::mat3(right, glm::cross(forward, right), forward));
+}
@@ -2,10 +2,12 @@
 #define CAMERA_HPP
 
 #include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
 #include "ray.hpp"
+#include "vecmath.hpp"
 #include <cmath>
 
-using camVec3 = glm::vec3;
+using camVec3 = rtVec3;
 
 class camAxis{
     private:
@@ -32,9 +34,35 @@ class Camera{
         Camera(const glm::vec3 &origin, const camAxis &axis, int fov, float aspectRatio);
 
         void movePosition(const glm::vec3 &newPosition);
+
+        // Turns the camera to look along newDirection, keeping it as upright
+        // as it was: the new right axis is level with the old up axis
         void moveDirection(const glm::vec3 &newDirection);
-        void rotateCam();
+
+        // Rotates the axes by rotation, about the camera position
+        void rotateCam(const glm::quat &rotation);
+
+        // Sets the axes to the world x (right), y (up) and z (forward) rotated
+        // by orientation; the identity quaternion is the default camera
+        void setOrientation(const glm::quat &orientation);
+
+        glm::vec3 getPosition() const { return toVec3(position); }
+        const camAxis &getAxis() const { return axis; }
+
         Ray generateRay(int pixelX, int pixelY, int imageWidth, int imageHeight) const;
+
+        // Ray through a point of the image plane in pixel units, (0,0) being the
+        // top-left corner of the image; the int version aims at pixel centres
+        Ray generateRay(float pixelX, float pixelY, int imageWidth, int imageHeight) const;
+
+        // The inverse: where point appears in the image, in the pixel units
+        // generateRay takes. False for points level with or behind the camera.
+        // Takes the axes to be orthonormal, which every setter keeps them.
+        bool project(const glm::vec3 &point, int imageWidth, int imageHeight, glm::vec2 &pixel) const;
 };
 
+// Orientation of a camera at from looking at target, up being the world
+// direction that should appear upwards in the image
+glm::quat lookRotation(const glm::vec3 &from, const glm::vec3 &target, const glm::vec3 &up);
+
 #endif // CAMERA_HPP
\ No newline at end of file
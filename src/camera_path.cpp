@@ -0,0 +1,43 @@
+#include "camera_path.hpp"
+#include <algorithm>
+
+void CameraPath::addKeyframe(const CameraKeyframe &keyframe){
+    auto at = std::lower_bound(keyframes.begin(), keyframes.end(), keyframe.time,
+                               [](const CameraKeyframe &k, float time){ return k.time < time; });
+    if (at != keyframes.end() && at->time == keyframe.time)
+        *at = keyframe;
+    else
+        keyframes.insert(at, keyframe);
+}
+
+CameraKeyframe CameraPath::evaluate(float time) const{
+    if (time <= keyframes.front().time)
+        return keyframes.front();
+    if (time >= keyframes.back().time)
+        return keyframes.back();
+
+    // Segment i .. i + 1 holds time; its neighbours shape the tangents, the
+    // end keyframes standing in for the missing ones
+    size_t i = std::upper_bound(keyframes.begin(), keyframes.end(), time,
+                                [](float t, const CameraKeyframe &k){ return t < k.time; }) - keyframes.begin() - 1;
+    const CameraKeyframe &k1 = keyframes[i];
+    const CameraKeyframe &k2 = keyframes[i + 1];
+    const glm::vec3 &p0 = keyframes[i > 0 ? i - 1 : i].position;
+    const glm::vec3 &p3 = keyframes[i + 2 < keyframes.size() ? i + 2 : i + 1].position;
+    float t = (time - k1.time) / (k2.time - k1.time);
+
+    CameraKeyframe pose;
+    pose.time = time;
+    float t2 = t * t, t3 = t2 * t;
+    pose.position = 0.5f * (2.0f * k1.position + (k2.position - p0) * t
+                            + (2.0f * p0 - 5.0f * k1.position + 4.0f * k2.position - p3) * t2
+                            + (3.0f * k1.position - p0 - 3.0f * k2.position + p3) * t3);
+    pose.orientation = glm::normalize(glm::slerp(k1.orientation, k2.orientation, t));
+    return pose;
+}
+
+void CameraPath::apply(float time, Camera &camera) const{
+    CameraKeyframe pose = evaluate(time);
+    camera.movePosition(pose.position);
+    camera.setOrientation(pose.orientation);
+}
@@ -0,0 +1,39 @@
+#ifndef CAMERA_PATH_HPP
+#define CAMERA_PATH_HPP
+
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+#include "camera.hpp"
+#include <vector>
+
+// Camera pose at one point of an animation, time in seconds
+struct CameraKeyframe {
+    float time;
+    glm::vec3 position;
+    glm::quat orientation;   // as in Camera::setOrientation
+};
+
+// Keyframed camera animation. Positions follow a Catmull-Rom spline through
+// the keyframes, so the camera moves without kinks at them; orientations are
+// slerped along the shorter arc between neighbouring keyframes. Before the
+// first and after the last keyframe the pose holds still.
+class CameraPath {
+    private:
+        std::vector<CameraKeyframe> keyframes;   // by time
+
+    public:
+        // Keyframes may come in any order; one at an existing time replaces it
+        void addKeyframe(const CameraKeyframe &keyframe);
+
+        bool empty() const { return keyframes.empty(); }
+        float getStartTime() const { return keyframes.empty() ? 0.0f : keyframes.front().time; }
+        float getEndTime() const { return keyframes.empty() ? 0.0f : keyframes.back().time; }
+
+        // Pose at time; the path must not be empty
+        CameraKeyframe evaluate(float time) const;
+
+        // Moves and turns camera to the pose at time
+        void apply(float time, Camera &camera) const;
+};
+
+#endif // CAMERA_PATH_HPP
@@ -0,0 +1,293 @@
+#include "coordinator.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <poll.h>
+#include <unistd.h>
+
+#define WORKER_PIPELINE_DEPTH 2     // jobs in flight per worker, so it never waits on the network
+#define POLL_TIMEOUT_MS 20
+#define STRAGGLER_FACTOR 3.0        // a job this many median job times old is given out again
+#define STRAGGLER_MIN_SAMPLES 4     // job times needed before the median means anything
+#define WORKER_TIMEOUT_SECONDS 10.0 // owing answers with no bytes moving this long drops a worker
+
+Coordinator::Coordinator(const std::vector<std::string> &addresses){
+    for (const std::string &address : addresses) {
+        Worker worker;
+        worker.stats.address = address;
+        std::string host;
+        int port;
+        if (parseHostPort(address, host, port))
+            worker.fd = connectTcp(host, port);
+        worker.stats.alive = worker.fd >= 0;
+        if (worker.fd >= 0)
+            setNonBlocking(worker.fd);
+        else
+            error = "cannot connect to " + address;
+        workers.push_back(std::move(worker));
+    }
+}
+
+Coordinator::~Coordinator(){
+    for (Worker &worker : workers)
+        if (worker.fd >= 0)
+            close(worker.fd);
+}
+
+int Coordinator::getLiveWorkers() const{
+    return (int)std::count_if(workers.begin(), workers.end(), [](const Worker &w){ return w.fd >= 0; });
+}
+
+std::vector<WorkerStats> Coordinator::getWorkerStats() const{
+    std::vector<WorkerStats> stats;
+    for (const Worker &worker : workers)
+        stats.push_back(worker.stats);
+    return stats;
+}
+
+void Coordinator::disconnect(Worker &worker){
+    if (worker.fd >= 0)
+        close(worker.fd);
+    worker.fd = -1;
+    worker.out.clear();
+    worker.in.clear();
+    worker.stats.alive = false;
+}
+
+bool Coordinator::render(const std::vector<Sphere> &spheres, const glm::vec3 &lightDir, const CameraState &camera,
+                         const FrameSettings &settings, std::vector<glm::vec3> &image){
+    auto start = std::chrono::steady_clock::now();
+    auto now = [&](){ return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); };
+
+    std::vector<Tile> tiles = makeTiles(settings.width, settings.height, settings.tileSize);
+    int chunks = (settings.samplesPerPixel + settings.samplesPerJob - 1) / settings.samplesPerJob;
+    size_t jobCount = tiles.size() * chunks;
+    std::vector<char> done(jobCount, 0);
+    std::vector<int> copies(jobCount, 0);          // copies in flight
+    std::vector<double> issuedAt(jobCount, 0.0);   // when the oldest copy went out
+    std::vector<std::vector<glm::vec3>> results(jobCount);
+    std::vector<int> nextChunk(tiles.size(), 0);    // per tile, the next range to add to the frame
+    std::vector<double> jobTimes;
+    std::deque<int> pending;
+    for (size_t i = 0; i < jobCount; i++)
+        pending.push_back((int)i);
+
+    std::vector<glm::vec3> sums((size_t)settings.width * settings.height, glm::vec3(0.0f));
+    auto merge = [&](int id){
+        // Ranges are added in order, whatever order they arrive in
+        int t = id / chunks;
+        const Tile &tile = tiles[t];
+        while (nextChunk[t] < chunks && done[t * chunks + nextChunk[t]]) {
+            std::vector<glm::vec3> &r = results[t * chunks + nextChunk[t]];
+            for (int y = 0; y < tile.height; y++)
+                for (int x = 0; x < tile.width; x++)
+                    sums[(size_t)(tile.y0 + y) * settings.width + tile.x0 + x] += r[(size_t)y * tile.width + x];
+            std::vector<glm::vec3>().swap(r);
+            nextChunk[t]++;
+        }
+    };
+
+    // Jobs still in flight from an earlier frame are answered first; their
+    // ids no longer match anything and the answers are dropped
+    for (Worker &worker : workers)
+        std::fill(worker.inFlight.begin(), worker.inFlight.end(), -1);
+
+    // A worker that had nothing to answer starts its timeout from the next thing it is sent
+    auto queue = [&](Worker &worker, MessageType type, const void *payload, size_t size){
+        if (worker.inFlight.empty() && worker.out.empty())
+            worker.lastHeard = now();
+        appendMessage(worker.out, type, payload, size);
+    };
+
+    // Scene and camera go out ahead of the jobs; the workers take requests in order
+    std::vector<unsigned char> scene = encodeScene(spheres, lightDir);
+    for (Worker &worker : workers) {
+        if (worker.fd >= 0) {
+            queue(worker, MessageType::Scene, scene.data(), scene.size());
+            queue(worker, MessageType::Camera, &camera, sizeof(camera));
+        }
+    }
+
+    auto lose = [&](Worker &worker){
+        for (int id : worker.inFlight) {
+            if (id < 0 || done[id])
+                continue;
+            worker.stats.jobsLost++;
+            if (--copies[id] == 0)
+                pending.push_front(id);
+        }
+        worker.inFlight.clear();
+        worker.sentAt.clear();
+        disconnect(worker);
+    };
+
+    // Once the queue is empty: the oldest job only one worker has, if it is overdue
+    auto straggler = [&](const Worker &idle){
+        if (jobTimes.size() < STRAGGLER_MIN_SAMPLES)
+            return -1;
+        std::vector<double> sorted = jobTimes;
+        std::nth_element(sorted.begin(), sorted.begin() + sorted.size() / 2, sorted.end());
+        double limit = STRAGGLER_FACTOR * sorted[sorted.size() / 2];
+        int oldest = -1;
+        for (const Worker &worker : workers) {
+            if (&worker == &idle)
+                continue;
+            for (int id : worker.inFlight)
+                if (id >= 0 && !done[id] && copies[id] == 1 && now() - issuedAt[id] > limit
+                    && (oldest < 0 || issuedAt[id] < issuedAt[oldest]))
+                    oldest = id;
+        }
+        return oldest;
+    };
+
+    size_t completed = 0;
+    while (completed < jobCount) {
+        for (Worker &worker : workers) {
+            while (worker.fd >= 0 && worker.inFlight.size() < WORKER_PIPELINE_DEPTH) {
+                int id = -1;
+                while (!pending.empty() && id < 0) {
+                    int j = pending.front();
+                    pending.pop_front();
+                    if (!done[j])
+                        id = j;
+                }
+                bool reissue = false;
+                if (id < 0) {
+                    id = straggler(worker);
+                    reissue = id >= 0;
+                }
+                if (id < 0)
+                    break;
+
+                const Tile &tile = tiles[id / chunks];
+                int first = (id % chunks) * settings.samplesPerJob;
+                SampleJob job{id, tile.x0, tile.y0, tile.width, tile.height, first,
+                              std::min(settings.samplesPerJob, settings.samplesPerPixel - first),
+                              settings.width, settings.height};
+                queue(worker, MessageType::Job, &job, sizeof(job));
+                if (copies[id]++ == 0)
+                    issuedAt[id] = now();
+                reissuedJobs += reissue;
+                worker.inFlight.push_back(id);
+                worker.sentAt.push_back(now());
+            }
+        }
+
+        std::vector<pollfd> fds;
+        std::vector<Worker *> polled;
+        for (Worker &worker : workers) {
+            size_t queued = worker.out.size();
+            if (worker.fd >= 0 && !sendPending(worker.fd, worker.out))
+                lose(worker);
+            if (worker.fd >= 0 && worker.out.size() < queued)
+                worker.lastHeard = now();
+            if (worker.fd >= 0 && (!worker.inFlight.empty() || !worker.out.empty())
+                && now() - worker.lastHeard > WORKER_TIMEOUT_SECONDS) {
+                error = worker.stats.address + ": timed out";
+                lose(worker);
+            }
+            if (worker.fd >= 0) {
+                fds.push_back(pollfd{worker.fd, (short)(POLLIN | (worker.out.empty() ? 0 : POLLOUT)), 0});
+                polled.push_back(&worker);
+            }
+        }
+        if (fds.empty()) {
+            error = "every worker is gone";
+            return false;
+        }
+        if (poll(fds.data(), fds.size(), POLL_TIMEOUT_MS) < 0)
+            continue;
+
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (!fds[i].revents)
+                continue;
+            Worker &worker = *polled[i];
+            if (!(fds[i].revents & POLLIN)) {
+                // Writable; the queued bytes go out at the top of the next pass
+                if (fds[i].revents & (POLLHUP | POLLERR))
+                    lose(worker);
+                continue;
+            }
+            size_t received = worker.in.size();
+            if (!recvPending(worker.fd, worker.in)) {
+                lose(worker);
+                continue;
+            }
+            if (worker.in.size() > received)
+                worker.lastHeard = now();
+
+            MessageType type;
+            std::vector<unsigned char> payload;
+            int taken;
+            while (worker.fd >= 0 && (taken = takeMessage(worker.in, type, payload)) != 0) {
+                if (taken < 0) {
+                    lose(worker);
+                    break;
+                }
+                if (type == MessageType::Error) {
+                    error = worker.stats.address + ": " + std::string(payload.begin(), payload.end());
+                    lose(worker);
+                    break;
+                }
+                if (type == MessageType::Done)
+                    continue;   // scene or camera acknowledged
+
+                SampleJob job;
+                if (type != MessageType::Samples || payload.size() < sizeof(job) || worker.inFlight.empty()) {
+                    lose(worker);
+                    break;
+                }
+                std::memcpy(&job, payload.data(), sizeof(job));
+                int id = worker.inFlight.front();
+                size_t pixels = (size_t)job.width * job.height;
+                if (id >= 0 && (job.id != id || payload.size() != sizeof(job) + pixels * sizeof(glm::vec3))) {
+                    lose(worker);
+                    break;
+                }
+                double seconds = now() - worker.sentAt.front();
+                worker.inFlight.erase(worker.inFlight.begin());
+                worker.sentAt.erase(worker.sentAt.begin());
+                if (id < 0)
+                    continue;   // left over from an earlier frame
+
+                copies[id]--;
+                worker.stats.busySeconds += seconds;
+                jobTimes.push_back(seconds);
+                if (done[id]) {
+                    worker.stats.jobsWasted++;
+                    continue;
+                }
+                results[id].resize(pixels);
+                std::memcpy(results[id].data(), payload.data() + sizeof(job), pixels * sizeof(glm::vec3));
+                done[id] = 1;
+                worker.stats.jobsDone++;
+                completed++;
+                merge(id);
+            }
+        }
+    }
+
+    image.resize(sums.size());
+    for (size_t i = 0; i < sums.size(); i++)
+        image[i] = sums[i] / (float)settings.samplesPerPixel;
+    return true;
+}
+
+void renderSamplesLocally(const Renderer &renderer, const FrameSettings &settings, std::vector<glm::vec3> &image){
+    std::vector<glm::vec3> sums((size_t)settings.width * settings.height, glm::vec3(0.0f));
+    std::vector<glm::vec3> range;
+    for (const Tile &tile : makeTiles(settings.width, settings.height, settings.tileSize)) {
+        range.resize((size_t)tile.width * tile.height);
+        for (int first = 0; first < settings.samplesPerPixel; first += settings.samplesPerJob) {
+            renderer.renderTileSamples(tile, first, std::min(settings.samplesPerJob, settings.samplesPerPixel - first),
+                                       range.data());
+            for (int y = 0; y < tile.height; y++)
+                for (int x = 0; x < tile.width; x++)
+                    sums[(size_t)(tile.y0 + y) * settings.width + tile.x0 + x] += range[(size_t)y * tile.width + x];
+        }
+    }
+    image.resize(sums.size());
+    for (size_t i = 0; i < sums.size(); i++)
+        image[i] = sums[i] / (float)settings.samplesPerPixel;
+}
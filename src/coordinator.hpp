@@ -0,0 +1,84 @@
+#ifndef COORDINATOR_HPP
+#define COORDINATOR_HPP
+
+#include "glm/glm.hpp"
+#include "render_protocol.hpp"
+#include "renderer.hpp"
+#include "sphere.hpp"
+#include <string>
+#include <vector>
+
+// One frame split into jobs: every tile of makeTiles(), and within each tile
+// the samples per pixel in ranges of samplesPerJob
+struct FrameSettings {
+    int width = 800, height = 600;
+    int tileSize = 32;
+    int samplesPerPixel = 16;
+    int samplesPerJob = 4;
+};
+
+struct WorkerStats {
+    std::string address;
+    bool alive = false;
+    int jobsDone = 0;        // results that were used
+    int jobsWasted = 0;      // results that arrived after another worker's copy
+    int jobsLost = 0;        // in flight when the worker disconnected
+    double busySeconds = 0;  // sum of send-to-answer time of its jobs
+};
+
+// Renders frames on worker RenderServers reached over TCP. Jobs go out as
+// workers ask for them (each keeps a couple in flight), so fast workers take
+// more. Jobs of a worker that disconnects go back in the queue, and once the
+// queue is empty, jobs outstanding much longer than usual are given to an idle
+// worker as well; whichever answer comes first is kept. Sockets are
+// non-blocking, so a worker that stalls halfway through a message holds up
+// nothing but its own jobs, and it is dropped once it has owed answers
+// without a byte moving for WORKER_TIMEOUT_SECONDS.
+//
+// The frame does not depend on which worker rendered what: workers compute the
+// same sums for a job, and the sample ranges of a pixel are added up in range
+// order before dividing by samplesPerPixel. For a given samplesPerJob the
+// result is bit-identical to renderSamplesLocally().
+class Coordinator {
+    private:
+        struct Worker {
+            int fd = -1;
+            std::vector<int> inFlight;      // job ids in the order sent, answered in that order
+            std::vector<double> sentAt;
+            std::vector<unsigned char> out; // queued messages the socket has not taken yet
+            std::vector<unsigned char> in;  // received bytes short of a whole message
+            double lastHeard = 0;           // last time it took or sent bytes while owing answers
+            WorkerStats stats;
+        };
+
+        std::vector<Worker> workers;
+        std::string error;
+        int reissuedJobs = 0;
+
+        void disconnect(Worker &worker);
+
+    public:
+        // Workers as "host:port"; connects to all that answer
+        explicit Coordinator(const std::vector<std::string> &addresses);
+        ~Coordinator();
+
+        Coordinator(const Coordinator &) = delete;
+        Coordinator &operator=(const Coordinator &) = delete;
+
+        int getLiveWorkers() const;
+
+        // Sends the scene and camera to every worker, renders the frame and
+        // writes width * height averaged colours to image. False when every
+        // worker is gone before the frame is done.
+        bool render(const std::vector<Sphere> &spheres, const glm::vec3 &lightDir, const CameraState &camera,
+                    const FrameSettings &settings, std::vector<glm::vec3> &image);
+
+        std::vector<WorkerStats> getWorkerStats() const;
+        int getReissuedJobs() const { return reissuedJobs; }
+        const std::string &getError() const { return error; }
+};
+
+// The same frame rendered in this process, summed in the same order
+void renderSamplesLocally(const Renderer &renderer, const FrameSettings &settings, std::vector<glm::vec3> &image);
+
+#endif // COORDINATOR_HPP
@@ -0,0 +1,162 @@
+#include "filter.hpp"
+#include <algorithm>
+#include <cmath>
+
+ReconstructionFilter::ReconstructionFilter(FilterType type)
+    : type(type){
+    switch (type) {
+        case FilterType::Box:            radius = 0.5f; break;
+        case FilterType::Gaussian:       radius = 1.5f; break;
+        case FilterType::Mitchell:       radius = 2.0f; break;
+        case FilterType::BlackmanHarris: radius = 2.0f; break;
+    }
+    // The last entry is the value just inside the radius, so the box keeps
+    // its edge instead of ramping down over the last step
+    table.resize(TABLE_SIZE + 1);
+    for (int i = 0; i <= TABLE_SIZE; i++)
+        table[i] = evaluateExact(std::min(i * radius / TABLE_SIZE, radius * 0.99999f));
+}
+
+int ReconstructionFilter::getBorder() const{
+    // A sample anywhere in [x, x + 1) reaches the pixels whose centres are
+    // closer than the radius
+    return (int)std::ceil(radius - 0.5f);
+}
+
+float ReconstructionFilter::evaluateExact(float x) const{
+    x = std::fabs(x);
+    if (x >= radius)
+        return 0.0f;
+    switch (type) {
+        case FilterType::Box:
+            return 1.0f;
+        case FilterType::Gaussian: {
+            const float sigma = 0.5f;
+            return std::exp(-x * x / (2 * sigma * sigma)) - std::exp(-radius * radius / (2 * sigma * sigma));
+        }
+        case FilterType::Mitchell: {
+            // Mitchell and Netravali 1988 on [0, 2)
+            const float b = 1.0f / 3.0f, c = 1.0f / 3.0f;
+            if (x < 1.0f)
+                return ((12 - 9 * b - 6 * c) * x * x * x + (-18 + 12 * b + 6 * c) * x * x + (6 - 2 * b)) / 6;
+            return ((-b - 6 * c) * x * x * x + (6 * b + 30 * c) * x * x + (-12 * b - 48 * c) * x + (8 * b + 24 * c)) / 6;
+        }
+        case FilterType::BlackmanHarris: {
+            // The window over [-radius, radius], at its peak in the middle
+            const float twoPi = 6.28318530718f;
+            float t = 0.5f + x / (2 * radius);
+            return 0.35875f - 0.48829f * std::cos(twoPi * t) + 0.14128f * std::cos(2 * twoPi * t)
+                 - 0.01168f * std::cos(3 * twoPi * t);
+        }
+    }
+    return 0.0f;
+}
+
+bool parseFilterType(const std::string &name, FilterType &type){
+    for (FilterType t : {FilterType::Box, FilterType::Gaussian, FilterType::Mitchell, FilterType::BlackmanHarris})
+        if (name == filterName(t)) {
+            type = t;
+            return true;
+        }
+    return false;
+}
+
+const char *filterName(FilterType type){
+    switch (type) {
+        case FilterType::Box:            return "box";
+        case FilterType::Gaussian:       return "gaussian";
+        case FilterType::Mitchell:       return "mitchell";
+        case FilterType::BlackmanHarris: return "blackman-harris";
+    }
+    return "";
+}
+
+FilterSampler::FilterSampler(const ReconstructionFilter &filter)
+    : filter(filter), cdf(TABLE_SIZE + 1, 0.0f), cellWeight(TABLE_SIZE){
+    // f at the middle of each cell stands for the whole cell, so offsets are
+    // drawn from |f| in steps and each cell has one weight: f / (pdf * integral
+    // of f), which comes to +-(integral of |f|) / (integral of f)
+    float cell = 2 * filter.getRadius() / TABLE_SIZE;
+    float integral = 0.0f;
+    for (int k = 0; k < TABLE_SIZE; k++) {
+        float f = filter.evaluate(-filter.getRadius() + (k + 0.5f) * cell);
+        cdf[k + 1] = cdf[k] + std::fabs(f) * cell;
+        integral += f * cell;
+        cellWeight[k] = f < 0.0f ? -1.0f : 1.0f;
+    }
+    float absIntegral = cdf[TABLE_SIZE];
+    for (float &c : cdf)
+        c /= absIntegral;
+    for (float &w : cellWeight)
+        w *= absIntegral / integral;
+
+    // guide[j] is the cell holding u = j / TABLE_SIZE, where the search for
+    // any u in [j, j + 1) / TABLE_SIZE starts
+    guide.resize(TABLE_SIZE);
+    int k = 0;
+    for (int j = 0; j < TABLE_SIZE; j++) {
+        while (k < TABLE_SIZE - 1 && cdf[k + 1] <= (float)j / TABLE_SIZE)
+            k++;
+        guide[j] = k;
+    }
+}
+
+glm::vec2 FilterSampler::sample(const glm::vec2 &u, float &weight) const{
+    float cell = 2 * filter.getRadius() / TABLE_SIZE;
+    glm::vec2 offset;
+    weight = 1.0f;
+    for (int axis = 0; axis < 2; axis++) {
+        // Cell k holds u; from the guide it is a step or two away at most, and
+        // cells of zero mass are stepped over
+        int k = guide[std::min((int)(u[axis] * TABLE_SIZE), TABLE_SIZE - 1)];
+        while (k < TABLE_SIZE - 1 && cdf[k + 1] <= u[axis])
+            k++;
+        float mass = cdf[k + 1] - cdf[k];
+        float t = mass > 0.0f ? (u[axis] - cdf[k]) / mass : 0.5f;
+        offset[axis] = -filter.getRadius() + (k + t) * cell;
+        weight *= cellWeight[k];
+    }
+    return offset;
+}
+
+SplatImage::SplatImage(int width, int height, int tileSize, const std::vector<Tile> &tiles, int border)
+    : width(width), height(height), tileSize(tileSize),
+      tilesX((width + tileSize - 1) / tileSize), tilesY((height + tileSize - 1) / tileSize),
+      tiles(tiles), buffers(tiles.size()){
+    for (size_t i = 0; i < tiles.size(); i++) {
+        Buffer &b = buffers[i];
+        b.x0 = tiles[i].x0 - border;
+        b.y0 = tiles[i].y0 - border;
+        b.width = tiles[i].width + 2 * border;
+        b.height = tiles[i].height + 2 * border;
+        b.pixels.assign((size_t)b.width * b.height, glm::vec4(0.0f));
+    }
+}
+
+void SplatImage::resolve(std::vector<glm::vec3> &image, unsigned threadCount) const{
+    image.resize((size_t)width * height);
+    forEachTile(tiles.size(), threadCount, [&](size_t i){
+        // Gather this tile from its own buffer and the borders of the (at
+        // most eight) neighbours that overlap it; the border is smaller than a tile
+        const Tile &tile = tiles[i];
+        int tx = tile.x0 / tileSize, ty = tile.y0 / tileSize;
+        std::vector<glm::vec4> sums((size_t)tile.width * tile.height, glm::vec4(0.0f));
+        for (int ny = std::max(ty - 1, 0); ny <= std::min(ty + 1, tilesY - 1); ny++)
+            for (int nx = std::max(tx - 1, 0); nx <= std::min(tx + 1, tilesX - 1); nx++) {
+                const Buffer &b = buffers[(size_t)ny * tilesX + nx];
+                int xBegin = std::max(tile.x0, b.x0), xEnd = std::min(tile.x0 + tile.width, b.x0 + b.width);
+                int yBegin = std::max(tile.y0, b.y0), yEnd = std::min(tile.y0 + tile.height, b.y0 + b.height);
+                for (int y = yBegin; y < yEnd; y++) {
+                    const glm::vec4 *from = b.pixels.data() + (size_t)(y - b.y0) * b.width;
+                    glm::vec4 *to = sums.data() + (size_t)(y - tile.y0) * tile.width;
+                    for (int x = xBegin; x < xEnd; x++)
+                        to[x - tile.x0] += from[x - b.x0];
+                }
+            }
+        for (int y = 0; y < tile.height; y++)
+            for (int x = 0; x < tile.width; x++) {
+                const glm::vec4 &s = sums[(size_t)y * tile.width + x];
+                image[(size_t)(tile.y0 + y) * width + tile.x0 + x] = s.w != 0.0f ? glm::vec3(s) / s.w : glm::vec3(0.0f);
+            }
+    });
+}
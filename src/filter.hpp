@@ -0,0 +1,124 @@
+#ifndef FILTER_HPP
+#define FILTER_HPP
+
+#include "glm/glm.hpp"
+#include "renderer.hpp"
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+// Pixel reconstruction filters. A pixel is the filter-weighted average of the
+// samples around its centre instead of the plain mean of the samples inside
+// it, which trades a little blur for much less aliasing.
+//
+// Two ways to apply one:
+// - splatting: each sample lands anywhere in its pixel and adds its weight to
+//   every pixel in reach, through per-tile buffers (SplatImage);
+// - importance sampling: each pixel places its samples by the filter shape
+//   around its own centre (FilterSampler), so nothing is shared between
+//   pixels, at the cost of samples no longer being reused by neighbours.
+// A splatted pixel is sum(weight * colour) / sum(weight); an importance
+// sampled one is sum(weight * colour) / sample count, see FilterSampler.
+
+enum class FilterType {
+    Box,             // radius 0.5: the plain per-pixel mean
+    Gaussian,        // radius 1.5, sigma 0.5, shifted to reach zero at the radius
+    Mitchell,        // radius 2, B = C = 1/3; has negative lobes
+    BlackmanHarris   // radius 2, four-term window
+};
+
+// Widest border of any filter below, for fixed-size weight tables
+#define MAX_FILTER_BORDER 2
+
+// Separable filter, f(x, y) = f(x) * f(y), offsets in pixels. Evaluated from
+// a table, so a splat costs the same whatever the filter's formula.
+class ReconstructionFilter {
+    private:
+        FilterType type;
+        float radius;
+        std::vector<float> table;   // f at TABLE_SIZE + 1 points over [0, radius)
+
+        float evaluateExact(float x) const;
+
+    public:
+        static const int TABLE_SIZE = 256;
+
+        explicit ReconstructionFilter(FilterType type);
+
+        FilterType getType() const { return type; }
+        float getRadius() const { return radius; }
+
+        // Pixels a sample can reach on each side of its own
+        int getBorder() const;
+
+        // Linear interpolation in the table, 0 beyond the radius
+        float evaluate(float x) const{
+            float t = std::fabs(x) * (TABLE_SIZE / radius);
+            if (!(t <= TABLE_SIZE))
+                return 0.0f;
+            int i = std::min((int)t, TABLE_SIZE - 1);
+            return table[i] + (t - i) * (table[i + 1] - table[i]);
+        }
+        float evaluate(const glm::vec2 &p) const { return evaluate(p.x) * evaluate(p.y); }
+};
+
+// "box", "gaussian", "mitchell" or "blackman-harris"; false for anything else
+bool parseFilterType(const std::string &name, FilterType &type);
+const char *filterName(FilterType type);
+
+// Draws offsets from the filter: x and y each from a table of |f| over
+// [-radius, radius], piecewise constant in TABLE_SIZE cells. The weight
+// f / (pdf * integral of f) averages 1, so a pixel is the sum of weight *
+// colour over the sample count. With f constant per cell the weight is the
+// same everywhere but for its sign, negative on negative lobes; dividing by
+// the sum of the weights instead would blow up where those cancel.
+class FilterSampler {
+    private:
+        ReconstructionFilter filter;
+        std::vector<float> cdf;         // TABLE_SIZE + 1 entries, from 0 to 1
+        std::vector<float> cellWeight;  // per axis weight of a sample in each cell
+        std::vector<int> guide;         // first cell to look in for each 1 / TABLE_SIZE of u
+
+    public:
+        static const int TABLE_SIZE = 256;
+
+        explicit FilterSampler(const ReconstructionFilter &filter);
+
+        const ReconstructionFilter &getFilter() const { return filter; }
+
+        // Offset from the pixel centre for uniform u, and the sample weight
+        glm::vec2 sample(const glm::vec2 &u, float &weight) const;
+};
+
+// Per-tile splat buffers. Each tile owns a buffer of its pixels plus the
+// filter's border on every side and is written by one thread only, so samples
+// are added without atomics or locks. resolve() then builds every output
+// pixel from the buffers that cover it: its own tile's and the overlapping
+// borders of its neighbours.
+class SplatImage {
+    public:
+        struct Buffer {
+            int x0, y0;                     // top-left, may be outside the image
+            int width, height;
+            std::vector<glm::vec4> pixels;  // weighted colour sum, weight sum
+        };
+
+    private:
+        int width, height;
+        int tileSize;
+        int tilesX, tilesY;
+        std::vector<Tile> tiles;
+        std::vector<Buffer> buffers;
+
+    public:
+        // tiles must be makeTiles(width, height, tileSize)
+        SplatImage(int width, int height, int tileSize, const std::vector<Tile> &tiles, int border);
+
+        Buffer &buffer(size_t tileIndex) { return buffers[tileIndex]; }
+
+        // Normalised colours of the whole image, tiles resolved on threadCount threads
+        void resolve(std::vector<glm::vec3> &image, unsigned threadCount) const;
+};
+
+#endif // FILTER_HPP
@@ -0,0 +1,296 @@
+#include "hdr_image.hpp"
+#include "simd.hpp"
+#include "glm/gtc/packing.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#if RT_SIMD_SSE && (defined(__GNUC__) || defined(__clang__))
+#include <immintrin.h>
+#define RT_HAVE_F16C_TARGET 1
+#else
+#define RT_HAVE_F16C_TARGET 0
+#endif
+
+bool writePFM(const std::string &path, int width, int height, const std::vector<glm::vec3> &pixels){
+    std::FILE *out = std::fopen(path.c_str(), "wb");
+    if (!out)
+        return false;
+    // Negative scale marks little-endian data; PFM rows run bottom to top
+    std::fprintf(out, "PF\n%d %d\n-1.0\n", width, height);
+    bool ok = true;
+    for (int y = height - 1; y >= 0 && ok; y--)
+        ok = std::fwrite(&pixels[(size_t)y * width], sizeof(glm::vec3), width, out) == (size_t)width;
+    return std::fclose(out) == 0 && ok;
+}
+
+void floatToHalfScalar(const float *in, uint16_t *out, size_t count){
+    for (size_t i = 0; i < count; i++)
+        out[i] = glm::packHalf1x16(in[i]);
+}
+
+void floatToHalfSSE2(const float *in, uint16_t *out, size_t count){
+    size_t i = 0;
+#if RT_SIMD_SSE
+    // Branch-free round-to-nearest-even conversion of four floats at a time,
+    // after Fabian Giesen's float_to_half_fast3_rtne
+    const __m128i f16max = _mm_set1_epi32((127 + 16) << 23);        // at or above: infinity
+    const __m128i minNormal = _mm_set1_epi32((127 - 14) << 23);     // below: half subnormal
+    const __m128i subnormMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+    const __m128i normalBias = _mm_set1_epi32(0xfff - ((127 - 15) << 23));
+    const __m128i infinity = _mm_set1_epi32(0x7c00);
+    const __m128i nanBit = _mm_set1_epi32(0x200);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i halves[2];
+        for (int k = 0; k < 2; k++) {
+            __m128 f = _mm_loadu_ps(in + i + 4 * k);
+            __m128 sign = _mm_and_ps(f, signMask);
+            __m128 absf = _mm_xor_ps(f, sign);
+            __m128i absi = _mm_castps_si128(absf);
+
+            __m128i isRegular = _mm_cmpgt_epi32(f16max, absi);
+            __m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absf, absf));
+            __m128i special = _mm_or_si128(infinity, _mm_and_si128(isNan, nanBit));
+
+            // Subnormal results: let the FPU round by adding a magic number
+            __m128i isSubnormal = _mm_cmpgt_epi32(minNormal, absi);
+            __m128i subnormal = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absf, _mm_castsi128_ps(subnormMagic))), subnormMagic);
+
+            // Normal results: rebias the exponent, round half to even on bit 13
+            __m128i odd = _mm_srai_epi32(_mm_slli_epi32(absi, 31 - 13), 31);
+            __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absi, normalBias), odd), 13);
+
+            __m128i finite = _mm_or_si128(_mm_and_si128(isSubnormal, subnormal), _mm_andnot_si128(isSubnormal, normal));
+            __m128i result = _mm_or_si128(_mm_and_si128(isRegular, finite), _mm_andnot_si128(isRegular, special));
+            // Sign extends to 0xffff8000, so the signed pack below keeps the low 16 bits
+            halves[k] = _mm_or_si128(result, _mm_srai_epi32(_mm_castps_si128(sign), 16));
+        }
+        _mm_storeu_si128((__m128i *)(out + i), _mm_packs_epi32(halves[0], halves[1]));
+    }
+#endif
+    // Tail, and the whole buffer without SSE: the same rounding one value at a time
+    for (; i < count; i++) {
+        uint32_t x;
+        std::memcpy(&x, &in[i], sizeof(x));
+        uint32_t sign = (x >> 16) & 0x8000;
+        x &= 0x7fffffff;
+        uint16_t h;
+        if (x >= (uint32_t)(127 + 16) << 23) {
+            h = x > 0x7f800000 ? 0x7e00 : 0x7c00;
+        } else if (x < (uint32_t)(127 - 14) << 23) {
+            float magic, f;
+            uint32_t magicBits = (uint32_t)((127 - 15) + (23 - 10) + 1) << 23;
+            std::memcpy(&magic, &magicBits, sizeof(magic));
+            std::memcpy(&f, &x, sizeof(f));
+            f += magic;
+            std::memcpy(&x, &f, sizeof(x));
+            h = (uint16_t)(x - magicBits);
+        } else {
+            uint32_t odd = (x >> 13) & 1;
+            h = (uint16_t)((x + 0xfff - ((uint32_t)(127 - 15) << 23) + odd) >> 13);
+        }
+        out[i] = (uint16_t)(h | sign);
+    }
+}
+
+#if RT_HAVE_F16C_TARGET
+__attribute__((target("f16c")))
+void floatToHalfF16C(const float *in, uint16_t *out, size_t count){
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m128i a = _mm_cvtps_ph(_mm_loadu_ps(in + i), _MM_FROUND_TO_NEAREST_INT);
+        __m128i b = _mm_cvtps_ph(_mm_loadu_ps(in + i + 4), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128((__m128i *)(out + i), _mm_unpacklo_epi64(a, b));
+    }
+    floatToHalfSSE2(in + i, out + i, count - i);
+}
+
+bool cpuHasF16C(){
+    return __builtin_cpu_supports("f16c");
+}
+#else
+void floatToHalfF16C(const float *in, uint16_t *out, size_t count){
+    floatToHalfSSE2(in, out, count);
+}
+
+bool cpuHasF16C(){
+    return false;
+}
+#endif
+
+void floatToHalf(const float *in, uint16_t *out, size_t count){
+    static const bool f16c = cpuHasF16C();
+    if (f16c)
+        floatToHalfF16C(in, out, count);
+    else
+        floatToHalfSSE2(in, out, count);
+}
+
+size_t exrRleCompress(const unsigned char *in, size_t count, unsigned char *out, unsigned char *scratch){
+    // Split even and odd bytes so the high bytes of the halves sit together,
+    // then store differences between neighbouring bytes
+    unsigned char *t1 = scratch, *t2 = scratch + (count + 1) / 2;
+    for (size_t i = 0; i < count; i++)
+        *((i & 1) ? t2++ : t1++) = in[i];
+    for (size_t i = count - 1; i > 0; i--)
+        scratch[i] = (unsigned char)(scratch[i] - scratch[i - 1] + 128);
+
+    // Runs of 3 to 128 equal bytes become (length - 1, byte); everything else
+    // is copied as literals behind a negative count
+    const unsigned char *p = scratch, *end = scratch + count;
+    unsigned char *w = out;
+    while (p < end) {
+        const unsigned char *run = p + 1;
+        while (run < end && *run == *p && run - p < 128)
+            run++;
+        if (run - p >= 3) {
+            *w++ = (unsigned char)(run - p - 1);
+            *w++ = *p;
+            p = run;
+        } else {
+            const unsigned char *lit = p;
+            while (lit < end && lit - p < 127 && !(lit + 2 < end && lit[0] == lit[1] && lit[1] == lit[2]))
+                lit++;
+            *w++ = (unsigned char)(signed char)-(int)(lit - p);
+            std::memcpy(w, p, lit - p);
+            w += lit - p;
+            p = lit;
+        }
+    }
+    size_t size = (size_t)(w - out);
+    return size < count ? size : count;
+}
+
+// Little-endian helpers for the EXR header
+static void putBytes(std::vector<unsigned char> &buf, const void *data, size_t size){
+    const unsigned char *p = (const unsigned char *)data;
+    buf.insert(buf.end(), p, p + size);
+}
+
+static void putInt(std::vector<unsigned char> &buf, int32_t v){
+    unsigned char b[4] = {(unsigned char)v, (unsigned char)(v >> 8), (unsigned char)(v >> 16), (unsigned char)(v >> 24)};
+    putBytes(buf, b, 4);
+}
+
+static void putFloat(std::vector<unsigned char> &buf, float f){
+    int32_t v;
+    std::memcpy(&v, &f, sizeof(v));
+    putInt(buf, v);
+}
+
+static void putAttribute(std::vector<unsigned char> &buf, const char *name, const char *type, int32_t size){
+    putBytes(buf, name, std::strlen(name) + 1);
+    putBytes(buf, type, std::strlen(type) + 1);
+    putInt(buf, size);
+}
+
+bool writeEXR(const std::string &path, int width, int height, const std::vector<glm::vec3> &pixels,
+              ExrCompression compression){
+    const float *first = &pixels[0].r;
+    size_t stride = sizeof(glm::vec3) / sizeof(float);
+    return writeEXRChannels(path, width, height,
+                            {{"R", first, stride, ExrPixelType::Half},
+                             {"G", first + 1, stride, ExrPixelType::Half},
+                             {"B", first + 2, stride, ExrPixelType::Half}},
+                            compression);
+}
+
+bool writeEXRChannels(const std::string &path, int width, int height, std::vector<ExrChannel> channels,
+                      ExrCompression compression){
+    std::sort(channels.begin(), channels.end(),
+              [](const ExrChannel &a, const ExrChannel &b){ return a.name < b.name; });
+
+    std::vector<unsigned char> header;
+    putInt(header, 20000630);   // magic
+    putInt(header, 2);          // version 2, single-part scanline file
+
+    int32_t chlistSize = 1;
+    size_t lineBytes = 0;
+    for (const ExrChannel &channel : channels) {
+        chlistSize += (int32_t)channel.name.size() + 1 + 16;
+        lineBytes += (size_t)width * (channel.type == ExrPixelType::Half ? sizeof(uint16_t) : sizeof(float));
+    }
+    putAttribute(header, "channels", "chlist", chlistSize);
+    for (const ExrChannel &channel : channels) {
+        putBytes(header, channel.name.c_str(), channel.name.size() + 1);
+        putInt(header, (int32_t)channel.type);
+        putInt(header, 0);             // pLinear and reserved bytes
+        putInt(header, 1);             // x sampling
+        putInt(header, 1);             // y sampling
+    }
+    header.push_back(0);
+    putAttribute(header, "compression", "compression", 1);
+    header.push_back((unsigned char)compression);
+    for (const char *window : {"dataWindow", "displayWindow"}) {
+        putAttribute(header, window, "box2i", 16);
+        putInt(header, 0);
+        putInt(header, 0);
+        putInt(header, width - 1);
+        putInt(header, height - 1);
+    }
+    putAttribute(header, "lineOrder", "lineOrder", 1);
+    header.push_back(0);          // INCREASING_Y
+    putAttribute(header, "pixelAspectRatio", "float", 4);
+    putFloat(header, 1.0f);
+    putAttribute(header, "screenWindowCenter", "v2f", 8);
+    putFloat(header, 0.0f);
+    putFloat(header, 0.0f);
+    putAttribute(header, "screenWindowWidth", "float", 4);
+    putFloat(header, 1.0f);
+    header.push_back(0);          // end of header
+
+    std::FILE *out = std::fopen(path.c_str(), "wb");
+    if (!out)
+        return false;
+    bool ok = std::fwrite(header.data(), 1, header.size(), out) == header.size();
+
+    // The offset table is filled in once every chunk size is known
+    std::vector<uint64_t> offsets(height);
+    long tableStart = (long)header.size();
+    ok = ok && std::fwrite(offsets.data(), sizeof(uint64_t), height, out) == (size_t)height;
+    uint64_t offset = (uint64_t)tableStart + sizeof(uint64_t) * height;
+
+    // Per scanline: each channel in turn, gathered into a float row and
+    // converted to half or copied as it is
+    std::vector<float> values(width);
+    std::vector<uint16_t> halves(width);
+    std::vector<unsigned char> line(lineBytes), packed(lineBytes * 3 / 2 + 2), scratch(lineBytes);
+    for (int y = 0; y < height && ok; y++) {
+        unsigned char *p = line.data();
+        for (const ExrChannel &channel : channels) {
+            const float *row = channel.data + (size_t)y * width * channel.stride;
+            for (int x = 0; x < width; x++)
+                values[x] = row[x * channel.stride];
+            if (channel.type == ExrPixelType::Half) {
+                floatToHalf(values.data(), halves.data(), width);
+                std::memcpy(p, halves.data(), (size_t)width * sizeof(uint16_t));
+                p += (size_t)width * sizeof(uint16_t);
+            } else {
+                std::memcpy(p, values.data(), (size_t)width * sizeof(float));
+                p += (size_t)width * sizeof(float);
+            }
+        }
+
+        // EXR data is little-endian, as is every target this builds for
+        const unsigned char *data = line.data();
+        size_t size = lineBytes;
+        if (compression == ExrCompression::RLE) {
+            size = exrRleCompress(data, lineBytes, packed.data(), scratch.data());
+            if (size < lineBytes)
+                data = packed.data();
+        }
+
+        unsigned char chunkHeader[8];
+        int32_t fields[2] = {y, (int32_t)size};
+        std::memcpy(chunkHeader, fields, sizeof(chunkHeader));
+        ok = std::fwrite(chunkHeader, 1, 8, out) == 8 && std::fwrite(data, 1, size, out) == size;
+        offsets[y] = offset;
+        offset += 8 + size;
+    }
+
+    ok = ok && std::fseek(out, tableStart, SEEK_SET) == 0
+            && std::fwrite(offsets.data(), sizeof(uint64_t), height, out) == (size_t)height;
+    return std::fclose(out) == 0 && ok;
+}
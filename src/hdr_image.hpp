@@ -0,0 +1,61 @@
+#ifndef HDR_IMAGE_HPP
+#define HDR_IMAGE_HPP
+
+#include "glm/glm.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Writers that keep linear radiance instead of clamping to 8 bits. Pixels are
+// width * height colours, row by row from the top.
+
+enum class ExrCompression {
+    None = 0,   // NO_COMPRESSION
+    RLE = 1     // RLE_COMPRESSION: byte split, delta predictor and run-length coding per scanline
+};
+
+enum class ExrPixelType {
+    Half = 1,   // HALF
+    Float = 2   // FLOAT, for values half cannot hold exactly (depth, object IDs)
+};
+
+// One channel of a multi-channel EXR. Pixel x of row y is read from
+// data[((size_t)y * width + x) * stride], so a channel can be a plane of its
+// own (stride 1) or one component of interleaved pixels.
+struct ExrChannel {
+    std::string name;       // "R", or layer and channel as in "normal.X"
+    const float *data;
+    size_t stride;
+    ExrPixelType type;
+};
+
+// 32-bit float Portable Float Map, little-endian
+bool writePFM(const std::string &path, int width, int height, const std::vector<glm::vec3> &pixels);
+
+// OpenEXR scanline file with half-float R, G and B channels, one scanline per chunk
+bool writeEXR(const std::string &path, int width, int height, const std::vector<glm::vec3> &pixels,
+              ExrCompression compression = ExrCompression::RLE);
+
+// OpenEXR scanline file with any set of channels, in any order; the file lists
+// them sorted by name as the format requires
+bool writeEXRChannels(const std::string &path, int width, int height, std::vector<ExrChannel> channels,
+                      ExrCompression compression = ExrCompression::RLE);
+
+// Float to IEEE half, round to nearest even. Picks F16C when the CPU has it and
+// SSE2 bit manipulation otherwise.
+void floatToHalf(const float *in, uint16_t *out, size_t count);
+
+// The individual conversion paths, for testing and benchmarks. The scalar one is
+// glm::packHalf1x16, which rounds ties away from zero.
+void floatToHalfScalar(const float *in, uint16_t *out, size_t count);
+void floatToHalfSSE2(const float *in, uint16_t *out, size_t count);
+void floatToHalfF16C(const float *in, uint16_t *out, size_t count);
+bool cpuHasF16C();
+
+// OpenEXR RLE of one block of bytes (after byte splitting and prediction).
+// Returns the compressed size, or count when compression would not help and
+// the block should be stored raw. out needs room for count * 3 / 2 + 2 bytes.
+size_t exrRleCompress(const unsigned char *in, size_t count, unsigned char *out, unsigned char *scratch);
+
+#endif // HDR_IMAGE_HPP
@@ -0,0 +1,92 @@
+#include "image_writer.hpp"
+#include <chrono>
+
+#define WRITER_IDLE_SLEEP_US 1000
+
+AsyncImageWriter::AsyncImageWriter(const std::string &path, int width, int height, int windowRows, size_t queueCapacity)
+    : file(std::fopen(path.c_str(), "wb")), width(width), height(height), windowRows(windowRows),
+      queue(queueCapacity), window((size_t)windowRows * width * 3), rowFill(windowRows, 0){
+    if (!file)
+        return;
+    std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+    worker = std::thread(&AsyncImageWriter::run, this);
+}
+
+AsyncImageWriter::~AsyncImageWriter(){
+    finish();
+}
+
+void AsyncImageWriter::waitForRows(int rowEnd) const{
+    while (rowEnd > getRowsWritten() + windowRows)
+        std::this_thread::yield();
+}
+
+void AsyncImageWriter::submit(std::unique_ptr<TileResult> result){
+    while (!queue.push(std::move(result)))
+        std::this_thread::yield();
+}
+
+bool AsyncImageWriter::finish(){
+    if (!file)
+        return false;
+    closing.store(true, std::memory_order_release);
+    worker.join();
+    bool ok = !writeFailed && getRowsWritten() == height;
+    ok = std::fclose(file) == 0 && ok;
+    file = nullptr;
+    return ok;
+}
+
+void AsyncImageWriter::run(){
+    std::unique_ptr<TileResult> result;
+    while (getRowsWritten() < height) {
+        if (!queue.pop(result)) {
+            // finish() comes after the last submit, so an empty queue once
+            // closing is set means the missing rows will never arrive
+            if (closing.load(std::memory_order_acquire) && !queue.pop(result))
+                break;
+            if (!result) {
+                // Sleep rather than spin so an idle writer leaves the cores to the renderers
+                std::this_thread::sleep_for(std::chrono::microseconds(WRITER_IDLE_SLEEP_US));
+                continue;
+            }
+        }
+        auto start = std::chrono::steady_clock::now();
+        convert(*result);
+        result.reset();
+        flushCompleteRows();
+        busySeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+void AsyncImageWriter::convert(const TileResult &result){
+    const Tile &tile = result.tile;
+    for (int y = 0; y < tile.height; y++) {
+        int slot = (tile.y0 + y) % windowRows;
+        unsigned char *row = &window[((size_t)slot * width + tile.x0) * 3];
+        const glm::vec3 *src = &result.pixels[(size_t)y * tile.width];
+        tonemapRow(&src->r, row, tile.width, tile.x0, tile.y0 + y, tonemap);
+        rowFill[slot] += tile.width;
+    }
+}
+
+void AsyncImageWriter::flushCompleteRows(){
+    int next = getRowsWritten();
+    while (next < height) {
+        // Gather the run of complete rows that is contiguous in the window
+        int first = next % windowRows;
+        int count = 0;
+        while (next + count < height && first + count < windowRows && rowFill[first + count] == width)
+            count++;
+        if (count == 0)
+            break;
+
+        size_t bytes = (size_t)count * width * 3;
+        if (std::fwrite(&window[(size_t)first * width * 3], 1, bytes, file) != bytes)
+            writeFailed = true;
+        for (int i = 0; i < count; i++)
+            rowFill[first + i] = 0;
+        next += count;
+        rowsWritten.store(next, std::memory_order_release);
+    }
+}
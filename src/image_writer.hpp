@@ -0,0 +1,77 @@
+#ifndef IMAGE_WRITER_HPP
+#define IMAGE_WRITER_HPP
+
+#include "glm/glm.hpp"
+#include "bounded_queue.hpp"
+#include "renderer.hpp"
+#include "tonemap.hpp"
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Linear [0,1] colour channel to an 8-bit PPM value
+inline unsigned char toByte(float c){
+    return (unsigned char)(glm::clamp(c, 0.0f, 1.0f) * 255.0f);
+}
+
+// A rendered tile on its way to the writer
+struct TileResult {
+    Tile tile;
+    std::vector<glm::vec3> pixels;
+};
+
+// Streams a binary PPM to disk from a dedicated thread while rendering goes on.
+// Render threads submit finished tiles through a lock-free queue; the writer
+// converts them to bytes into a window of windowRows rows and writes every row
+// as soon as it and all rows above it are complete. Only the window is ever
+// held in memory, so a tile may only be rendered once waitForRows() says its
+// rows fit in the window. windowRows must be at least the tile height.
+class AsyncImageWriter {
+    private:
+        std::FILE *file;
+        int width, height, windowRows;
+        TonemapSettings tonemap;
+
+        BoundedQueue<std::unique_ptr<TileResult>> queue;
+        std::vector<unsigned char> window;   // windowRows rows, row r lives in slot r % windowRows
+        std::vector<int> rowFill;            // pixels converted so far per slot
+        std::atomic<int> rowsWritten{0};
+        std::atomic<bool> closing{false};
+        bool writeFailed = false;
+        double busySeconds = 0.0;            // writer time spent converting and writing
+        std::thread worker;
+
+        void run();
+        void convert(const TileResult &result);
+        void flushCompleteRows();
+
+    public:
+        AsyncImageWriter(const std::string &path, int width, int height, int windowRows, size_t queueCapacity = 64);
+        ~AsyncImageWriter();
+
+        AsyncImageWriter(const AsyncImageWriter &) = delete;
+        AsyncImageWriter &operator=(const AsyncImageWriter &) = delete;
+
+        bool isOpen() const { return file != nullptr; }
+
+        // How tiles become bytes; set before the first submit
+        void setTonemap(const TonemapSettings &settings) { tonemap = settings; }
+
+        // Blocks (yielding) until rows [0, rowEnd) fit in the window
+        void waitForRows(int rowEnd) const;
+
+        // Hands a finished tile to the writer thread, yielding while the queue is full
+        void submit(std::unique_ptr<TileResult> result);
+
+        // Waits for every row to reach the file and closes it. False on a write error.
+        bool finish();
+
+        int getRowsWritten() const { return rowsWritten.load(std::memory_order_acquire); }
+        double getBusySeconds() const { return busySeconds; }
+        size_t windowBytes() const { return window.size(); }
+};
+
+#endif // IMAGE_WRITER_HPP
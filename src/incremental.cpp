@@ -0,0 +1,182 @@
+#include "incremental.hpp"
+#include <algorithm>
+#include <cmath>
+
+IncrementalRenderer::IncrementalRenderer(Renderer &renderer, TilePool &pool, int tileSize)
+    : renderer(renderer), pool(pool), width(renderer.getWidth()), height(renderer.getHeight()),
+      tileSize(tileSize), tilesX((width + tileSize - 1) / tileSize), tiles(makeTiles(width, height, tileSize)),
+      tilePixels(tiles.size()), tileAovs(tiles.size()), image((size_t)width * height),
+      aovs(width, height, AOV_DEPTH | AOV_OBJECT_ID), hitPoints((size_t)width * height), queued(tiles.size(), 0){
+    for (size_t i = 0; i < tiles.size(); i++) {
+        tilePixels[i].resize((size_t)tiles[i].width * tiles[i].height);
+        tileAovs[i].resize((size_t)tiles[i].width * tiles[i].height);
+    }
+}
+
+void IncrementalRenderer::renderTiles(const std::vector<size_t> &tileIndices){
+    pool.run(tileIndices.size(), [&](size_t k){
+        size_t i = tileIndices[k];
+        const Tile &tile = tiles[i];
+        renderer.renderTile(tile, tilePixels[i].data(), tileAovs[i].data());
+        aovs.storeTile(tile, tileAovs[i].data());
+        const Camera &camera = renderer.getCamera();
+        for (int y = 0; y < tile.height; y++) {
+            size_t row = (size_t)(tile.y0 + y) * width + tile.x0;
+            std::copy_n(&tilePixels[i][(size_t)y * tile.width], tile.width, &image[row]);
+            for (int x = 0; x < tile.width; x++) {
+                const AovSample &sample = tileAovs[i][(size_t)y * tile.width + x];
+                if (sample.objectId == 0)
+                    continue;
+                Ray ray = camera.generateRay(tile.x0 + x, tile.y0 + y, width, height);
+                hitPoints[row + x] = toVec3(ray.origin + ray.direction * sample.depth);
+            }
+        }
+    });
+}
+
+void IncrementalRenderer::updateFootprints(){
+    footprints.assign(renderer.getSphereCount(), ScreenRect{width, height, 0, 0});
+    const std::vector<float> &ids = aovs.getObjectId();
+    for (int y = 0; y < height; y++)
+        for (int x = 0; x < width; x++) {
+            int id = (int)ids[(size_t)y * width + x];
+            if (id == 0)
+                continue;
+            ScreenRect &r = footprints[id - 1];
+            r.x0 = std::min(r.x0, x);
+            r.y0 = std::min(r.y0, y);
+            r.x1 = std::max(r.x1, x + 1);
+            r.y1 = std::max(r.y1, y + 1);
+        }
+}
+
+ScreenRect IncrementalRenderer::projectedFootprint(const Sphere &sphere) const{
+    // The sphere lies inside its bounding box, whose projection is inside the
+    // rectangle around its projected corners while all of them are in front
+    glm::vec3 c = toVec3(sphere.getCenter());
+    float r = sphere.getRadius();
+    glm::vec2 lo(INFINITY), hi(-INFINITY);
+    for (int k = 0; k < 8; k++) {
+        glm::vec3 corner = c + r * glm::vec3((k & 1) ? 1.0f : -1.0f, (k & 2) ? 1.0f : -1.0f, (k & 4) ? 1.0f : -1.0f);
+        glm::vec2 p;
+        if (!renderer.getCamera().project(corner, width, height, p))
+            return ScreenRect{0, 0, width, height};
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    // Pixel x is hit through its centre x + 0.5
+    ScreenRect rect;
+    rect.x0 = (int)std::max(std::floor(lo.x), 0.0f);
+    rect.y0 = (int)std::max(std::floor(lo.y), 0.0f);
+    rect.x1 = (int)std::min(std::ceil(hi.x), (float)width);
+    rect.y1 = (int)std::min(std::ceil(hi.y), (float)height);
+    return rect;
+}
+
+void IncrementalRenderer::markTiles(const ScreenRect &rect, std::vector<char> &marked) const{
+    if (rect.empty())
+        return;
+    for (int ty = rect.y0 / tileSize; ty <= (rect.y1 - 1) / tileSize; ty++)
+        for (int tx = rect.x0 / tileSize; tx <= (rect.x1 - 1) / tileSize; tx++)
+            marked[(size_t)ty * tilesX + tx] = 1;
+}
+
+void IncrementalRenderer::queueShadowTiles(const Sphere &before, const Sphere &after,
+                                           const std::vector<char> &retraced, const ScreenRect &near){
+    // A pixel's light ray leaves its first hit towards the light; it can only
+    // change if it passes within either sphere, grown by the shadow ray offset
+    glm::vec3 toLight = -renderer.getLightDir();
+    const std::vector<float> &ids = aovs.getObjectId();
+    const Sphere *spheres[2] = {&before, &after};
+    std::vector<size_t> found;
+    std::vector<char> hit(tiles.size(), 0);
+    pool.run(tiles.size(), [&](size_t i){
+        if (retraced[i] || queued[i])
+            return;
+        const Tile &tile = tiles[i];
+        for (int y = tile.y0; y < tile.y0 + tile.height && !hit[i]; y++)
+            for (int x = tile.x0; x < tile.x0 + tile.width && !hit[i]; x++) {
+                size_t p = (size_t)y * width + x;
+                if (ids[p] == 0.0f)
+                    continue;
+                for (const Sphere *s : spheres) {
+                    glm::vec3 d = toVec3(s->getCenter()) - hitPoints[p];
+                    float r = s->getRadius() + 2.0f * SHADOW_EPSILON;
+                    float along = glm::dot(d, toLight);
+                    if (along > -r && glm::dot(d, d) - along * along <= r * r)
+                        hit[i] = 1;
+                }
+            }
+    });
+    for (size_t i = 0; i < tiles.size(); i++)
+        if (hit[i]) {
+            found.push_back(i);
+            queued[i] = 1;
+        }
+
+    // Nearest to the edit first, where the shadow that moved most likely is
+    glm::vec2 centre(0.5f * (near.x0 + near.x1), 0.5f * (near.y0 + near.y1));
+    auto distance = [&](size_t i){
+        glm::vec2 d = glm::vec2(tiles[i].x0 + 0.5f * tiles[i].width, tiles[i].y0 + 0.5f * tiles[i].height) - centre;
+        return glm::dot(d, d);
+    };
+    std::sort(found.begin(), found.end(), [&](size_t a, size_t b){ return distance(a) < distance(b); });
+    pending.insert(pending.begin(), found.begin(), found.end());
+}
+
+void IncrementalRenderer::renderAll(){
+    std::vector<size_t> all(tiles.size());
+    for (size_t i = 0; i < tiles.size(); i++)
+        all[i] = i;
+    renderTiles(all);
+    updateFootprints();
+    pending.clear();
+    std::fill(queued.begin(), queued.end(), 0);
+}
+
+size_t IncrementalRenderer::retraceMarked(const std::vector<char> &marked){
+    std::vector<size_t> indices;
+    for (size_t i = 0; i < tiles.size(); i++)
+        if (marked[i]) {
+            indices.push_back(i);
+            queued[i] = 0;
+        }
+    renderTiles(indices);
+    pending.erase(std::remove_if(pending.begin(), pending.end(), [&](size_t i){ return marked[i] != 0; }),
+                  pending.end());
+    return indices.size();
+}
+
+size_t IncrementalRenderer::moveSphere(int index, const Sphere &sphere){
+    Sphere before = renderer.getSphere(index);
+    ScreenRect oldRect = footprints[index];
+    ScreenRect newRect = projectedFootprint(sphere);
+    renderer.setSphere(index, sphere);
+
+    std::vector<char> retrace(tiles.size(), 0);
+    markTiles(oldRect, retrace);
+    markTiles(newRect, retrace);
+    size_t count = retraceMarked(retrace);
+    updateFootprints();
+    queueShadowTiles(before, sphere, retrace, newRect.empty() ? oldRect : newRect);
+    return count;
+}
+
+size_t IncrementalRenderer::setSphereColor(int index, const glm::vec3 &color){
+    // Colour changes nothing but the sphere's own pixels, not even shadows
+    renderer.setSphereColor(index, color);
+    std::vector<char> retrace(tiles.size(), 0);
+    markTiles(footprints[index], retrace);
+    return retraceMarked(retrace);
+}
+
+size_t IncrementalRenderer::refine(size_t maxTiles){
+    // Only shadows change in these tiles, so the footprints stay as they are
+    size_t count = std::min(maxTiles, pending.size());
+    std::vector<size_t> indices(pending.begin(), pending.begin() + count);
+    pending.erase(pending.begin(), pending.begin() + count);
+    for (size_t i : indices)
+        queued[i] = 0;
+    renderTiles(indices);
+    return pending.size();
+}
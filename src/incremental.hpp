@@ -0,0 +1,79 @@
+#ifndef INCREMENTAL_HPP
+#define INCREMENTAL_HPP
+
+#include "glm/glm.hpp"
+#include "aov.hpp"
+#include "renderer.hpp"
+#include "sphere.hpp"
+#include "tile_pool.hpp"
+#include <vector>
+
+// Pixels [x0, x1) x [y0, y1); empty when x0 >= x1 or y0 >= y1
+struct ScreenRect {
+    int x0, y0, x1, y1;
+
+    bool empty() const { return x0 >= x1 || y0 >= y1; }
+};
+
+// Keeps a rendered frame up to date through single-object edits, for a
+// look-dev loop that changes one sphere at a time. Every pixel's centre ray
+// records its first hit in an object-ID and depth AOV, from which each sphere
+// gets the screen rectangle it covers. An edit re-traces only the tiles under
+// the sphere's old rectangle and its new one, projected from its bounds;
+// everywhere else the first hit cannot have changed. What can still change is
+// the shadow term: the tiles whose first hits have a light ray passing the old
+// or the new sphere are queued, nearest to the edit first, and re-traced a
+// few at a time by refine(), between frames of the loop. Once the queue is
+// empty the frame is exactly what a full render of the edited scene gives.
+class IncrementalRenderer {
+    private:
+        Renderer &renderer;
+        TilePool &pool;
+        int width, height;
+        int tileSize, tilesX;
+
+        std::vector<Tile> tiles;
+        std::vector<std::vector<glm::vec3>> tilePixels;   // one per tile, reused by every render
+        std::vector<std::vector<AovSample>> tileAovs;
+        std::vector<glm::vec3> image;
+        AovBuffer aovs;                                    // depth and object ID of every pixel
+        std::vector<glm::vec3> hitPoints;                  // first hit of every pixel, where its ID is set
+        std::vector<ScreenRect> footprints;                // per sphere, from the ID AOV
+        std::vector<size_t> pending;                       // tiles left for refine(), next first
+        std::vector<char> queued;                          // per tile, in pending
+
+        void renderTiles(const std::vector<size_t> &tileIndices);
+        void updateFootprints();
+        ScreenRect projectedFootprint(const Sphere &sphere) const;
+        void markTiles(const ScreenRect &rect, std::vector<char> &marked) const;
+
+        // Renders the marked tiles, which refine() then no longer needs to; returns how many
+        size_t retraceMarked(const std::vector<char> &marked);
+
+        // Queues the tiles, not in retraced, with a pixel whose light ray may pass one of the spheres
+        void queueShadowTiles(const Sphere &before, const Sphere &after, const std::vector<char> &retraced,
+                              const ScreenRect &near);
+
+    public:
+        // renderer's camera must not move while its frame is kept
+        IncrementalRenderer(Renderer &renderer, TilePool &pool, int tileSize);
+
+        // Renders every tile, as after any change this class does not track
+        void renderAll();
+
+        // Edits sphere index and brings the frame up to date but for shadows.
+        // Both return the number of tiles re-traced.
+        size_t moveSphere(int index, const Sphere &sphere);
+        size_t setSphereColor(int index, const glm::vec3 &color);
+
+        // Re-traces up to maxTiles of the queued tiles; returns how many are left
+        size_t refine(size_t maxTiles);
+        size_t pendingTiles() const { return pending.size(); }
+
+        const std::vector<glm::vec3> &getImage() const { return image; }
+        const AovBuffer &getAovs() const { return aovs; }
+        const ScreenRect &getFootprint(int index) const { return footprints[index]; }
+        size_t tileCount() const { return tiles.size(); }
+};
+
+#endif // INCREMENTAL_HPP
@@ -0,0 +1,126 @@
+#include "intersect.hpp"
+#include "multiversion.hpp"
+
+// The packet kernels follow the scalar ones in intersect.hpp operation for
+// operation, so a lane gives the same bits as the scalar test of its ray.
+// Branches become selects, and conditions are combined with & and | rather
+// than && and ||, so the loops have no control flow left to stop the
+// vectorizer.
+
+template <int N>
+MULTIVERSION
+static int spherePacket(const RayPacket<N> &packet, glm::vec3 center, float radius, const float *tMax, float *t){
+    float r2 = radius * radius;
+    int hit[N];
+    for (int i = 0; i < N; i++) {
+        float dx = packet.dx[i], dy = packet.dy[i], dz = packet.dz[i];
+        float fx = packet.ox[i] - center.x, fy = packet.oy[i] - center.y, fz = packet.oz[i] - center.z;
+        float b = fx * dx + fy * dy + fz * dz;
+        float lx = fx - b * dx, ly = fy - b * dy, lz = fz - b * dz;
+        float discriminant = r2 - (lx * lx + ly * ly + lz * lz);
+
+        float q = -(b + std::copysign(std::sqrt(discriminant < 0.0f ? 0.0f : discriminant), b));
+        float near = (fx * fx + fy * fy + fz * fz - r2) / q;
+        float bound = std::fabs(q);
+        near = near < -bound ? -bound : near;
+        float root0 = bound < near ? bound : near;
+        float root1 = q;
+        float t0 = root0 > root1 ? root1 : root0;
+        float t1 = root0 > root1 ? root0 : root1;
+        float tHit = t0 > 0.0f ? t0 : t1;
+        hit[i] = (discriminant >= 0.0f) & (tHit > 0.0f) & (tHit < tMax[i]);
+        t[i] = hit[i] ? tHit : t[i];
+    }
+
+    int mask = 0;
+    for (int i = 0; i < N; i++)
+        mask |= hit[i] << i;
+    return mask;
+}
+
+template <int N>
+MULTIVERSION
+static int trianglePacket(const TriangleRayPacket<N> &packet, glm::vec3 p0, glm::vec3 p1, glm::vec3 p2,
+                          const float *tMax, float *t, float *u, float *v){
+    const float (*m)[3][N] = packet.shear;
+    int hit[N], exact[N];
+    float tHit[N], uHit[N], vHit[N];
+    for (int i = 0; i < N; i++) {
+        float ax0 = p0.x - packet.ox[i], ay0 = p0.y - packet.oy[i], az0 = p0.z - packet.oz[i];
+        float bx0 = p1.x - packet.ox[i], by0 = p1.y - packet.oy[i], bz0 = p1.z - packet.oz[i];
+        float cx0 = p2.x - packet.ox[i], cy0 = p2.y - packet.oy[i], cz0 = p2.z - packet.oz[i];
+
+        float ax = ax0 * m[0][0][i] + ay0 * m[0][1][i] + az0 * m[0][2][i];
+        float ay = ax0 * m[1][0][i] + ay0 * m[1][1][i] + az0 * m[1][2][i];
+        float az = ax0 * m[2][0][i] + ay0 * m[2][1][i] + az0 * m[2][2][i];
+        float bx = bx0 * m[0][0][i] + by0 * m[0][1][i] + bz0 * m[0][2][i];
+        float by = bx0 * m[1][0][i] + by0 * m[1][1][i] + bz0 * m[1][2][i];
+        float bz = bx0 * m[2][0][i] + by0 * m[2][1][i] + bz0 * m[2][2][i];
+        float cx = cx0 * m[0][0][i] + cy0 * m[0][1][i] + cz0 * m[0][2][i];
+        float cy = cx0 * m[1][0][i] + cy0 * m[1][1][i] + cz0 * m[1][2][i];
+        float cz = cx0 * m[2][0][i] + cy0 * m[2][1][i] + cz0 * m[2][2][i];
+
+        float e0 = cx * by - cy * bx;
+        float e1 = ax * cy - ay * cx;
+        float e2 = bx * ay - by * ax;
+        // Lanes with an edge function of exactly 0 are redone below in double
+        exact[i] = (e0 == 0.0f) | (e1 == 0.0f) | (e2 == 0.0f);
+
+        bool outside = ((e0 < 0.0f) | (e1 < 0.0f) | (e2 < 0.0f)) & ((e0 > 0.0f) | (e1 > 0.0f) | (e2 > 0.0f));
+        float det = e0 + e1 + e2;
+        float scaledT = e0 * az + e1 * bz + e2 * cz;
+        float sign = std::copysign(1.0f, det);
+        bool inRange = (scaledT * sign > 0.0f) & (scaledT * sign < tMax[i] * det * sign);
+        hit[i] = !exact[i] & !outside & (det != 0.0f) & inRange;
+
+        float invDet = 1.0f / det;
+        tHit[i] = scaledT * invDet;
+        uHit[i] = e1 * invDet;
+        vHit[i] = e2 * invDet;
+    }
+
+    // t, u and v may overlap as far as the compiler knows, so they are written
+    // one array at a time
+    for (int i = 0; i < N; i++)
+        t[i] = hit[i] ? tHit[i] : t[i];
+    for (int i = 0; i < N; i++)
+        u[i] = hit[i] ? uHit[i] : u[i];
+    for (int i = 0; i < N; i++)
+        v[i] = hit[i] ? vHit[i] : v[i];
+
+    int mask = 0;
+    for (int i = 0; i < N; i++) {
+        if (exact[i])
+            hit[i] = intersectTriangle(packet.rays[i], p0, p1, p2, tMax[i], t[i], u[i], v[i]);
+        mask |= hit[i] << i;
+    }
+    return mask;
+}
+
+int intersectSphere(const RayPacket<4> &packet, const glm::vec3 &center, float radius, const float tMax[4], float t[4]){
+    return spherePacket<4>(packet, center, radius, tMax, t);
+}
+
+int intersectSphere(const RayPacket<8> &packet, const glm::vec3 &center, float radius, const float tMax[8], float t[8]){
+    return spherePacket<8>(packet, center, radius, tMax, t);
+}
+
+int intersectSphere(const RayPacket<16> &packet, const glm::vec3 &center, float radius, const float tMax[16],
+                    float t[16]){
+    return spherePacket<16>(packet, center, radius, tMax, t);
+}
+
+int intersectTriangle(const TriangleRayPacket<4> &packet, const glm::vec3 &p0, const glm::vec3 &p1,
+                      const glm::vec3 &p2, const float tMax[4], float t[4], float u[4], float v[4]){
+    return trianglePacket<4>(packet, p0, p1, p2, tMax, t, u, v);
+}
+
+int intersectTriangle(const TriangleRayPacket<8> &packet, const glm::vec3 &p0, const glm::vec3 &p1,
+                      const glm::vec3 &p2, const float tMax[8], float t[8], float u[8], float v[8]){
+    return trianglePacket<8>(packet, p0, p1, p2, tMax, t, u, v);
+}
+
+int intersectTriangle(const TriangleRayPacket<16> &packet, const glm::vec3 &p0, const glm::vec3 &p1,
+                      const glm::vec3 &p2, const float tMax[16], float t[16], float u[16], float v[16]){
+    return trianglePacket<16>(packet, p0, p1, p2, tMax, t, u, v);
+}
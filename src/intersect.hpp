@@ -0,0 +1,154 @@
+#ifndef INTERSECT_HPP
+#define INTERSECT_HPP
+
+#include "glm/glm.hpp"
+#include "ray.hpp"
+#include "vecmath.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// Ray-primitive kernels that stay accurate far from the origin and on edges.
+// All of them report hits in (0, tMax) and take the ray direction to be unit
+// length, which Ray guarantees.
+
+// Nearest hit of the ray with a sphere. The textbook quadratic loses the
+// discriminant to cancellation when the sphere is small next to its distance,
+// and the near root to cancellation between -b and sqrt(D) when the ray
+// starts on the surface. Following Haines et al., "Precision Improvements for
+// Ray/Sphere Intersection" (Ray Tracing Gems, 2019), D comes from the distance
+// of the centre to the ray line, and the roots from q = -(b + sign(b) sqrt(D))
+// as c / q and q, neither of which subtracts nearly equal values.
+// A grazing ray that starts on the surface can still lose D, and then q is
+// tiny and c / q far too large; the near root is never larger than q in exact
+// arithmetic, so it is clamped to that.
+inline bool intersectSphere(const Ray &ray, const rtVec3 &center, float radius, float tMax, float &t){
+    rtVec3 f = ray.origin - center;
+    float b = glm::dot(f, ray.direction);
+    rtVec3 l = f - b * ray.direction;
+    float r2 = radius * radius;
+    float discriminant = r2 - glm::dot(l, l);
+    if (discriminant < 0.0f)
+        return false;
+
+    float q = -(b + std::copysign(std::sqrt(discriminant), b));
+    float t0 = std::min(std::max((glm::dot(f, f) - r2) / q, -std::fabs(q)), std::fabs(q));
+    float t1 = q;
+    if (t0 > t1)
+        std::swap(t0, t1);
+    float tHit = t0 > 0.0f ? t0 : t1;
+    if (!(tHit > 0.0f && tHit < tMax))
+        return false;
+    t = tHit;
+    return true;
+}
+
+// A ray prepared for intersectTriangle. The axis where the direction is
+// largest becomes z, and a shear turns the direction into +z; both are kept as
+// the rows of a matrix, x' = a[kx] - sx a[kz] being dot(a, shearX) and so on.
+// With only zero and unit entries next to the shear, the dot products give
+// the same bits as the component arithmetic, without picking components at
+// run time.
+struct TriangleRay {
+    glm::vec3 origin;
+    glm::vec3 shearX, shearY, shearZ;
+
+    TriangleRay() {}
+    explicit TriangleRay(const Ray &ray) : TriangleRay(toVec3(ray.origin), toVec3(ray.direction)) {}
+
+    TriangleRay(const glm::vec3 &o, const glm::vec3 &d) : origin(o), shearX(0.0f), shearY(0.0f), shearZ(0.0f){
+        glm::vec3 a = glm::abs(d);
+        int kz = a.x > a.y ? (a.x > a.z ? 0 : 2) : (a.y > a.z ? 1 : 2);
+        int kx = kz == 2 ? 0 : kz + 1;
+        int ky = kx == 2 ? 0 : kx + 1;
+        // Keep the winding of the triangle in the sheared space
+        if (d[kz] < 0.0f)
+            std::swap(kx, ky);
+        shearX[kx] = 1.0f;
+        shearX[kz] = -(d[kx] / d[kz]);
+        shearY[ky] = 1.0f;
+        shearY[kz] = -(d[ky] / d[kz]);
+        shearZ[kz] = 1.0f / d[kz];
+    }
+};
+
+// TriangleRay for every lane of a packet, in structure-of-arrays layout
+template <int N>
+struct TriangleRayPacket {
+    float ox[N], oy[N], oz[N];
+    float shear[3][3][N];    // [row][column][lane]
+    TriangleRay rays[N];
+
+    explicit TriangleRayPacket(const RayPacket<N> &packet){
+        for (int i = 0; i < N; i++) {
+            TriangleRay &ray = rays[i];
+            ray = TriangleRay(glm::vec3(packet.ox[i], packet.oy[i], packet.oz[i]),
+                              glm::vec3(packet.dx[i], packet.dy[i], packet.dz[i]));
+            ox[i] = ray.origin.x; oy[i] = ray.origin.y; oz[i] = ray.origin.z;
+            for (int c = 0; c < 3; c++) {
+                shear[0][c][i] = ray.shearX[c];
+                shear[1][c][i] = ray.shearY[c];
+                shear[2][c][i] = ray.shearZ[c];
+            }
+        }
+    }
+};
+
+// Watertight ray-triangle test (Woop, Benthin and Wald, "Watertight
+// Ray/Triangle Intersection", JCGT 2013). In the sheared space the ray is the
+// z axis, and the signs of the three 2D edge functions decide the hit; an
+// edge function that comes out exactly 0 is recomputed in double, so a ray
+// through a shared edge or vertex hits at least one of the triangles that
+// meet there. Both sides hit. u and v are the weights of p1 and p2, as in
+// glm::intersectRayTriangle.
+inline bool intersectTriangle(const TriangleRay &ray, const glm::vec3 &p0, const glm::vec3 &p1, const glm::vec3 &p2,
+                              float tMax, float &t, float &u, float &v){
+    glm::vec3 a = p0 - ray.origin, b = p1 - ray.origin, c = p2 - ray.origin;
+    float ax = glm::dot(a, ray.shearX), ay = glm::dot(a, ray.shearY), az = glm::dot(a, ray.shearZ);
+    float bx = glm::dot(b, ray.shearX), by = glm::dot(b, ray.shearY), bz = glm::dot(b, ray.shearZ);
+    float cx = glm::dot(c, ray.shearX), cy = glm::dot(c, ray.shearY), cz = glm::dot(c, ray.shearZ);
+
+    float e0 = cx * by - cy * bx;
+    float e1 = ax * cy - ay * cx;
+    float e2 = bx * ay - by * ax;
+    if (e0 == 0.0f || e1 == 0.0f || e2 == 0.0f) {
+        e0 = (float)((double)cx * by - (double)cy * bx);
+        e1 = (float)((double)ax * cy - (double)ay * cx);
+        e2 = (float)((double)bx * ay - (double)by * ax);
+    }
+    if ((e0 < 0.0f || e1 < 0.0f || e2 < 0.0f) && (e0 > 0.0f || e1 > 0.0f || e2 > 0.0f))
+        return false;
+    float det = e0 + e1 + e2;
+    if (det == 0.0f)
+        return false;
+
+    // Scaled distance, compared against the range before the one division
+    float scaledT = e0 * az + e1 * bz + e2 * cz;
+    float sign = std::copysign(1.0f, det);
+    if (scaledT * sign <= 0.0f || scaledT * sign >= tMax * det * sign)
+        return false;
+
+    float invDet = 1.0f / det;
+    t = scaledT * invDet;
+    u = e1 * invDet;
+    v = e2 * invDet;
+    return true;
+}
+
+// Packet versions, built for every instruction set (multiversion.hpp) with a
+// loop over the lanes the compiler turns into 4, 8 or 16-wide vector code.
+// Each lane is tested against one primitive, with its own tMax; lanes that
+// hit get t (and u, v) written. Returns a mask with a bit set per hit lane.
+int intersectSphere(const RayPacket<4> &packet, const glm::vec3 &center, float radius, const float tMax[4], float t[4]);
+int intersectSphere(const RayPacket<8> &packet, const glm::vec3 &center, float radius, const float tMax[8], float t[8]);
+int intersectSphere(const RayPacket<16> &packet, const glm::vec3 &center, float radius, const float tMax[16],
+                    float t[16]);
+
+int intersectTriangle(const TriangleRayPacket<4> &packet, const glm::vec3 &p0, const glm::vec3 &p1,
+                      const glm::vec3 &p2, const float tMax[4], float t[4], float u[4], float v[4]);
+int intersectTriangle(const TriangleRayPacket<8> &packet, const glm::vec3 &p0, const glm::vec3 &p1,
+                      const glm::vec3 &p2, const float tMax[8], float t[8], float u[8], float v[8]);
+int intersectTriangle(const TriangleRayPacket<16> &packet, const glm::vec3 &p0, const glm::vec3 &p1,
+                      const glm::vec3 &p2, const float tMax[16], float t[16], float u[16], float v[16]);
+
+#endif // INTERSECT_HPP
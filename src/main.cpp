@@ -1,17 +1,84 @@
 #include "camera.hpp"
 #include "ray.hpp"
 #include "sphere.hpp"
+#include "renderer.hpp"
+#include "image_writer.hpp"
+#include "mapped_image.hpp"
+#include "hdr_image.hpp"
+#include "tonemap.hpp"
+#include "aov.hpp"
+#include "camera_path.hpp"
+#include "sequence.hpp"
+#include "tile_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <vector>
 #include <iostream>
 #include <cstdlib>
 #include <fstream>
+#include <memory>
 #include <string>
+#include <thread>
 
 #define IMAGEX 800
 #define IMAGEY 600
 #define FOV 90
+#define TILE_SIZE 32
+#define WRITER_WINDOW_ROWS 128
+#define SEQUENCE_FRAMES 48
+
+// Usage: raytracer [stream|mmap|pfm|exr|sequence] [linear|srgb|filmic] [--aov=channel,...] [--frames=n]
+//                  [--reproject]
+//   stream    P6 written by a background thread while rendering (default)
+//   mmap      P6 written through a memory-mapped file
+//   pfm       32-bit float PFM written through a memory-mapped file
+//   exr       half-float OpenEXR with RLE compression, unclamped radiance
+//   sequence  n frames (48 by default) of a camera flight around the spheres
+//             to output1_0000.ppm ...; its first frame is output1.ppm. With
+//             --reproject, 16 samples a pixel with shading reused from the
+//             frame before wherever it is still valid (reprojection.hpp)
+// The second argument picks the 8-bit encoding of the P6 modes:
+//   linear  clamped radiance * 255, as always (default)
+//   srgb    sRGB transfer function
+//   filmic  ACES tone curve, sRGB and ordered dithering
+// --aov renders the listed passes (depth, normal, albedo, id, hits, or all) in
+// the same pass as the colour, into one multi-layer EXR: output1.exr itself in
+// exr mode, output1_aov.exr otherwise; not in sequence mode
+int main(int argc, char **argv){
+    std::vector<std::string> args;
+    unsigned aovMask = 0;
+    int frameCount = SEQUENCE_FRAMES;
+    bool reproject = false;
+    bool validOptions = true;
+    for (int a = 1; a < argc; a++) {
+        std::string arg = argv[a];
+        if (arg.compare(0, 6, "--aov=") == 0)
+            validOptions = validOptions && parseAovChannels(arg.substr(6), aovMask);
+        else if (arg.compare(0, 9, "--frames=") == 0)
+            validOptions = validOptions && (frameCount = std::atoi(arg.c_str() + 9)) > 0;
+        else if (arg == "--reproject")
+            reproject = true;
+        else
+            args.push_back(arg);
+    }
+    std::string mode = args.size() > 0 ? args[0] : "stream";
+    std::string encoding = args.size() > 1 ? args[1] : "linear";
+    if ((mode != "stream" && mode != "mmap" && mode != "pfm" && mode != "exr" && mode != "sequence")
+        || (encoding != "linear" && encoding != "srgb" && encoding != "filmic") || !validOptions
+        || (mode == "sequence" && aovMask != 0) || (mode != "sequence" && reproject)){
+        std::cerr << "Usage: " << argv[0] << " [stream|mmap|pfm|exr|sequence] [linear|srgb|filmic]"
+                  << " [--aov=depth,normal,albedo,id,hits|all] [--frames=n] [--reproject]" << std::endl;
+        return 1;
+    }
+    TonemapSettings tonemap;
+    if (encoding != "linear")
+        tonemap.transfer = OutputTransfer::SRGB;
+    if (encoding == "filmic"){
+        tonemap.curve = ToneCurve::ACES;
+        tonemap.dither = true;
+    }
 
-int main(){
     /* 
     
     init scene
@@ -42,78 +109,160 @@ int main(){
     spheres.push_back(Sphere(glm::vec3(2.0f, 0.0f, 4.0f), 1.0f));      // Right sphere
     spheres.push_back(Sphere(glm::vec3(-2.0f, 0.0f, 4.0f), 1.0f));     // Left sphere
 
-    std::vector<unsigned char> framebuffer(IMAGEX * IMAGEY * 3, 0);
-
     // Light direction for simple Lambertian shading
     glm::vec3 lightDir = glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f));
+    Renderer renderer(mainCam, spheres, lightDir, IMAGEX, IMAGEY);
+    unsigned threadCount = std::max(1u, std::thread::hardware_concurrency());
 
-    for (int y = 0; y < IMAGEY; y++){
-        for (int x = 0; x < IMAGEX; x++){
-            Ray ray = mainCam.generateRay(x, y, IMAGEX, IMAGEY);
-            
-            float closestT = 10000.0f; // Initialize with a large value
-            int hitSphereIndex = -1;
-
-            // Check intersection with all spheres
-            for (size_t i = 0; i < spheres.size(); i++) {
-                float t;
-                if (spheres[i].intersect(ray, t)) {
-                    if (t < closestT) {
-                        closestT = t;
-                        hitSphereIndex = i;
-                    }
-                }
-            }
-
-            glm::vec3 color(0.0f);
-            if (hitSphereIndex != -1){
-                glm::vec3 hitPoint = ray.origin + ray.direction * closestT;
-                glm::vec3 normal = glm::normalize(hitPoint - spheres[hitSphereIndex].getCenter());
-
-                // Lambertian diffuse (clamped)
-                float lambert = glm::max(glm::dot(normal, -lightDir), 0.0f);
-                glm::vec3 baseColor(0.7f, 0.2f, 0.2f);
-                color = baseColor * lambert;
-            } else {
-                // Background gradient
-                float u = float(x) / float(IMAGEX);
-                float v = float(y) / float(IMAGEY);
-                color = glm::mix(glm::vec3(0.6f, 0.8f, 1.0f), glm::vec3(0.2f, 0.3f, 0.5f), v);
-            }
-
-            // Write to framebuffer (convert to 0-255)
-            int idx = (y * IMAGEX + x) * 3;
-            framebuffer[idx + 0] = (unsigned char)(glm::clamp(color.r, 0.0f, 1.0f) * 255.0f);
-            framebuffer[idx + 1] = (unsigned char)(glm::clamp(color.g, 0.0f, 1.0f) * 255.0f);
-            framebuffer[idx + 2] = (unsigned char)(glm::clamp(color.b, 0.0f, 1.0f) * 255.0f);
+    if (mode == "sequence"){
+        // Out from the start position, once around the spheres and back, always
+        // looking at the middle of the group; the first keyframe is mainCam as set up
+        const glm::vec3 target(0.0f, 0.0f, 3.5f), up(0.0f, 1.0f, 0.0f);
+        const glm::vec3 stops[] = {
+            glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(3.0f, 1.0f, 1.0f), glm::vec3(3.5f, 2.0f, 5.5f),
+            glm::vec3(-3.5f, 2.0f, 5.5f), glm::vec3(-3.0f, 1.0f, 1.0f), glm::vec3(0.0f, 0.0f, 0.0f)
+        };
+        CameraPath path;
+        for (int k = 0; k < 6; k++)
+            path.addKeyframe({(float)k, stops[k], lookRotation(stops[k], target, up)});
+
+        TilePool pool(threadCount);
+        SequenceRenderer sequence(renderer, mainCam, pool, TILE_SIZE);
+        sequence.setTonemap(tonemap);
+        if (reproject)
+            sequence.setReprojection(ReprojectionSettings());
+        SequenceStats stats;
+        if (!sequence.render(path, frameCount, "output1", stats)){
+            std::cerr << "Failed to write " << sequenceFramePath("output1", stats.frames) << std::endl;
+            return 1;
         }
+        std::cout << "Wrote " << stats.frames << " frames (" << IMAGEX << "x" << IMAGEY << ") to output1_*.ppm in "
+                  << stats.seconds << " s, " << stats.frames / stats.seconds << " frames/s: "
+                  << stats.renderSeconds << " s rendering on " << threadCount << " threads, "
+                  << stats.writeSeconds << " s of writing overlapped" << std::endl;
+        if (reproject)
+            std::cout << 100.0 * stats.kept << "% of pixels kept their history" << std::endl;
+        return 0;
     }
 
-    // Write PPM
-    std::FILE *out = std::fopen("output1.ppm", "wb");
-    if (!out){
-        std::cerr << "Failed to open output1.ppm for writing" << std::endl;
-        return 1;
+    std::string outputPath = mode == "pfm" ? "output1.pfm" : mode == "exr" ? "output1.exr" : "output1.ppm";
+    auto frameStart = std::chrono::steady_clock::now();
+
+    // Colour of a tile, and its AOVs when any were asked for; without them the
+    // render is exactly what it was
+    AovBuffer aovs(IMAGEX, IMAGEY, aovMask);
+    auto renderTile = [&](const Tile &tile, glm::vec3 *pixels){
+        if (aovs.empty()) {
+            renderer.renderTile(tile, pixels);
+            return;
+        }
+        std::vector<AovSample> samples((size_t)tile.width * tile.height);
+        renderer.renderTile(tile, pixels, samples.data());
+        aovs.storeTile(tile, samples.data());
+    };
+
+    if (mode == "mmap" || mode == "pfm"){
+        // Tiles go straight into the mapped output file, one page-aligned band high
+        MappedImage image(outputPath, IMAGEX, IMAGEY, mode == "pfm" ? MappedFormat::PFM : MappedFormat::PPM, TILE_SIZE);
+        if (!image.isOpen()){
+            std::cerr << "Failed to map " << outputPath << " for writing" << std::endl;
+            return 1;
+        }
+        image.setTonemap(tonemap);
+        std::vector<Tile> tiles = makeTiles(IMAGEX, IMAGEY, TILE_SIZE);
+        forEachTile(tiles.size(), threadCount, [&](size_t i){
+            std::vector<glm::vec3> pixels((size_t)tiles[i].width * tiles[i].height);
+            renderTile(tiles[i], pixels.data());
+            image.storeTile(tiles[i], pixels.data());
+        });
+        if (!image.close()){
+            std::cerr << "Failed to write " << outputPath << std::endl;
+            return 1;
+        }
+        double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+        std::cout << "Wrote " << outputPath << " (" << IMAGEX << "x" << IMAGEY << ") through a memory mapping in "
+                  << totalSeconds << " s on " << threadCount << " threads" << std::endl;
+    } else if (mode == "exr"){
+        // Linear radiance for compositing: keep the whole float frame and encode it once
+        std::vector<glm::vec3> frame((size_t)IMAGEX * IMAGEY);
+        std::vector<Tile> tiles = makeTiles(IMAGEX, IMAGEY, TILE_SIZE);
+        forEachTile(tiles.size(), threadCount, [&](size_t i){
+            const Tile &tile = tiles[i];
+            std::vector<glm::vec3> pixels((size_t)tile.width * tile.height);
+            renderTile(tile, pixels.data());
+            for (int y = 0; y < tile.height; y++)
+                std::copy_n(&pixels[(size_t)y * tile.width], tile.width, &frame[(size_t)(tile.y0 + y) * IMAGEX + tile.x0]);
+        });
+        // The AOV layers go into the same file, next to R, G and B
+        const float *first = &frame[0].r;
+        size_t stride = sizeof(glm::vec3) / sizeof(float);
+        std::vector<ExrChannel> channels = aovs.exrChannels();
+        channels.push_back({"R", first, stride, ExrPixelType::Half});
+        channels.push_back({"G", first + 1, stride, ExrPixelType::Half});
+        channels.push_back({"B", first + 2, stride, ExrPixelType::Half});
+        if (!writeEXRChannels(outputPath, IMAGEX, IMAGEY, channels, ExrCompression::RLE)){
+            std::cerr << "Failed to write " << outputPath << std::endl;
+            return 1;
+        }
+        double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+        std::cout << "Wrote " << outputPath << " (" << IMAGEX << "x" << IMAGEY << ") in " << totalSeconds
+                  << " s on " << threadCount << " threads" << std::endl;
+    } else {
+        // Tiles go to the writer thread as they finish, so conversion and disk
+        // writes overlap with rendering and only a window of rows is kept in memory
+        AsyncImageWriter writer(outputPath, IMAGEX, IMAGEY, WRITER_WINDOW_ROWS);
+        if (!writer.isOpen()){
+            std::cerr << "Failed to open " << outputPath << " for writing" << std::endl;
+            return 1;
+        }
+        writer.setTonemap(tonemap);
+
+        // Tiles are claimed in row-major order, so the window only ever waits on earlier tiles
+        std::vector<Tile> tiles = makeTiles(IMAGEX, IMAGEY, TILE_SIZE);
+        forEachTile(tiles.size(), threadCount, [&](size_t i){
+            const Tile &tile = tiles[i];
+            writer.waitForRows(tile.y0 + tile.height);
+            auto result = std::make_unique<TileResult>();
+            result->tile = tile;
+            result->pixels.resize((size_t)tile.width * tile.height);
+            renderTile(tile, result->pixels.data());
+            writer.submit(std::move(result));
+        });
+        double renderSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+
+        if (!writer.finish()){
+            std::cerr << "Failed to write " << outputPath << std::endl;
+            return 1;
+        }
+        double totalSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+
+        std::cout << "Wrote " << outputPath << " (" << IMAGEX << "x" << IMAGEY << ") in " << totalSeconds << " s: "
+                  << renderSeconds << " s rendering on " << threadCount << " threads, "
+                  << writer.getBusySeconds() << " s of conversion and I/O overlapped" << std::endl;
     }
-    std::fprintf(out, "P6\n%d %d\n255\n", IMAGEX, IMAGEY);
-    std::fwrite(framebuffer.data(), 1, framebuffer.size(), out);
-    std::fclose(out);
 
-    std::cout << "Wrote output1.ppm (" << IMAGEX << "x" << IMAGEY << ")" << std::endl;
+    if (!aovs.empty() && mode != "exr"){
+        const char *aovPath = "output1_aov.exr";
+        if (!writeEXRChannels(aovPath, IMAGEX, IMAGEY, aovs.exrChannels(), ExrCompression::RLE)){
+            std::cerr << "Failed to write " << aovPath << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote " << aovPath << std::endl;
+    }
 
     // If running in VS Code terminal, open the file there
     const char* vscode_ipc_path = std::getenv("VSCODE_IPC_HOOK_CLI");
     if (vscode_ipc_path) {
-        std::cout << "Opening output1.ppm in VS Code..." << std::endl;
-        std::system("code output1.ppm");
+        std::cout << "Opening " << outputPath << " in VS Code..." << std::endl;
+        std::system(("code " + outputPath).c_str());
     } else {
         // Else open using OS-specific commands
         #if defined(_WIN32) || defined(_WIN64)
-            std::system("start output1.ppm");
+            std::system(("start " + outputPath).c_str());
         #elif defined(__APPLE__)
-            std::system("open output1.ppm");
+            std::system(("open " + outputPath).c_str());
         #else
-            std::system("xdg-open output1.ppm");
+            std::system(("xdg-open " + outputPath).c_str());
         #endif
     }
 }
\ No newline at end of file
@@ -0,0 +1,120 @@
+#include "mapped_image.hpp"
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static size_t roundUp(size_t value, size_t multiple){
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+MappedImage::MappedImage(const std::string &path, int width, int height, MappedFormat format, int minBandRows)
+    : width(width), height(height), format(format){
+    pageSize = (size_t)sysconf(_SC_PAGESIZE);
+    rowBytes = (size_t)width * (format == MappedFormat::PPM ? 3 : 3 * sizeof(float));
+
+    // Pad the header so pixel data starts on a page. P6 allows a comment line
+    // before the size; PFM readers tokenize on whitespace, so pad the size line.
+    std::string size = std::to_string(width) + " " + std::to_string(height);
+    std::string header;
+    if (format == MappedFormat::PPM) {
+        std::string base = "P6\n" + size + "\n255\n";
+        dataOffset = roundUp(base.size() + 2, pageSize);
+        header = "P6\n#" + std::string(dataOffset - base.size() - 2, ' ') + "\n" + size + "\n255\n";
+    } else {
+        std::string base = "PF\n" + size + "\n-1.0\n";   // negative scale: little-endian floats
+        dataOffset = roundUp(base.size(), pageSize);
+        header = "PF\n" + size + std::string(dataOffset - base.size(), ' ') + "\n-1.0\n";
+    }
+
+    // Bands are not rounded to whole pages: with an odd row size that would take
+    // a page's worth of rows, gigabytes for a wide image
+    bandRows = std::max(minBandRows, 1);
+    int bandCount = (height + bandRows - 1) / bandRows;
+    bandPixels.reset(new std::atomic<long long>[bandCount]);
+    for (int b = 0; b < bandCount; b++)
+        bandPixels[b] = (long long)std::min(bandRows, height - b * bandRows) * width;
+
+    fileSize = dataOffset + rowBytes * height;
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+        return;
+    if (ftruncate(fd, (off_t)fileSize) != 0) {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    void *p = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (p == MAP_FAILED) {
+        ::close(fd);
+        fd = -1;
+        return;
+    }
+    mapping = (unsigned char *)p;
+    std::memcpy(mapping, header.data(), header.size());
+
+    // Bands are finished roughly in order and never read back
+    madvise(mapping, fileSize, MADV_SEQUENTIAL);
+}
+
+MappedImage::~MappedImage(){
+    close();
+}
+
+unsigned char *MappedImage::rowAddress(int y) const{
+    // PFM stores the bottom row first
+    int fileRow = format == MappedFormat::PFM ? height - 1 - y : y;
+    return mapping + dataOffset + rowBytes * fileRow;
+}
+
+void MappedImage::storeTile(const Tile &tile, const glm::vec3 *pixels){
+    for (int y = 0; y < tile.height; y++) {
+        const glm::vec3 *src = pixels + (size_t)y * tile.width;
+        unsigned char *row = rowAddress(tile.y0 + y);
+        if (format == MappedFormat::PPM) {
+            tonemapRow(&src->r, row + (size_t)tile.x0 * 3, tile.width, tile.x0, tile.y0 + y, tonemap);
+        } else {
+            std::memcpy(row + (size_t)tile.x0 * 3 * sizeof(float), src, (size_t)tile.width * 3 * sizeof(float));
+        }
+    }
+
+    // Count the pixels into their bands; whoever stores the last one flushes it
+    int fileFirst = format == MappedFormat::PFM ? height - tile.y0 - tile.height : tile.y0;
+    for (int y = fileFirst; y < fileFirst + tile.height; ) {
+        int band = y / bandRows;
+        int rows = std::min((band + 1) * bandRows, fileFirst + tile.height) - y;
+        long long done = (long long)rows * tile.width;
+        if (bandPixels[band].fetch_sub(done, std::memory_order_acq_rel) == done)
+            completeBand(band);
+        y += rows;
+    }
+}
+
+void MappedImage::completeBand(int band){
+    // Start writeback of the band's pages, then drop them from this process:
+    // from the page holding its first row up to, but not including, the page
+    // it shares with the next band, which that band drops. The last band takes
+    // everything to the end of the file. A page dropped while the band before
+    // is still writing to it only faults back in; on a shared mapping the data
+    // stays in the page cache, so nothing is lost.
+    size_t first = dataOffset + rowBytes * band * bandRows;
+    size_t begin = first / pageSize * pageSize;
+    bool last = (band + 1) * bandRows >= height;
+    size_t end = last ? fileSize : (first + rowBytes * bandRows) / pageSize * pageSize;
+    if (end <= begin)
+        return;   // inside one page, which the next band drops
+    if (msync(mapping + begin, end - begin, MS_ASYNC) != 0)
+        syncFailed = true;
+    madvise(mapping + begin, end - begin, MADV_DONTNEED);
+}
+
+bool MappedImage::close(){
+    if (!mapping)
+        return false;
+    bool ok = msync(mapping, fileSize, MS_SYNC) == 0 && !syncFailed;
+    munmap(mapping, fileSize);
+    mapping = nullptr;
+    ok = ::close(fd) == 0 && ok;
+    fd = -1;
+    return ok;
+}
@@ -0,0 +1,66 @@
+#ifndef MAPPED_IMAGE_HPP
+#define MAPPED_IMAGE_HPP
+
+#include "glm/glm.hpp"
+#include "renderer.hpp"
+#include "tonemap.hpp"
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <string>
+
+enum class MappedFormat {
+    PPM,   // binary P6, 8 bits per channel
+    PFM    // Portable Float Map, 32-bit float RGB, rows stored bottom to top
+};
+
+// Output image that lives in a memory-mapped file rather than in RAM, for
+// renders too large to hold as a framebuffer. The file is created at its final
+// size and mapped shared, and render threads store tiles straight into the
+// mapping. Rows are grouped into bands of a fixed height. When the last pixel
+// of a band arrives, its pages are msync'd and dropped from the process, so
+// resident memory stays around the bands still in flight. A page that a band
+// shares with the next one is left for that band to drop.
+class MappedImage {
+    private:
+        int width, height;
+        MappedFormat format;
+        TonemapSettings tonemap;   // PPM only, PFM keeps linear floats
+        int fd = -1;
+        unsigned char *mapping = nullptr;
+        size_t fileSize = 0;
+        size_t pageSize = 0;
+        size_t dataOffset = 0;    // page-aligned start of the pixel rows
+        size_t rowBytes = 0;
+        int bandRows = 0;
+        std::unique_ptr<std::atomic<long long>[]> bandPixels;   // pixels still missing per band
+        std::atomic<bool> syncFailed{false};
+
+        unsigned char *rowAddress(int y) const;
+        void completeBand(int band);
+
+    public:
+        // Bands are minBandRows rows, at least one
+        MappedImage(const std::string &path, int width, int height, MappedFormat format, int minBandRows = 32);
+        ~MappedImage();
+
+        MappedImage(const MappedImage &) = delete;
+        MappedImage &operator=(const MappedImage &) = delete;
+
+        bool isOpen() const { return mapping != nullptr; }
+
+        // Rows per flush band; tiles that match it complete one band each
+        int getBandRows() const { return bandRows; }
+
+        // How PPM tiles become bytes; set before the first storeTile
+        void setTonemap(const TonemapSettings &settings) { tonemap = settings; }
+
+        // Converts tile.width * tile.height colours into the mapping. Safe to call
+        // from several threads for disjoint tiles.
+        void storeTile(const Tile &tile, const glm::vec3 *pixels);
+
+        // Flushes anything left and unmaps the file. False if any msync failed.
+        bool close();
+};
+
+#endif // MAPPED_IMAGE_HPP
@@ -0,0 +1,56 @@
+#ifndef MULTIVERSION_HPP
+#define MULTIVERSION_HPP
+
+#include <cmath>
+
+// Marks a hot kernel to be compiled once per x86-64 level (SSE4.2, AVX2 + FMA,
+// AVX-512) next to the baseline build. The loader picks the best copy for the
+// CPU through an ifunc, so one binary runs everywhere and still uses the wide
+// units where they exist. Everything inlined into a kernel is built with it.
+// Mark static functions only: with LTO, GCC loses the baseline copy of a
+// multiversioned function that other files call, and cannot clone virtuals.
+//
+// Builds for a fixed target (-march=native) or without ifunc support define
+// NO_MULTIVERSION and get the plain function.
+#if defined(__x86_64__) && defined(__GNUC__) && !defined(__clang__) && !defined(NO_MULTIVERSION)
+#define MULTIVERSION __attribute__((target_clones("arch=x86-64-v4", "arch=x86-64-v3", "arch=x86-64-v2", "default")))
+#define MULTIVERSION_ENABLED 1
+#else
+#define MULTIVERSION
+#define MULTIVERSION_ENABLED 0
+#endif
+
+// For helpers of a kernel: a call that is not inlined goes to a copy built for
+// the baseline, which loses the wider instructions (and turns std::fma into a
+// library call) in the middle of the kernel
+#define ALWAYS_INLINE inline __attribute__((always_inline))
+
+// Whether the copies the loader picks on this CPU compile std::fma to one
+// instruction. Everywhere else it is a call to fmaf, so kernels that use it
+// need a plain multiply-add version to fall back on.
+inline bool multiversionHasFma(){
+#if MULTIVERSION_ENABLED
+    return __builtin_cpu_supports("x86-64-v3");
+#elif defined(FP_FAST_FMAF)
+    return true;
+#else
+    return false;
+#endif
+}
+
+// Instruction set of the copies the loader picks on this CPU
+inline const char *multiversionIsa(){
+#if MULTIVERSION_ENABLED
+    if (__builtin_cpu_supports("x86-64-v4"))
+        return "AVX-512";
+    if (__builtin_cpu_supports("x86-64-v3"))
+        return "AVX2";
+    if (__builtin_cpu_supports("x86-64-v2"))
+        return "SSE4.2";
+    return "SSE2";
+#else
+    return "build target";
+#endif
+}
+
+#endif
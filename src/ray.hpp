@@ -1,14 +1,40 @@
 #ifndef RAY_HPP
 #define RAY_HPP
 
-#include "glm/glm.hpp"
+#include "vecmath.hpp"
+#include <cmath>
+
+// 1 / d, with a zero component replaced by a tiny one of the same sign so
+// that the inverse and origin times inverse stay finite, and the slab tests
+// never compute infinity minus infinity
+inline glm::vec3 safeReciprocal(const glm::vec3 &d){
+    glm::vec3 r;
+    for (int i = 0; i < 3; i++)
+        r[i] = 1.0f / (d[i] != 0.0f ? d[i] : std::copysign(1e-20f, d[i]));
+    return r;
+}
 
 struct Ray {
-    glm::vec3 origin;
-    glm::vec3 direction;
+    rtVec3 origin;
+    rtVec3 direction;
+    glm::vec3 invDirection;    // for the BVH slab tests
 
-    Ray(glm::vec3 o, glm::vec3 &d)
-        : origin(o), direction(glm::normalize(d)) {}
+    Ray(const rtVec3 &o, const rtVec3 &d)
+        : origin(o), direction(rtNormalize(d)), invDirection(safeReciprocal(toVec3(direction))) {}
 };
 
-#endif // RAY_HPP
\ No newline at end of file
+// N rays in structure-of-arrays layout for the SIMD packet kernels
+template <int N>
+struct RayPacket {
+    float ox[N], oy[N], oz[N];
+    float dx[N], dy[N], dz[N];
+
+    void set(int lane, const Ray &ray) {
+        ox[lane] = ray.origin.x;    oy[lane] = ray.origin.y;    oz[lane] = ray.origin.z;
+        dx[lane] = ray.direction.x; dy[lane] = ray.direction.y; dz[lane] = ray.direction.z;
+    }
+};
+
+using RayPacket4 = RayPacket<4>;
+
+#endif // RAY_HPP
@@ -0,0 +1,98 @@
+#include "render_client.hpp"
+#include <cstring>
+#include <unistd.h>
+
+RenderClient::RenderClient(const std::string &socketPath){
+    fd = connectUnix(socketPath);
+    if (fd < 0)
+        error = "cannot connect to " + socketPath;
+}
+
+RenderClient::~RenderClient(){
+    if (fd >= 0)
+        close(fd);
+}
+
+bool RenderClient::waitDone(RenderDone *done){
+    MessageType type;
+    std::vector<unsigned char> payload;
+    if (!recvMessage(fd, type, payload)) {
+        error = "connection lost";
+        return false;
+    }
+    return acceptDone(type, payload, done);
+}
+
+bool RenderClient::acceptDone(MessageType type, const std::vector<unsigned char> &payload, RenderDone *done){
+    if (type == MessageType::Error) {
+        error = std::string(payload.begin(), payload.end());
+        return false;
+    }
+    if (type != MessageType::Done || payload.size() != sizeof(RenderDone)) {
+        error = "unexpected reply";
+        return false;
+    }
+    if (done)
+        std::memcpy(done, payload.data(), sizeof(RenderDone));
+    return true;
+}
+
+bool RenderClient::setScene(const std::vector<Sphere> &spheres, const glm::vec3 &lightDir, RenderDone *done){
+    std::vector<unsigned char> payload = encodeScene(spheres, lightDir);
+    if (!sendMessage(fd, MessageType::Scene, payload.data(), payload.size())) {
+        error = "connection lost";
+        return false;
+    }
+    return waitDone(done);
+}
+
+bool RenderClient::setCamera(const CameraState &camera){
+    if (!sendMessage(fd, MessageType::Camera, &camera, sizeof(camera))) {
+        error = "connection lost";
+        return false;
+    }
+    return waitDone(nullptr);
+}
+
+bool RenderClient::render(const RenderRequest &request, std::vector<unsigned char> &rgb, RenderDone *done){
+    if (!sendMessage(fd, MessageType::Render, &request, sizeof(request))) {
+        error = "connection lost";
+        return false;
+    }
+    rgb.assign((size_t)request.width * request.height * 3, 0);
+
+    MessageType type;
+    std::vector<unsigned char> payload;
+    while (recvMessage(fd, type, payload)) {
+        // Anything but a tile ends the render
+        if (type != MessageType::Tile)
+            return acceptDone(type, payload, done);
+
+        TileHeader tile;
+        if (payload.size() < sizeof(tile)) {
+            error = "malformed tile";
+            return false;
+        }
+        std::memcpy(&tile, payload.data(), sizeof(tile));
+        if (tile.x0 < 0 || tile.y0 < 0 || tile.width <= 0 || tile.height <= 0
+            || tile.x0 + tile.width > request.width || tile.y0 + tile.height > request.height
+            || payload.size() != sizeof(tile) + (size_t)tile.width * tile.height * 3) {
+            error = "malformed tile";
+            return false;
+        }
+        const unsigned char *src = payload.data() + sizeof(tile);
+        for (int y = 0; y < tile.height; y++)
+            std::memcpy(&rgb[((size_t)(tile.y0 + y) * request.width + tile.x0) * 3], src + (size_t)y * tile.width * 3,
+                        (size_t)tile.width * 3);
+    }
+    error = "connection lost";
+    return false;
+}
+
+bool RenderClient::shutdown(){
+    if (!sendMessage(fd, MessageType::Shutdown)) {
+        error = "connection lost";
+        return false;
+    }
+    return waitDone(nullptr);
+}
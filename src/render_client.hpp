@@ -0,0 +1,44 @@
+#ifndef RENDER_CLIENT_HPP
+#define RENDER_CLIENT_HPP
+
+#include "glm/glm.hpp"
+#include "render_protocol.hpp"
+#include "sphere.hpp"
+#include <string>
+#include <vector>
+
+// Connection to a RenderServer. Every call blocks until the server has
+// answered; on failure getError() says why.
+class RenderClient {
+    private:
+        int fd = -1;
+        std::string error;
+
+        // Checks the Done that ends a request, copying it to done if given
+        bool acceptDone(MessageType type, const std::vector<unsigned char> &payload, RenderDone *done);
+        bool waitDone(RenderDone *done);
+
+    public:
+        explicit RenderClient(const std::string &socketPath = RENDER_SOCKET_PATH);
+        ~RenderClient();
+
+        RenderClient(const RenderClient &) = delete;
+        RenderClient &operator=(const RenderClient &) = delete;
+
+        bool isConnected() const { return fd >= 0; }
+        const std::string &getError() const { return error; }
+
+        // Replaces the server's scene; it builds the BVH before answering
+        bool setScene(const std::vector<Sphere> &spheres, const glm::vec3 &lightDir, RenderDone *done = nullptr);
+
+        bool setCamera(const CameraState &camera);
+
+        // Renders with the current scene and camera and assembles the streamed
+        // tiles into rgb, width * height * 3 bytes row by row from the top
+        bool render(const RenderRequest &request, std::vector<unsigned char> &rgb, RenderDone *done = nullptr);
+
+        // Asks the server process to exit
+        bool shutdown();
+};
+
+#endif // RENDER_CLIENT_HPP
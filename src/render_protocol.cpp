@@ -0,0 +1,283 @@
+#include "render_protocol.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+bool recvAll(int fd, void *data, size_t size){
+    char *p = static_cast<char *>(data);
+    while (size > 0) {
+        ssize_t n = recv(fd, p, size, 0);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+bool sendMessage(int fd, MessageType type, const void *payload, size_t size, const void *extra, size_t extraSize){
+    MessageHeader header{(uint32_t)type, (uint32_t)(size + extraSize)};
+    iovec parts[3] = {
+        {&header, sizeof(header)},
+        {const_cast<void *>(payload), size},
+        {const_cast<void *>(extra), extraSize},
+    };
+    int count = extraSize > 0 ? 3 : size > 0 ? 2 : 1;
+    size_t left = sizeof(header) + size + extraSize;
+    iovec *part = parts;
+    // writev may stop early on a socket; skip what was sent and go again
+    while (left > 0) {
+        msghdr msg{};
+        msg.msg_iov = part;
+        msg.msg_iovlen = count;
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        left -= (size_t)n;
+        while (count > 0 && (size_t)n >= part->iov_len) {
+            n -= (ssize_t)part->iov_len;
+            part++;
+            count--;
+        }
+        if (count > 0) {
+            part->iov_base = static_cast<char *>(part->iov_base) + n;
+            part->iov_len -= (size_t)n;
+        }
+    }
+    return true;
+}
+
+bool recvMessage(int fd, MessageType &type, std::vector<unsigned char> &payload){
+    MessageHeader header;
+    if (!recvAll(fd, &header, sizeof(header)) || header.size > RENDER_MAX_MESSAGE)
+        return false;
+    type = (MessageType)header.type;
+    payload.resize(header.size);
+    return header.size == 0 || recvAll(fd, payload.data(), header.size);
+}
+
+void appendMessage(std::vector<unsigned char> &buffer, MessageType type, const void *payload, size_t size){
+    MessageHeader header{(uint32_t)type, (uint32_t)size};
+    const unsigned char *h = reinterpret_cast<const unsigned char *>(&header);
+    buffer.insert(buffer.end(), h, h + sizeof(header));
+    if (size > 0) {
+        const unsigned char *p = static_cast<const unsigned char *>(payload);
+        buffer.insert(buffer.end(), p, p + size);
+    }
+}
+
+bool sendPending(int fd, std::vector<unsigned char> &buffer){
+    size_t sent = 0;
+    while (sent < buffer.size()) {
+        ssize_t n = send(fd, buffer.data() + sent, buffer.size() - sent, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        if (n <= 0)
+            return false;
+        sent += (size_t)n;
+    }
+    buffer.erase(buffer.begin(), buffer.begin() + sent);
+    return true;
+}
+
+bool recvPending(int fd, std::vector<unsigned char> &buffer){
+    const size_t chunk = 64 << 10;
+    while (true) {
+        size_t used = buffer.size();
+        buffer.resize(used + chunk);
+        ssize_t n = recv(fd, buffer.data() + used, chunk, MSG_DONTWAIT);
+        buffer.resize(used + (n > 0 ? (size_t)n : 0));
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return true;
+        if (n <= 0)
+            return false;
+    }
+}
+
+int takeMessage(std::vector<unsigned char> &buffer, MessageType &type, std::vector<unsigned char> &payload){
+    MessageHeader header;
+    if (buffer.size() < sizeof(header))
+        return 0;
+    std::memcpy(&header, buffer.data(), sizeof(header));
+    if (header.size > RENDER_MAX_MESSAGE)
+        return -1;
+    if (buffer.size() < sizeof(header) + header.size)
+        return 0;
+    type = (MessageType)header.type;
+    payload.assign(buffer.begin() + sizeof(header), buffer.begin() + sizeof(header) + header.size);
+    buffer.erase(buffer.begin(), buffer.begin() + sizeof(header) + header.size);
+    return 1;
+}
+
+static bool makeAddress(const std::string &path, sockaddr_un &address){
+    if (path.size() >= sizeof(address.sun_path))
+        return false;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return true;
+}
+
+int listenUnix(const std::string &path){
+    sockaddr_un address;
+    if (!makeAddress(path, address))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    unlink(path.c_str());
+    if (bind(fd, (const sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 8) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int connectUnix(const std::string &path){
+    sockaddr_un address;
+    if (!makeAddress(path, address))
+        return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, (const sockaddr *)&address, sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int listenTcp(int port){
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons((uint16_t)port);
+    if (bind(fd, (const sockaddr *)&address, sizeof(address)) != 0 || listen(fd, 8) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int connectTcp(const std::string &host, int port){
+    addrinfo hints{}, *found = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &found) != 0)
+        return -1;
+    int fd = -1;
+    for (addrinfo *a = found; a && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+        if (fd >= 0 && connect(fd, a->ai_addr, a->ai_addrlen) != 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(found);
+    if (fd >= 0)
+        setNoDelay(fd);
+    return fd;
+}
+
+int boundPort(int fd){
+    sockaddr_in address{};
+    socklen_t size = sizeof(address);
+    if (getsockname(fd, (sockaddr *)&address, &size) != 0 || address.sin_family != AF_INET)
+        return -1;
+    return ntohs(address.sin_port);
+}
+
+void setNoDelay(int fd){
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+}
+
+void setNonBlocking(int fd){
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags >= 0)
+        fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+bool parseHostPort(const std::string &address, std::string &host, int &port){
+    size_t colon = address.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == address.size())
+        return false;
+    host = address.substr(0, colon);
+    char *end;
+    long value = std::strtol(address.c_str() + colon + 1, &end, 10);
+    if (*end != '\0' || value <= 0 || value > 65535)
+        return false;
+    port = (int)value;
+    return true;
+}
+
+std::vector<unsigned char> encodeScene(const std::vector<Sphere> &spheres, const glm::vec3 &lightDir){
+    std::vector<float> values = {lightDir.x, lightDir.y, lightDir.z};
+    values.reserve(4 + spheres.size() * 4);
+    uint32_t count = (uint32_t)spheres.size();
+    for (const Sphere &s : spheres)
+        values.insert(values.end(), {s.getCenter().x, s.getCenter().y, s.getCenter().z, s.getRadius()});
+    std::vector<unsigned char> payload(sizeof(count) + values.size() * sizeof(float));
+    std::memcpy(payload.data(), &count, sizeof(count));
+    std::memcpy(payload.data() + sizeof(count), values.data(), values.size() * sizeof(float));
+    return payload;
+}
+
+bool decodeScene(const std::vector<unsigned char> &payload, std::vector<Sphere> &spheres, glm::vec3 &lightDir){
+    uint32_t count;
+    if (payload.size() < sizeof(count) + 3 * sizeof(float))
+        return false;
+    std::memcpy(&count, payload.data(), sizeof(count));
+    if (payload.size() != sizeof(count) + (3 + (size_t)count * 4) * sizeof(float))
+        return false;
+    std::vector<float> values((payload.size() - sizeof(count)) / sizeof(float));
+    std::memcpy(values.data(), payload.data() + sizeof(count), values.size() * sizeof(float));
+    lightDir = glm::vec3(values[0], values[1], values[2]);
+    spheres.clear();
+    spheres.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+        const float *v = &values[3 + i * 4];
+        spheres.push_back(Sphere(glm::vec3(v[0], v[1], v[2]), v[3]));
+    }
+    return true;
+}
+
+CameraState makeCameraState(const glm::vec3 &position, const camAxis &axis, int fov, float aspectRatio){
+    CameraState state;
+    for (int i = 0; i < 3; i++) {
+        state.position[i] = position[i];
+        state.right[i] = axis.getRight()[i];
+        state.up[i] = axis.getUp()[i];
+        state.forward[i] = axis.getForward()[i];
+    }
+    state.fov = fov;
+    state.aspectRatio = aspectRatio;
+    return state;
+}
+
+Camera toCamera(const CameraState &state){
+    auto vec = [](const float *v){ return glm::vec3(v[0], v[1], v[2]); };
+    camAxis axis(vec(state.right), vec(state.up), vec(state.forward));
+    return Camera(vec(state.position), axis, state.fov, state.aspectRatio);
+}
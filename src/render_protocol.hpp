@@ -0,0 +1,121 @@
+#ifndef RENDER_PROTOCOL_HPP
+#define RENDER_PROTOCOL_HPP
+
+#include "glm/glm.hpp"
+#include "camera.hpp"
+#include "sphere.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Wire format between the render server and its clients, over a Unix domain
+// socket or TCP. Every message is a MessageHeader followed by size payload
+// bytes. Fields are in native byte order, so every node must share it.
+//
+//   client -> server        server -> client
+//   Scene                   Done (acknowledges) or Error
+//   Camera                  Done or Error
+//   Render                  Tile ... Tile, then Done or Error
+//   Job                     Samples or Error
+//   Shutdown                Done, then the server exits
+//
+// Jobs are what a distributed coordinator sends its workers. Several may be in
+// flight on one connection; they are answered in order.
+
+#define RENDER_SOCKET_PATH "/tmp/raytracer.sock"
+#define RENDER_MAX_MESSAGE (256u << 20)
+
+enum class MessageType : uint32_t {
+    Scene = 1,      // light direction, sphere count, spheres
+    Camera = 2,     // CameraState
+    Render = 3,     // RenderRequest
+    Tile = 4,       // TileHeader, then width * height * 3 bytes of RGB
+    Done = 5,       // RenderDone
+    Error = 6,      // message text
+    Shutdown = 7,   // empty
+    Job = 8,        // SampleJob
+    Samples = 9     // SampleJob, then width * height * 3 floats of sample sums
+};
+
+struct MessageHeader {
+    uint32_t type;
+    uint32_t size;
+};
+
+struct CameraState {
+    float position[3];
+    float right[3], up[3], forward[3];
+    int32_t fov;
+    float aspectRatio;
+};
+
+struct RenderRequest {
+    int32_t width, height;
+    int32_t tileSize;
+    int32_t encoding;   // 0 linear, 1 sRGB, 2 filmic (ACES, sRGB, dithered)
+};
+
+struct TileHeader {
+    int32_t x0, y0;
+    int32_t width, height;
+};
+
+struct SampleJob {
+    int32_t id;
+    int32_t x0, y0;
+    int32_t width, height;
+    int32_t firstSample, sampleCount;
+    int32_t imageWidth, imageHeight;
+};
+
+struct RenderDone {
+    int32_t tiles;          // tiles sent for a render, 0 for other requests
+    float serverSeconds;    // time the server spent on the request
+};
+
+// Blocking read of exactly size bytes, retried on EINTR. False on error or EOF.
+bool recvAll(int fd, void *data, size_t size);
+
+// One message with its payload in up to two pieces, sent with a single writev
+bool sendMessage(int fd, MessageType type, const void *payload = nullptr, size_t size = 0,
+                 const void *extra = nullptr, size_t extraSize = 0);
+
+// Reads the next message. False on error, EOF or an oversized message.
+bool recvMessage(int fd, MessageType &type, std::vector<unsigned char> &payload);
+
+// The same framing for a socket served from a poll loop, which must not
+// block on one peer. appendMessage queues a message in an outgoing buffer and
+// sendPending sends what the socket takes now; recvPending adds what has
+// arrived to an incoming buffer, and takeMessage moves the first complete
+// message out of it. takeMessage returns 1 with a message, 0 while the next
+// one is incomplete and -1 when it is oversized; the others false on error or
+// EOF.
+void appendMessage(std::vector<unsigned char> &buffer, MessageType type, const void *payload = nullptr,
+                   size_t size = 0);
+bool sendPending(int fd, std::vector<unsigned char> &buffer);
+bool recvPending(int fd, std::vector<unsigned char> &buffer);
+int takeMessage(std::vector<unsigned char> &buffer, MessageType &type, std::vector<unsigned char> &payload);
+
+// Socket setup; -1 on failure. listenUnix replaces a stale socket file.
+int listenUnix(const std::string &path);
+int connectUnix(const std::string &path);
+
+// TCP on every interface; port 0 picks a free one, see boundPort(). Accepted
+// and connected TCP sockets have Nagle's algorithm off, jobs being small.
+int listenTcp(int port);
+int connectTcp(const std::string &host, int port);
+int boundPort(int fd);
+void setNoDelay(int fd);
+void setNonBlocking(int fd);
+
+// Splits "host:port"
+bool parseHostPort(const std::string &address, std::string &host, int &port);
+
+std::vector<unsigned char> encodeScene(const std::vector<Sphere> &spheres, const glm::vec3 &lightDir);
+bool decodeScene(const std::vector<unsigned char> &payload, std::vector<Sphere> &spheres, glm::vec3 &lightDir);
+
+CameraState makeCameraState(const glm::vec3 &position, const camAxis &axis, int fov, float aspectRatio);
+Camera toCamera(const CameraState &state);
+
+#endif // RENDER_PROTOCOL_HPP
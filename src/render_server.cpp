@@ -0,0 +1,191 @@
+#include "render_server.hpp"
+#include "tonemap.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <mutex>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#define MAX_IMAGE_SIZE 16384
+#define MAX_TILE_SIZE 256
+
+static TonemapSettings encodingSettings(int encoding){
+    TonemapSettings settings;
+    if (encoding >= 1)
+        settings.transfer = OutputTransfer::SRGB;
+    if (encoding >= 2) {
+        settings.curve = ToneCurve::ACES;
+        settings.dither = true;
+    }
+    return settings;
+}
+
+static bool sendError(int fd, const std::string &text){
+    return sendMessage(fd, MessageType::Error, text.data(), text.size());
+}
+
+static bool sendDone(int fd, int tiles, std::chrono::steady_clock::time_point start){
+    RenderDone done{tiles, std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count()};
+    return sendMessage(fd, MessageType::Done, &done, sizeof(done));
+}
+
+RenderServer::RenderServer(const std::string &socketPath, unsigned threadCount)
+    : RenderServer(listenUnix(socketPath), threadCount){
+    this->socketPath = socketPath;
+}
+
+RenderServer::RenderServer(int listenFd, unsigned threadCount)
+    : listenFd(listenFd), threadCount(threadCount),
+      camera(glm::vec3(0.0f), camAxis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f)),
+             90, 1.0f) {}
+
+RenderServer::~RenderServer(){
+    if (listenFd >= 0) {
+        close(listenFd);
+        if (!socketPath.empty())
+            unlink(socketPath.c_str());
+    }
+}
+
+void RenderServer::stop(){
+    stopping.store(true);
+    // Wakes a blocked accept()
+    if (listenFd >= 0)
+        shutdown(listenFd, SHUT_RDWR);
+}
+
+void RenderServer::serve(){
+    while (!stopping.load()) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            break;
+        }
+        if (boundPort(fd) >= 0)
+            setNoDelay(fd);
+        bool keepGoing = serveClient(fd);
+        close(fd);
+        if (!keepGoing)
+            break;
+    }
+}
+
+bool RenderServer::serveClient(int fd){
+    MessageType type;
+    std::vector<unsigned char> payload;
+    while (!stopping.load() && recvMessage(fd, type, payload)) {
+        auto start = std::chrono::steady_clock::now();
+        bool ok = true;
+        switch (type) {
+        case MessageType::Scene:
+            if (!decodeScene(payload, spheres, lightDir)) {
+                ok = sendError(fd, "malformed scene");
+                break;
+            }
+            // The BVH is built here, once per scene rather than once per render
+            renderer = std::make_unique<Renderer>(camera, spheres, lightDir, 1, 1);
+            ok = sendDone(fd, 0, start);
+            break;
+        case MessageType::Camera:
+            if (payload.size() != sizeof(CameraState)) {
+                ok = sendError(fd, "malformed camera");
+                break;
+            }
+            {
+                CameraState state;
+                std::memcpy(&state, payload.data(), sizeof(state));
+                // The renderer holds a reference to camera, so it sees the new one
+                camera = toCamera(state);
+            }
+            ok = sendDone(fd, 0, start);
+            break;
+        case MessageType::Render: {
+            RenderRequest request;
+            if (payload.size() != sizeof(request)) {
+                ok = sendError(fd, "malformed render request");
+                break;
+            }
+            std::memcpy(&request, payload.data(), sizeof(request));
+            ok = render(fd, request);
+            break;
+        }
+        case MessageType::Job: {
+            SampleJob job;
+            if (payload.size() != sizeof(job)) {
+                ok = sendError(fd, "malformed job");
+                break;
+            }
+            std::memcpy(&job, payload.data(), sizeof(job));
+            ok = renderJob(fd, job);
+            break;
+        }
+        case MessageType::Shutdown:
+            sendDone(fd, 0, start);
+            stopping.store(true);
+            return false;
+        default:
+            ok = sendError(fd, "unknown message type");
+            break;
+        }
+        if (!ok)
+            break;
+    }
+    return !stopping.load();
+}
+
+bool RenderServer::render(int fd, const RenderRequest &request){
+    auto start = std::chrono::steady_clock::now();
+    if (!renderer)
+        return sendError(fd, "no scene loaded");
+    if (request.width <= 0 || request.height <= 0 || request.width > MAX_IMAGE_SIZE || request.height > MAX_IMAGE_SIZE
+        || request.tileSize <= 0 || request.tileSize > MAX_TILE_SIZE)
+        return sendError(fd, "bad image or tile size");
+
+    renderer->setImageSize(request.width, request.height);
+    TonemapSettings tonemap = encodingSettings(request.encoding);
+    std::vector<Tile> tiles = makeTiles(request.width, request.height, request.tileSize);
+    std::mutex sendMutex;
+    std::atomic<bool> sendFailed{false};
+    unsigned threads = std::min<unsigned>(threadCount, (unsigned)tiles.size());
+    forEachTile(tiles.size(), threads, [&](size_t i){
+        if (sendFailed.load(std::memory_order_relaxed))
+            return;
+        const Tile &tile = tiles[i];
+        std::vector<glm::vec3> pixels((size_t)tile.width * tile.height);
+        std::vector<unsigned char> bytes(pixels.size() * 3);
+        renderer->renderTile(tile, pixels.data());
+        for (int y = 0; y < tile.height; y++) {
+            size_t offset = (size_t)y * tile.width;
+            tonemapRow(&pixels[offset].r, &bytes[offset * 3], tile.width, tile.x0, tile.y0 + y, tonemap);
+        }
+        TileHeader header{tile.x0, tile.y0, tile.width, tile.height};
+        std::lock_guard<std::mutex> lock(sendMutex);
+        if (!sendMessage(fd, MessageType::Tile, &header, sizeof(header), bytes.data(), bytes.size()))
+            sendFailed.store(true);
+    });
+    if (sendFailed.load())
+        return false;
+    rendersServed++;
+    return sendDone(fd, (int)tiles.size(), start);
+}
+
+bool RenderServer::renderJob(int fd, const SampleJob &job){
+    if (!renderer)
+        return sendError(fd, "no scene loaded");
+    if (job.imageWidth <= 0 || job.imageHeight <= 0 || job.imageWidth > MAX_IMAGE_SIZE || job.imageHeight > MAX_IMAGE_SIZE
+        || job.x0 < 0 || job.y0 < 0 || job.width <= 0 || job.height <= 0 || job.width > MAX_TILE_SIZE
+        || job.height > MAX_TILE_SIZE || job.x0 + job.width > job.imageWidth || job.y0 + job.height > job.imageHeight
+        || job.firstSample < 0 || job.sampleCount <= 0)
+        return sendError(fd, "bad job");
+
+    renderer->setImageSize(job.imageWidth, job.imageHeight);
+    std::vector<glm::vec3> sums((size_t)job.width * job.height);
+    // The rows of the tile are shared between the render threads
+    forEachTile(job.height, std::min<unsigned>(threadCount, job.height), [&](size_t row){
+        Tile line{job.x0, job.y0 + (int)row, job.width, 1};
+        renderer->renderTileSamples(line, job.firstSample, job.sampleCount, &sums[row * job.width]);
+    });
+    return sendMessage(fd, MessageType::Samples, &job, sizeof(job), sums.data(), sums.size() * sizeof(glm::vec3));
+}
@@ -0,0 +1,58 @@
+#ifndef RENDER_SERVER_HPP
+#define RENDER_SERVER_HPP
+
+#include "glm/glm.hpp"
+#include "camera.hpp"
+#include "render_protocol.hpp"
+#include "renderer.hpp"
+#include "sphere.hpp"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Long-running renderer behind a Unix domain or TCP socket. The scene, its BVH
+// and the camera stay in memory between requests, so a render only pays for
+// the pixels. Clients are served one at a time; tiles are sent back as soon as
+// a render thread finishes them, so they arrive out of order. Over TCP it is
+// also the worker of a distributed render, answering Jobs with sample sums.
+class RenderServer {
+    private:
+        std::string socketPath;
+        int listenFd = -1;
+        unsigned threadCount;
+        std::atomic<bool> stopping{false};
+
+        std::vector<Sphere> spheres;
+        glm::vec3 lightDir{0.0f, 0.0f, 1.0f};
+        Camera camera;
+        std::unique_ptr<Renderer> renderer;   // built with the scene, null until one arrives
+        int rendersServed = 0;
+
+        // Serves one connection until it closes. False once a Shutdown was handled.
+        bool serveClient(int fd);
+        bool render(int fd, const RenderRequest &request);
+        bool renderJob(int fd, const SampleJob &job);
+
+    public:
+        RenderServer(const std::string &socketPath, unsigned threadCount);
+
+        // Serves on an already listening socket, which it takes over
+        RenderServer(int listenFd, unsigned threadCount);
+        ~RenderServer();
+
+        RenderServer(const RenderServer &) = delete;
+        RenderServer &operator=(const RenderServer &) = delete;
+
+        bool isOpen() const { return listenFd >= 0; }
+
+        // Accepts and serves clients until a Shutdown request or stop()
+        void serve();
+
+        // Makes serve() return after the current client. Async-signal-safe.
+        void stop();
+
+        int getRendersServed() const { return rendersServed; }
+};
+
+#endif // RENDER_SERVER_HPP
@@ -0,0 +1,177 @@
+#include "renderer.hpp"
+#include "aov.hpp"
+#include "filter.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#define SPHERE_COLOR glm::vec3(0.7f, 0.2f, 0.2f)   // of every sphere until setSphereColor
+
+std::vector<Tile> makeTiles(int width, int height, int tileSize){
+    std::vector<Tile> tiles;
+    for (int y = 0; y < height; y += tileSize)
+        for (int x = 0; x < width; x += tileSize)
+            tiles.push_back(Tile{x, y, std::min(tileSize, width - x), std::min(tileSize, height - y)});
+    return tiles;
+}
+
+Renderer::Renderer(const Camera &camera, const std::vector<Sphere> &spheres, const glm::vec3 &lightDir,
+                   int imageWidth, int imageHeight)
+    : camera(camera), spheres(spheres), sphereColors(spheres.size(), SPHERE_COLOR), bvh(spheres),
+      lightDir(toRtVec3(lightDir)), imageWidth(imageWidth), imageHeight(imageHeight) {}
+
+void Renderer::setSphere(int index, const Sphere &sphere){
+    spheres[index] = sphere;
+    bvh.update(index, sphere);
+}
+
+// Jittered position of sample s inside pixel (x, y): the R2 sequence, rotated
+// by a hash of the pixel so neighbouring pixels do not share a pattern
+static glm::vec2 samplePosition(int x, int y, int s){
+    uint32_t h = (uint32_t)x * 0x9E3779B1u ^ (uint32_t)y * 0x85EBCA77u;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 12;
+    float u = (h & 0xFFFF) / 65536.0f + s * 0.75487766f;
+    float v = (h >> 16) / 65536.0f + s * 0.56984029f;
+    return glm::vec2(u - std::floor(u), v - std::floor(v));
+}
+
+glm::vec3 Renderer::shade(int x, int y) const{
+    Ray ray = camera.generateRay(x, y, imageWidth, imageHeight);
+    return shadeRay<false>(ray, float(y) / float(imageHeight), nullptr);
+}
+
+template <bool WithAov>
+glm::vec3 Renderer::shadeRay(const Ray &ray, float v, AovSample *aov) const{
+    float closestT;
+    int hitSphereIndex = -1;
+    bvh.intersect(ray, TRACE_DISTANCE, closestT, hitSphereIndex);
+
+    if (hitSphereIndex == -1){
+        // Background gradient
+        glm::vec3 background = glm::mix(glm::vec3(0.6f, 0.8f, 1.0f), glm::vec3(0.2f, 0.3f, 0.5f), v);
+        if (WithAov)
+            *aov = AovSample{TRACE_DISTANCE, glm::vec3(0.0f), background, 0, 0};
+        return background;
+    }
+
+    rtVec3 hitPoint = ray.origin + ray.direction * closestT;
+    rtVec3 normal = rtNormalize(hitPoint - spheres[hitSphereIndex].getCenter());
+
+    // Lambertian diffuse (clamped), only lit if nothing blocks the light
+    float lambert = glm::max(glm::dot(normal, -lightDir), 0.0f);
+    bool shadowed = false;
+    if (lambert > 0.0f){
+        rtVec3 toLight = -lightDir;
+        Ray shadowRay(hitPoint + normal * SHADOW_EPSILON, toLight);
+        shadowed = bvh.occluded(shadowRay, INFINITY);
+        if (shadowed)
+            lambert = 0.0f;
+    }
+    const glm::vec3 &baseColor = sphereColors[hitSphereIndex];
+    if (WithAov)
+        *aov = AovSample{closestT, toVec3(normal), baseColor, (uint32_t)hitSphereIndex + 1, shadowed ? 2u : 1u};
+    return baseColor * lambert;
+}
+
+void Renderer::renderTile(const Tile &tile, glm::vec3 *pixels) const{
+    for (int y = 0; y < tile.height; y++)
+        for (int x = 0; x < tile.width; x++)
+            pixels[y * tile.width + x] = shade(tile.x0 + x, tile.y0 + y);
+}
+
+void Renderer::renderTile(const Tile &tile, glm::vec3 *pixels, AovSample *aovs) const{
+    for (int y = 0; y < tile.height; y++)
+        for (int x = 0; x < tile.width; x++) {
+            int px = tile.x0 + x, py = tile.y0 + y;
+            Ray ray = camera.generateRay(px, py, imageWidth, imageHeight);
+            pixels[y * tile.width + x] = shadeRay<true>(ray, float(py) / float(imageHeight), &aovs[y * tile.width + x]);
+        }
+}
+
+glm::vec3 Renderer::shadeSamples(int x, int y, int firstSample, int sampleCount) const{
+    glm::vec3 sum(0.0f);
+    for (int s = firstSample; s < firstSample + sampleCount; s++) {
+        glm::vec2 offset = samplePosition(x, y, s);
+        Ray ray = camera.generateRay(x + offset.x, y + offset.y, imageWidth, imageHeight);
+        sum += shadeRay<false>(ray, (y + offset.y) / imageHeight, nullptr);
+    }
+    return sum;
+}
+
+void Renderer::renderTileSamples(const Tile &tile, int firstSample, int sampleCount, glm::vec3 *sums) const{
+    for (int y = 0; y < tile.height; y++)
+        for (int x = 0; x < tile.width; x++)
+            sums[y * tile.width + x] = shadeSamples(tile.x0 + x, tile.y0 + y, firstSample, sampleCount);
+}
+
+void Renderer::firstHitTile(const Tile &tile, AovSample *hits) const{
+    for (int y = 0; y < tile.height; y++)
+        for (int x = 0; x < tile.width; x++) {
+            Ray ray = camera.generateRay(tile.x0 + x, tile.y0 + y, imageWidth, imageHeight);
+            float closestT;
+            int hitSphereIndex = -1;
+            bvh.intersect(ray, TRACE_DISTANCE, closestT, hitSphereIndex);
+            AovSample &hit = hits[y * tile.width + x];
+            if (hitSphereIndex == -1) {
+                hit = AovSample{TRACE_DISTANCE, glm::vec3(0.0f), glm::vec3(0.0f), 0, 0};
+                continue;
+            }
+            rtVec3 hitPoint = ray.origin + ray.direction * closestT;
+            glm::vec3 normal = toVec3(rtNormalize(hitPoint - spheres[hitSphereIndex].getCenter()));
+            hit = AovSample{closestT, normal, sphereColors[hitSphereIndex], (uint32_t)hitSphereIndex + 1, 1};
+        }
+}
+
+void Renderer::splatTileSamples(const Tile &tile, int firstSample, int sampleCount, const ReconstructionFilter &filter,
+                                glm::vec4 *buffer) const{
+    const int border = filter.getBorder();
+    const int bufferWidth = tile.width + 2 * border;
+    const int reach = 2 * border + 1;
+    float weightsX[2 * MAX_FILTER_BORDER + 1], weightsY[2 * MAX_FILTER_BORDER + 1];
+    for (int y = 0; y < tile.height; y++) {
+        for (int x = 0; x < tile.width; x++) {
+            int px = tile.x0 + x, py = tile.y0 + y;
+            for (int s = firstSample; s < firstSample + sampleCount; s++) {
+                glm::vec2 offset = samplePosition(px, py, s);
+                Ray ray = camera.generateRay(px + offset.x, py + offset.y, imageWidth, imageHeight);
+                glm::vec3 color = shadeRay<false>(ray, (py + offset.y) / imageHeight, nullptr);
+
+                // The filter is separable: one row of weights each way, then
+                // the outer product over the pixels in reach
+                for (int k = 0; k < reach; k++) {
+                    weightsX[k] = filter.evaluate(k - border + 0.5f - offset.x);
+                    weightsY[k] = filter.evaluate(k - border + 0.5f - offset.y);
+                }
+                for (int ky = 0; ky < reach; ky++) {
+                    if (weightsY[ky] == 0.0f)
+                        continue;
+                    glm::vec4 *row = &buffer[(size_t)(y + ky) * bufferWidth + x];
+                    for (int kx = 0; kx < reach; kx++) {
+                        float w = weightsX[kx] * weightsY[ky];
+                        row[kx] += glm::vec4(color * w, w);
+                    }
+                }
+            }
+        }
+    }
+}
+
+void Renderer::renderTileFiltered(const Tile &tile, int firstSample, int sampleCount, const FilterSampler &sampler,
+                                  glm::vec3 *sums) const{
+    for (int y = 0; y < tile.height; y++) {
+        for (int x = 0; x < tile.width; x++) {
+            int px = tile.x0 + x, py = tile.y0 + y;
+            glm::vec3 sum(0.0f);
+            for (int s = firstSample; s < firstSample + sampleCount; s++) {
+                float weight;
+                glm::vec2 offset = sampler.sample(samplePosition(px, py, s), weight);
+                float sx = px + 0.5f + offset.x, sy = py + 0.5f + offset.y;
+                Ray ray = camera.generateRay(sx, sy, imageWidth, imageHeight);
+                sum += shadeRay<false>(ray, sy / imageHeight, nullptr) * weight;
+            }
+            sums[y * tile.width + x] = sum;
+        }
+    }
+}
@@ -0,0 +1,116 @@
+#ifndef RENDERER_HPP
+#define RENDERER_HPP
+
+#include "glm/glm.hpp"
+#include "bvh.hpp"
+#include "camera.hpp"
+#include "sphere.hpp"
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#define SHADOW_EPSILON 1e-3f
+#define TRACE_DISTANCE 10000.0f    // far limit of camera rays
+
+struct AovSample;
+class FilterSampler;
+class ReconstructionFilter;
+
+// Rectangle of pixels, the unit of work handed to render threads
+struct Tile {
+    int x0, y0;
+    int width, height;
+};
+
+// Splits a width x height image into row-major tiles of at most tileSize pixels a side
+std::vector<Tile> makeTiles(int width, int height, int tileSize);
+
+// Runs work(tileIndex) for every tile on threadCount threads, tiles claimed in order
+template <typename Work>
+void forEachTile(size_t tileCount, unsigned threadCount, Work work){
+    std::atomic<size_t> nextTile{0};
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < threadCount; t++)
+        threads.emplace_back([&](){
+            for (size_t i = nextTile++; i < tileCount; i = nextTile++)
+                work(i);
+        });
+    for (std::thread &t : threads)
+        t.join();
+}
+
+// Shades pixels of one frame: closest hit, Lambert term from a directional
+// light with a shadow ray, gradient background on a miss. Shared by every
+// thread, so all rendering methods are const.
+class Renderer {
+    private:
+        const Camera &camera;
+        std::vector<Sphere> spheres;
+        std::vector<glm::vec3> sphereColors;
+        BVH bvh;
+        rtVec3 lightDir;
+        int imageWidth, imageHeight;
+
+        // Colour seen along a camera ray; v in [0,1] places it vertically for the background.
+        // WithAov also fills *aov; without it the AOV code is compiled out.
+        template <bool WithAov>
+        glm::vec3 shadeRay(const Ray &ray, float v, AovSample *aov) const;
+
+    public:
+        Renderer(const Camera &camera, const std::vector<Sphere> &spheres, const glm::vec3 &lightDir,
+                 int imageWidth, int imageHeight);
+
+        // Linear colour of pixel (x, y), y = 0 at the top
+        glm::vec3 shade(int x, int y) const;
+
+        // Writes tile.width * tile.height colours to pixels, row by row
+        void renderTile(const Tile &tile, glm::vec3 *pixels) const;
+
+        // The same, and the first-hit AOVs (aov.hpp) of every pixel into aovs
+        void renderTile(const Tile &tile, glm::vec3 *pixels, AovSample *aovs) const;
+
+        // Adds up samples firstSample .. firstSample + sampleCount - 1 of every
+        // pixel of the tile into sums, one colour per pixel, in sample order.
+        // Sample positions depend only on pixel and sample index, so any split
+        // of a pixel's samples into ranges gives the same per-range sums.
+        void renderTileSamples(const Tile &tile, int firstSample, int sampleCount, glm::vec3 *sums) const;
+
+        // Sum of samples firstSample .. firstSample + sampleCount - 1 of pixel
+        // (x, y), for callers that give every pixel its own sample count
+        glm::vec3 shadeSamples(int x, int y, int firstSample, int sampleCount) const;
+
+        // What the ray through each pixel centre hits first, without shading
+        // it: depth, normal and objectId as renderTile's AOVs report them,
+        // hitCount 1 on a hit (the camera ray alone). For reprojection.
+        void firstHitTile(const Tile &tile, AovSample *hits) const;
+
+        // The same samples as renderTileSamples, each splatted with the filter
+        // into every pixel it reaches: buffer (a SplatImage::Buffer) covers the
+        // tile and the filter's border around it, pixels as weighted colour
+        // sum and weight sum
+        void splatTileSamples(const Tile &tile, int firstSample, int sampleCount, const ReconstructionFilter &filter,
+                              glm::vec4 *buffer) const;
+
+        // Samples placed around each pixel centre by importance sampling the
+        // filter, added up as weight * colour into sums like renderTileSamples
+        void renderTileFiltered(const Tile &tile, int firstSample, int sampleCount, const FilterSampler &sampler,
+                                glm::vec3 *sums) const;
+
+        // For renderers kept alive between frames of different sizes; not while rendering
+        void setImageSize(int width, int height) { imageWidth = width; imageHeight = height; }
+
+        // Scene edits between frames, not while rendering. setSphere refits the
+        // BVH instead of rebuilding it (BVH::update).
+        void setSphere(int index, const Sphere &sphere);
+        void setSphereColor(int index, const glm::vec3 &color) { sphereColors[index] = color; }
+
+        const Sphere &getSphere(int index) const { return spheres[index]; }
+        int getSphereCount() const { return (int)spheres.size(); }
+        glm::vec3 getLightDir() const { return toVec3(lightDir); }
+        const Camera &getCamera() const { return camera; }
+
+        int getWidth() const { return imageWidth; }
+        int getHeight() const { return imageHeight; }
+};
+
+#endif // RENDERER_HPP
@@ -0,0 +1,124 @@
+#include "reprojection.hpp"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+ReprojectionCache::ReprojectionCache(const Renderer &renderer, const Camera &camera, TilePool &pool, int tileSize,
+                                     const ReprojectionSettings &settings)
+    : renderer(renderer), camera(camera), pool(pool), width(renderer.getWidth()), height(renderer.getHeight()),
+      settings(settings), tiles(makeTiles(width, height, tileSize)), tileHits(tiles.size()),
+      objectIds((size_t)width * height), current((size_t)width * height), previous((size_t)width * height),
+      previousCamera(camera){
+    for (size_t i = 0; i < tiles.size(); i++)
+        tileHits[i].resize((size_t)tiles[i].width * tiles[i].height);
+}
+
+void ReprojectionCache::render(std::vector<glm::vec3> &image, ReprojectionStats &stats){
+    image.resize((size_t)width * height);
+    std::vector<size_t> kept(tiles.size()), samples(tiles.size());
+    pool.run(tiles.size(), [&](size_t i){ traceTile(i); });
+    pool.run(tiles.size(), [&](size_t i){ renderTile(i, image, kept[i], samples[i]); });
+
+    stats = ReprojectionStats();
+    stats.pixels = image.size();
+    for (size_t i = 0; i < tiles.size(); i++) {
+        stats.kept += kept[i];
+        stats.samples += samples[i];
+    }
+    std::swap(current, previous);
+    previousCamera = camera;
+    hasHistory = true;
+}
+
+void ReprojectionCache::traceTile(size_t tileIndex){
+    const Tile &tile = tiles[tileIndex];
+    const AovSample *hits = tileHits[tileIndex].data();
+    renderer.firstHitTile(tile, tileHits[tileIndex].data());
+    for (int y = 0; y < tile.height; y++)
+        for (int x = 0; x < tile.width; x++)
+            objectIds[(size_t)(tile.y0 + y) * width + tile.x0 + x] = hits[y * tile.width + x].objectId;
+}
+
+bool ReprojectionCache::isEdge(int x, int y) const{
+    uint32_t id = objectIds[(size_t)y * width + x];
+    for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, height - 1); ny++)
+        for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, width - 1); nx++)
+            if (objectIds[(size_t)ny * width + nx] != id)
+                return true;
+    return false;
+}
+
+void ReprojectionCache::renderTile(size_t tileIndex, std::vector<glm::vec3> &image, size_t &kept, size_t &samples){
+    const Tile &tile = tiles[tileIndex];
+    const AovSample *hits = tileHits[tileIndex].data();
+    glm::vec3 previousPosition = previousCamera.getPosition();
+    kept = samples = 0;
+
+    for (int y = 0; y < tile.height; y++)
+        for (int x = 0; x < tile.width; x++) {
+            int px = tile.x0 + x, py = tile.y0 + y;
+            const AovSample &hit = hits[y * tile.width + x];
+            HistoryPixel &pixel = current[(size_t)py * width + px];
+            Ray ray = camera.generateRay(px, py, width, height);
+            pixel.position = toVec3(ray.origin + ray.direction * hit.depth);
+            pixel.normal = hit.normal;
+            pixel.depth = hit.depth;
+            pixel.objectId = hit.objectId;
+            pixel.edge = isEdge(px, py);
+
+            // The four previous pixels around where the point was seen, weighted
+            // bilinearly; every one of them must have seen the same surface.
+            // Nearest pixel alone is half a pixel off at worst, which blurs
+            // the image a little more with every frame. Misses stay put.
+            glm::vec2 q = glm::vec2(px, py) + 0.5f;
+            bool visible = true;
+            if (hit.objectId != 0)
+                visible = previousCamera.project(pixel.position, width, height, q);
+            pixel.sum = glm::vec3(0.0f);
+            pixel.weight = 0.0f;
+            pixel.nextSample = 0;
+            bool keep = hasHistory && !pixel.edge && visible;
+            if (keep) {
+                float depth = glm::length(pixel.position - previousPosition);
+                int x0 = (int)std::floor(q.x - 0.5f), y0 = (int)std::floor(q.y - 0.5f);
+                float fx = q.x - 0.5f - x0, fy = q.y - 0.5f - y0;
+                for (int j = 0; j < 4 && keep; j++) {
+                    int qx = x0 + (j & 1), qy = y0 + (j >> 1);
+                    float w = ((j & 1) ? fx : 1.0f - fx) * ((j >> 1) ? fy : 1.0f - fy);
+                    if (w == 0.0f)
+                        continue;
+                    keep = qx >= 0 && qx < width && qy >= 0 && qy < height;
+                    if (!keep)
+                        break;
+                    const HistoryPixel &old = previous[(size_t)qy * width + qx];
+                    keep = old.objectId == pixel.objectId && !old.edge;
+                    if (keep && pixel.objectId != 0)
+                        keep = glm::dot(old.normal, pixel.normal) >= settings.normalTolerance
+                            && std::fabs(depth - old.depth) <= settings.depthTolerance * old.depth;
+                    pixel.sum += w * old.sum;
+                    pixel.weight += w * old.weight;
+                    pixel.nextSample = std::max(pixel.nextSample, old.nextSample);
+                }
+                if (!keep) {
+                    pixel.sum = glm::vec3(0.0f);
+                    pixel.weight = 0.0f;
+                    pixel.nextSample = 0;
+                }
+            }
+
+            int count = keep ? settings.refreshSamples : settings.targetSamples;
+            if (pixel.weight > 0.0f && pixel.weight + count > settings.maxHistory) {
+                // Fade the old samples so the new ones keep their share, all the
+                // way out when the new ones alone fill maxHistory
+                float fade = std::max(settings.maxHistory - count, 0) / pixel.weight;
+                pixel.sum *= fade;
+                pixel.weight *= fade;
+            }
+            pixel.sum += renderer.shadeSamples(px, py, pixel.nextSample, count);
+            pixel.weight += count;
+            pixel.nextSample += count;
+            image[(size_t)py * width + px] = pixel.sum / pixel.weight;
+            kept += keep;
+            samples += count;
+        }
+}
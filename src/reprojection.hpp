@@ -0,0 +1,84 @@
+#ifndef REPROJECTION_HPP
+#define REPROJECTION_HPP
+
+#include "glm/glm.hpp"
+#include "aov.hpp"
+#include "camera.hpp"
+#include "renderer.hpp"
+#include "tile_pool.hpp"
+#include <cstdint>
+#include <vector>
+
+struct ReprojectionSettings {
+    int targetSamples = 16;        // samples a pixel starts with when it has no usable history
+    int refreshSamples = 1;        // new samples a frame for pixels that kept their history
+    int maxHistory = 32;           // samples a pixel keeps at most; older ones fade out
+    float normalTolerance = 0.9f;  // smallest cosine between the old and new normal
+    float depthTolerance = 0.03f;  // largest depth difference, relative to the old depth
+};
+
+struct ReprojectionStats {
+    size_t pixels = 0;
+    size_t kept = 0;       // pixels that carried their history over
+    size_t samples = 0;    // shaded samples, not counting the first-hit rays
+};
+
+// Reuses shading across frames when only the camera moves. The lighting is
+// diffuse, so the radiance a sample found at a surface point holds from any
+// view. Every pixel keeps the first hit of its centre ray and the sum of its
+// samples; a new frame traces only the first hits, projects each one into the
+// previous camera and takes over the history of the pixels around where it
+// lands, unless one of them saw another sphere (disocclusion) or a depth or
+// normal too far off. Pixels on an edge between objects, told by the centre hits of their
+// 3x3 neighbourhood, neither take nor give history: their samples cover more
+// than what the centre saw, and moving them would drag it along as ghosts.
+// Kept pixels add refreshSamples, the rest start over with targetSamples, so
+// new samples go almost only where history was rejected. Misses reproject to
+// the same pixel: the background is fixed to the screen.
+class ReprojectionCache {
+    private:
+        struct HistoryPixel {
+            glm::vec3 sum;         // colour of the samples kept
+            float weight;          // samples in sum, fractional once they fade
+            int nextSample;        // index of the pixel's next sample
+            glm::vec3 position;    // first hit of the centre ray
+            glm::vec3 normal;
+            float depth;           // from the camera to position
+            uint32_t objectId;     // 0 on a miss
+            bool edge;             // another object in the 3x3 neighbourhood
+        };
+
+        const Renderer &renderer;
+        const Camera &camera;
+        TilePool &pool;
+        int width, height;
+        ReprojectionSettings settings;
+
+        std::vector<Tile> tiles;
+        std::vector<std::vector<AovSample>> tileHits;     // one per tile, reused by every frame
+        std::vector<uint32_t> objectIds;                  // of the whole frame, for the edge test
+        std::vector<HistoryPixel> current, previous;
+        Camera previousCamera;
+        bool hasHistory = false;
+
+        // First hits of one tile, after which every tile's objectIds are known
+        void traceTile(size_t tileIndex);
+
+        // Fills current and image for one tile; returns pixels kept and samples taken
+        void renderTile(size_t tileIndex, std::vector<glm::vec3> &image, size_t &kept, size_t &samples);
+        bool isEdge(int x, int y) const;
+
+    public:
+        // renderer must be built on camera, which may move between frames
+        ReprojectionCache(const Renderer &renderer, const Camera &camera, TilePool &pool, int tileSize,
+                          const ReprojectionSettings &settings = ReprojectionSettings());
+
+        // Forgets every pixel's history, for when more than the camera changed
+        void reset() { hasHistory = false; }
+
+        // Renders the frame the camera sees now into image, width * height
+        // averaged colours, and keeps it as the history of the next frame
+        void render(std::vector<glm::vec3> &image, ReprojectionStats &stats);
+};
+
+#endif // REPROJECTION_HPP
@@ -0,0 +1,103 @@
+#include "sequence.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+static double secondsSince(std::chrono::steady_clock::time_point start){
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+std::string sequenceFramePath(const std::string &prefix, int frame){
+    char number[16];
+    std::snprintf(number, sizeof(number), "_%04d.ppm", frame);
+    return prefix + number;
+}
+
+SequenceRenderer::SequenceRenderer(const Renderer &renderer, Camera &camera, TilePool &pool, int tileSize)
+    : renderer(renderer), camera(camera), pool(pool), width(renderer.getWidth()), height(renderer.getHeight()),
+      tileSize(tileSize), tiles(makeTiles(width, height, tileSize)), tilePixels(tiles.size()){
+    for (size_t i = 0; i < tiles.size(); i++)
+        tilePixels[i].resize((size_t)tiles[i].width * tiles[i].height);
+    for (int b = 0; b < 2; b++) {
+        frames[b].resize((size_t)width * height);
+        bytes[b].resize((size_t)width * height * 3);
+    }
+}
+
+SequenceRenderer::~SequenceRenderer(){
+    // The writer thread reads the frame buffers
+    if (pendingWrite.valid())
+        pendingWrite.wait();
+}
+
+void SequenceRenderer::setReprojection(const ReprojectionSettings &settings){
+    reprojection = std::make_unique<ReprojectionCache>(renderer, camera, pool, tileSize, settings);
+}
+
+double SequenceRenderer::renderFrame(std::vector<glm::vec3> &frame){
+    if (reprojection) {
+        ReprojectionStats stats;
+        reprojection->render(frame, stats);
+        return (double)stats.kept / stats.pixels;
+    }
+    pool.run(tiles.size(), [&](size_t i){
+        const Tile &tile = tiles[i];
+        glm::vec3 *pixels = tilePixels[i].data();
+        renderer.renderTile(tile, pixels);
+        for (int y = 0; y < tile.height; y++)
+            std::copy_n(pixels + (size_t)y * tile.width, tile.width, &frame[(size_t)(tile.y0 + y) * width + tile.x0]);
+    });
+    return 0.0;
+}
+
+bool SequenceRenderer::writeFrame(const std::string &path, int buffer){
+    auto start = std::chrono::steady_clock::now();
+    tonemapImage(&frames[buffer][0].r, bytes[buffer].data(), width, height, tonemap, 1);
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    bool ok = file != nullptr;
+    if (ok) {
+        std::fprintf(file, "P6\n%d %d\n255\n", width, height);
+        ok = std::fwrite(bytes[buffer].data(), 1, bytes[buffer].size(), file) == bytes[buffer].size();
+        ok = std::fclose(file) == 0 && ok;
+    }
+    writeSeconds += secondsSince(start);
+    return ok;
+}
+
+bool SequenceRenderer::render(const CameraPath &path, int frameCount, const std::string &prefix,
+                              SequenceStats &stats){
+    stats = SequenceStats();
+    writeSeconds = 0.0;
+    auto finishWrite = [&](){
+        bool written = pendingWrite.get();
+        stats.frames += written;
+        return written;
+    };
+    auto start = std::chrono::steady_clock::now();
+    bool ok = true;
+    for (int f = 0; f < frameCount && ok; f++) {
+        float time = path.getStartTime();
+        if (frameCount > 1)
+            time += (path.getEndTime() - path.getStartTime()) * f / (frameCount - 1);
+        path.apply(time, camera);
+
+        // The buffer written two frames ago is free: that write was waited
+        // for before the previous frame went to the writer
+        int buffer = f % 2;
+        auto renderStart = std::chrono::steady_clock::now();
+        stats.kept += renderFrame(frames[buffer]) / frameCount;
+        stats.renderSeconds += secondsSince(renderStart);
+
+        if (pendingWrite.valid() && !finishWrite())
+            break;
+        pendingWrite = std::async(std::launch::async, &SequenceRenderer::writeFrame, this,
+                                  sequenceFramePath(prefix, f), buffer);
+        if (!pipelined)
+            ok = finishWrite();
+    }
+    if (pendingWrite.valid())
+        ok = finishWrite() && ok;
+    stats.seconds = secondsSince(start);
+    stats.writeSeconds = writeSeconds;
+    return ok && stats.frames == frameCount;
+}
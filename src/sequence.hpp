@@ -0,0 +1,74 @@
+#ifndef SEQUENCE_HPP
+#define SEQUENCE_HPP
+
+#include "glm/glm.hpp"
+#include "camera_path.hpp"
+#include "renderer.hpp"
+#include "reprojection.hpp"
+#include "tile_pool.hpp"
+#include "tonemap.hpp"
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Timings of one sequence
+struct SequenceStats {
+    int frames = 0;                // written, so the first frame that failed if any
+    double seconds = 0.0;          // first frame started to last frame on disk
+    double renderSeconds = 0.0;    // tracing only, summed over the frames
+    double writeSeconds = 0.0;     // tone mapping and writing, summed over the frames
+    double kept = 0.0;             // share of pixels that kept their history, with reprojection
+};
+
+// Renders a camera animation to numbered P6 files. Everything that does not
+// depend on the camera is set up once and kept for the whole sequence: the
+// renderer with its scene and BVH, the pool of render threads, the tile list
+// and the frame buffers. Pipelined (the default), a frame is tone mapped and
+// written by a writer thread while the next one is traced; two frame buffers
+// take turns, so tracing never waits unless writing is the slower of the two.
+class SequenceRenderer {
+    private:
+        const Renderer &renderer;
+        Camera &camera;
+        TilePool &pool;
+        int width, height, tileSize;
+        TonemapSettings tonemap;
+        bool pipelined = true;
+
+        std::vector<Tile> tiles;
+        std::vector<std::vector<glm::vec3>> tilePixels;   // one per tile, reused by every frame
+        std::vector<glm::vec3> frames[2];
+        std::vector<unsigned char> bytes[2];
+        std::future<bool> pendingWrite;                    // the frame before, being written
+        double writeSeconds = 0.0;                         // written by the writer thread only
+        std::unique_ptr<ReprojectionCache> reprojection;
+
+        // Returns the share of pixels that kept their history
+        double renderFrame(std::vector<glm::vec3> &frame);
+        bool writeFrame(const std::string &path, int buffer);
+
+    public:
+        // renderer must be built on camera; the camera is moved between frames
+        SequenceRenderer(const Renderer &renderer, Camera &camera, TilePool &pool, int tileSize);
+        ~SequenceRenderer();
+
+        void setTonemap(const TonemapSettings &settings) { tonemap = settings; }
+
+        // Off, every frame is written before the next one is traced
+        void setPipelined(bool on) { pipelined = on; }
+
+        // Frames of settings.targetSamples samples a pixel, through a
+        // ReprojectionCache, instead of one sample at every pixel centre
+        void setReprojection(const ReprojectionSettings &settings);
+
+        // Renders frameCount frames spread evenly over the path, first and last
+        // keyframe included, to prefix_0000.ppm, prefix_0001.ppm ... Stops at
+        // the first file that cannot be written and returns false.
+        bool render(const CameraPath &path, int frameCount, const std::string &prefix, SequenceStats &stats);
+};
+
+// prefix_0042.ppm
+std::string sequenceFramePath(const std::string &prefix, int frame);
+
+#endif // SEQUENCE_HPP
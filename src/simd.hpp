@@ -0,0 +1,107 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+// Small 4-wide float vector for the packet kernels. Uses SSE when the target
+// has it and falls back to plain arrays so the code still builds elsewhere.
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RT_SIMD_SSE 1
+#else
+#define RT_SIMD_SSE 0
+#endif
+
+#include <cmath>
+
+#if RT_SIMD_SSE
+
+struct mask4 {
+    __m128 v;
+
+    mask4() {}
+    mask4(__m128 x) : v(x) {}
+
+    // One bit per lane, lane 0 in bit 0
+    int bits() const { return _mm_movemask_ps(v); }
+};
+
+struct float4 {
+    __m128 v;
+
+    float4() {}
+    float4(__m128 x) : v(x) {}
+    float4(float s) : v(_mm_set1_ps(s)) {}
+
+    static float4 load(const float *p) { return _mm_loadu_ps(p); }
+    void store(float *p) const { _mm_storeu_ps(p, v); }
+};
+
+inline float4 operator+(float4 a, float4 b) { return _mm_add_ps(a.v, b.v); }
+inline float4 operator-(float4 a, float4 b) { return _mm_sub_ps(a.v, b.v); }
+inline float4 operator*(float4 a, float4 b) { return _mm_mul_ps(a.v, b.v); }
+inline float4 operator/(float4 a, float4 b) { return _mm_div_ps(a.v, b.v); }
+inline float4 min(float4 a, float4 b) { return _mm_min_ps(a.v, b.v); }
+inline float4 max(float4 a, float4 b) { return _mm_max_ps(a.v, b.v); }
+inline float4 sqrt(float4 a) { return _mm_sqrt_ps(a.v); }
+
+inline mask4 operator<(float4 a, float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+inline mask4 operator<=(float4 a, float4 b) { return _mm_cmple_ps(a.v, b.v); }
+inline mask4 operator>(float4 a, float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+inline mask4 operator>=(float4 a, float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+inline mask4 operator&(mask4 a, mask4 b) { return _mm_and_ps(a.v, b.v); }
+inline mask4 operator|(mask4 a, mask4 b) { return _mm_or_ps(a.v, b.v); }
+
+// Lane-wise (m ? a : b)
+inline float4 select(mask4 m, float4 a, float4 b) {
+    return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v));
+}
+
+#else
+
+struct mask4 {
+    bool v[4];
+
+    int bits() const { return v[0] | (v[1] << 1) | (v[2] << 2) | (v[3] << 3); }
+};
+
+struct float4 {
+    float v[4];
+
+    float4() {}
+    float4(float s) : v{s, s, s, s} {}
+
+    static float4 load(const float *p) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+    void store(float *p) const { for (int i = 0; i < 4; i++) p[i] = v[i]; }
+};
+
+#define RT_SIMD_LANEWISE(ret, name, expr)                                 \
+    inline ret name(float4 a, float4 b) {                                 \
+        ret r;                                                            \
+        for (int i = 0; i < 4; i++) r.v[i] = (expr);                      \
+        return r;                                                         \
+    }
+RT_SIMD_LANEWISE(float4, operator+, a.v[i] + b.v[i])
+RT_SIMD_LANEWISE(float4, operator-, a.v[i] - b.v[i])
+RT_SIMD_LANEWISE(float4, operator*, a.v[i] * b.v[i])
+RT_SIMD_LANEWISE(float4, operator/, a.v[i] / b.v[i])
+RT_SIMD_LANEWISE(float4, min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+RT_SIMD_LANEWISE(float4, max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+RT_SIMD_LANEWISE(mask4, operator<, a.v[i] < b.v[i])
+RT_SIMD_LANEWISE(mask4, operator<=, a.v[i] <= b.v[i])
+RT_SIMD_LANEWISE(mask4, operator>, a.v[i] > b.v[i])
+RT_SIMD_LANEWISE(mask4, operator>=, a.v[i] >= b.v[i])
+#undef RT_SIMD_LANEWISE
+
+inline float4 sqrt(float4 a) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = std::sqrt(a.v[i]); return r; }
+inline mask4 operator&(mask4 a, mask4 b) { mask4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] && b.v[i]; return r; }
+inline mask4 operator|(mask4 a, mask4 b) { mask4 r; for (int i = 0; i < 4; i++) r.v[i] = a.v[i] || b.v[i]; return r; }
+
+inline float4 select(mask4 m, float4 a, float4 b) {
+    float4 r;
+    for (int i = 0; i < 4; i++) r.v[i] = m.v[i] ? a.v[i] : b.v[i];
+    return r;
+}
+
+#endif
+
+#endif // SIMD_HPP
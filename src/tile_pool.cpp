@@ -0,0 +1,56 @@
+#include "tile_pool.hpp"
+
+TilePool::TilePool(unsigned threadCount){
+    for (unsigned t = 0; t < threadCount; t++)
+        workers.emplace_back(&TilePool::workerLoop, this);
+}
+
+TilePool::~TilePool(){
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread &worker : workers)
+        worker.join();
+}
+
+void TilePool::run(size_t count, const std::function<void(size_t)> &tileWork){
+    if (workers.empty()) {
+        for (size_t i = 0; i < count; i++)
+            tileWork(i);
+        return;
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    work = tileWork;
+    tileCount = count;
+    nextTile.store(0, std::memory_order_relaxed);
+    busyWorkers = (unsigned)workers.size();
+    generation++;
+    lock.unlock();
+    wake.notify_all();
+
+    lock.lock();
+    done.wait(lock, [&](){ return busyWorkers == 0; });
+    work = nullptr;
+}
+
+void TilePool::workerLoop(){
+    uint64_t seen = 0;
+    while (true) {
+        {
+            // The run's work and tile count were set under the mutex before
+            // generation moved on, so they are visible once it has
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&](){ return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+        }
+        for (size_t i = nextTile++; i < tileCount; i = nextTile++)
+            work(i);
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--busyWorkers == 0)
+            done.notify_one();
+    }
+}
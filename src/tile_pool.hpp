@@ -0,0 +1,46 @@
+#ifndef TILE_POOL_HPP
+#define TILE_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Render threads kept alive across frames. forEachTile starts and joins its
+// threads on every call, which is fine for one frame; a sequence hands each
+// frame to the same workers instead, which sleep on a condition variable in
+// between. Tiles are claimed in order from one counter, as in forEachTile.
+class TilePool {
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable wake;   // a new run, or shutdown
+        std::condition_variable done;   // the last worker left the run
+
+        std::function<void(size_t)> work;
+        size_t tileCount = 0;
+        std::atomic<size_t> nextTile{0};
+        unsigned busyWorkers = 0;
+        uint64_t generation = 0;        // runs started so far
+        bool stopping = false;
+
+        void workerLoop();
+
+    public:
+        explicit TilePool(unsigned threadCount);
+        ~TilePool();
+
+        TilePool(const TilePool &) = delete;
+        TilePool &operator=(const TilePool &) = delete;
+
+        unsigned getThreadCount() const { return (unsigned)workers.size(); }
+
+        // Runs work(tileIndex) for every tile on the pool's threads and returns
+        // once all of them are done. Not to be called from two threads at once.
+        void run(size_t tileCount, const std::function<void(size_t)> &work);
+};
+
+#endif // TILE_POOL_HPP
@@ -0,0 +1,44 @@
+#ifndef TONEMAP_HPP
+#define TONEMAP_HPP
+
+#include <cstddef>
+
+// Post-process stage from linear float RGB to 8-bit RGB: exposure, an optional
+// tone curve, a transfer function and quantization with optional ordered
+// dithering. Rows are processed as flat float arrays so the compiler can
+// vectorize them; the kernels are built for AVX-512, AVX2 and baseline x86-64
+// and picked at load time, which gives 16, 8 or 4 channels per instruction.
+
+enum class ToneCurve {
+    None,       // clamp to [0,1]
+    Reinhard,   // x / (1 + x)
+    ACES        // Narkowicz 2015 fit of the ACES filmic curve
+};
+
+enum class OutputTransfer {
+    Linear,     // x * 255 truncated, what the PPM writers have always done
+    Gamma2,     // sqrt(x), the benchmark renderer's gamma
+    SRGB,       // sRGB OETF with a vectorizable pow approximation
+    SRGBExact,  // sRGB OETF with std::pow, scalar; the reference for the others
+    SRGBLut     // sRGB OETF from a 4096-entry table with linear interpolation
+};
+
+struct TonemapSettings {
+    float exposure = 1.0f;
+    ToneCurve curve = ToneCurve::None;
+    OutputTransfer transfer = OutputTransfer::Linear;
+    bool dither = false;   // 8x8 Bayer threshold instead of rounding
+};
+
+// Converts count pixels of one row. x0 and y place the row in the image so the
+// dither pattern lines up across tiles.
+void tonemapRow(const float *rgb, unsigned char *out, size_t count, int x0, int y, const TonemapSettings &settings);
+
+// Converts a width x height image, rows split between threadCount threads
+void tonemapImage(const float *rgb, unsigned char *out, int width, int height,
+                  const TonemapSettings &settings, unsigned threadCount);
+
+// Name of the instruction set the kernels were dispatched to
+const char *tonemapIsa();
+
+#endif // TONEMAP_HPP
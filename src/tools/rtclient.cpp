@@ -0,0 +1,141 @@
+// Client for rtserver: loads a scene, renders it one or more times and writes
+// the last frame as a P6, reporting the latency of every render.
+//
+//   ./tools/rtclient [--socket path] [--size WxH] [--tile n] [--encoding linear|srgb|filmic]
+//                    [--spheres n] [--keep-scene] [--repeat n] [--orbit] [--output file]
+//                    [--shutdown]
+//
+// --spheres 0 (default) is the three spheres of the raytracer binary; more
+// scatters n random spheres. --keep-scene renders whatever the server has
+// loaded. --orbit moves the camera a little before every render.
+
+#include "render_client.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#define FOV 90
+
+static void usage(const char *name){
+    std::cerr << "Usage: " << name << " [--socket path] [--size WxH] [--tile n] [--encoding linear|srgb|filmic]\n"
+              << "       [--spheres n] [--keep-scene] [--repeat n] [--orbit] [--output file] [--shutdown]" << std::endl;
+}
+
+int main(int argc, char **argv){
+    std::string socketPath = RENDER_SOCKET_PATH, outputPath = "client.ppm";
+    RenderRequest request{320, 240, 32, 0};
+    int sphereCount = 0, repeat = 1;
+    bool keepScene = false, orbit = false, shutdownServer = false;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--socket" && hasValue)
+            socketPath = argv[++i];
+        else if (arg == "--size" && hasValue) {
+            if (std::sscanf(argv[++i], "%dx%d", &request.width, &request.height) != 2) {
+                usage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--tile" && hasValue)
+            request.tileSize = std::atoi(argv[++i]);
+        else if (arg == "--encoding" && hasValue) {
+            std::string e = argv[++i];
+            request.encoding = e == "srgb" ? 1 : e == "filmic" ? 2 : 0;
+        } else if (arg == "--spheres" && hasValue)
+            sphereCount = std::atoi(argv[++i]);
+        else if (arg == "--keep-scene")
+            keepScene = true;
+        else if (arg == "--repeat" && hasValue)
+            repeat = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--orbit")
+            orbit = true;
+        else if (arg == "--output" && hasValue)
+            outputPath = argv[++i];
+        else if (arg == "--shutdown")
+            shutdownServer = true;
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    RenderClient client(socketPath);
+    if (!client.isConnected()){
+        std::cerr << client.getError() << std::endl;
+        return 1;
+    }
+    if (shutdownServer){
+        bool ok = client.shutdown();
+        if (!ok)
+            std::cerr << client.getError() << std::endl;
+        return ok ? 0 : 1;
+    }
+
+    if (!keepScene){
+        std::vector<Sphere> spheres;
+        if (sphereCount <= 0){
+            spheres.push_back(Sphere(glm::vec3(0.0f, 0.0f, 3.0f), 1.0f));
+            spheres.push_back(Sphere(glm::vec3(2.0f, 0.0f, 4.0f), 1.0f));
+            spheres.push_back(Sphere(glm::vec3(-2.0f, 0.0f, 4.0f), 1.0f));
+        } else {
+            std::mt19937 rng(1);
+            std::uniform_real_distribution<float> xy(-20.0f, 20.0f), depth(5.0f, 45.0f), radius(0.2f, 0.6f);
+            for (int i = 0; i < sphereCount; i++)
+                spheres.push_back(Sphere(glm::vec3(xy(rng), xy(rng), depth(rng)), radius(rng)));
+        }
+        RenderDone done;
+        if (!client.setScene(spheres, glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)), &done)){
+            std::cerr << client.getError() << std::endl;
+            return 1;
+        }
+        std::cout << "Scene of " << spheres.size() << " spheres loaded in " << done.serverSeconds * 1e3 << " ms" << std::endl;
+    }
+
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    std::vector<unsigned char> rgb;
+    std::vector<double> latencies;
+    double serverSeconds = 0.0;
+    for (int r = 0; r < repeat; r++) {
+        auto start = std::chrono::steady_clock::now();
+        if (orbit || r == 0){
+            glm::vec3 position = orbit ? glm::vec3(0.2f * std::sin(0.1f * r), 0.0f, 0.0f) : glm::vec3(0.0f);
+            CameraState camera = makeCameraState(position, axis, FOV, (float)request.width / request.height);
+            if (!client.setCamera(camera)){
+                std::cerr << client.getError() << std::endl;
+                return 1;
+            }
+        }
+        RenderDone done;
+        if (!client.render(request, rgb, &done)){
+            std::cerr << client.getError() << std::endl;
+            return 1;
+        }
+        latencies.push_back(std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+        serverSeconds += done.serverSeconds;
+    }
+
+    std::FILE *f = std::fopen(outputPath.c_str(), "wb");
+    if (!f || std::fprintf(f, "P6\n%d %d\n255\n", request.width, request.height) < 0
+        || std::fwrite(rgb.data(), 1, rgb.size(), f) != rgb.size()){
+        std::cerr << "Failed to write " << outputPath << std::endl;
+        if (f)
+            std::fclose(f);
+        return 1;
+    }
+    std::fclose(f);
+
+    std::vector<double> sorted = latencies;
+    std::sort(sorted.begin(), sorted.end());
+    std::printf("%d renders of %dx%d: first %.3f ms, median %.3f ms, min %.3f ms, max %.3f ms, server %.3f ms mean\n",
+                repeat, request.width, request.height, latencies[0] * 1e3, sorted[sorted.size() / 2] * 1e3,
+                sorted.front() * 1e3, sorted.back() * 1e3, serverSeconds / repeat * 1e3);
+    std::cout << "Wrote " << outputPath << std::endl;
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Coordinator of a distributed render: splits a frame of the raytracer scene
+// into tile and sample-range jobs for rtserver workers started with --tcp,
+// and writes the averaged frame as a P6 and a PFM.
+//
+//   ./tools/rtcoord host:port [host:port ...] [--size WxH] [--spp n] [--split n]
+//                   [--tile n] [--encoding linear|srgb|filmic] [--output name]
+//
+// --split is the samples per job; the frame is bit-identical for a given split
+// however many workers there are and whichever of them survive.
+
+#include "coordinator.hpp"
+#include "hdr_image.hpp"
+#include "tonemap.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#define FOV 90
+
+int main(int argc, char **argv){
+    std::vector<std::string> addresses;
+    FrameSettings settings;
+    TonemapSettings tonemap;
+    std::string output = "distributed";
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--size" && hasValue)
+            valid = std::sscanf(argv[++i], "%dx%d", &settings.width, &settings.height) == 2;
+        else if (arg == "--spp" && hasValue)
+            settings.samplesPerPixel = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--split" && hasValue)
+            settings.samplesPerJob = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--tile" && hasValue)
+            settings.tileSize = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--encoding" && hasValue) {
+            std::string e = argv[++i];
+            if (e != "linear")
+                tonemap.transfer = OutputTransfer::SRGB;
+            if (e == "filmic") {
+                tonemap.curve = ToneCurve::ACES;
+                tonemap.dither = true;
+            }
+        } else if (arg == "--output" && hasValue)
+            output = argv[++i];
+        else if (arg.compare(0, 2, "--") != 0)
+            addresses.push_back(arg);
+        else
+            valid = false;
+    }
+    if (!valid || addresses.empty()){
+        std::cerr << "Usage: " << argv[0] << " host:port [host:port ...] [--size WxH] [--spp n] [--split n]\n"
+                  << "       [--tile n] [--encoding linear|srgb|filmic] [--output name]" << std::endl;
+        return 1;
+    }
+
+    Coordinator coordinator(addresses);
+    if (coordinator.getLiveWorkers() == 0){
+        std::cerr << coordinator.getError() << std::endl;
+        return 1;
+    }
+
+    std::vector<Sphere> spheres;
+    spheres.push_back(Sphere(glm::vec3(0.0f, 0.0f, 3.0f), 1.0f));
+    spheres.push_back(Sphere(glm::vec3(2.0f, 0.0f, 4.0f), 1.0f));
+    spheres.push_back(Sphere(glm::vec3(-2.0f, 0.0f, 4.0f), 1.0f));
+    camAxis axis(glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+    CameraState camera = makeCameraState(glm::vec3(0.0f), axis, FOV, (float)settings.width / settings.height);
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<glm::vec3> image;
+    if (!coordinator.render(spheres, glm::normalize(glm::vec3(1.0f, 1.0f, 1.0f)), camera, settings, image)){
+        std::cerr << coordinator.getError() << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<unsigned char> bytes(image.size() * 3);
+    tonemapImage(&image[0].r, bytes.data(), settings.width, settings.height, tonemap, 1);
+    std::string ppm = output + ".ppm", pfm = output + ".pfm";
+    std::FILE *f = std::fopen(ppm.c_str(), "wb");
+    bool ok = f && std::fprintf(f, "P6\n%d %d\n255\n", settings.width, settings.height) > 0
+              && std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size();
+    ok = (f && std::fclose(f) == 0) && ok;
+    ok = writePFM(pfm, settings.width, settings.height, image) && ok;
+    if (!ok){
+        std::cerr << "Failed to write " << ppm << " or " << pfm << std::endl;
+        return 1;
+    }
+
+    std::printf("%dx%d at %d spp in %.3f s, %d jobs given out twice\n", settings.width, settings.height,
+                settings.samplesPerPixel, seconds, coordinator.getReissuedJobs());
+    for (const WorkerStats &w : coordinator.getWorkerStats())
+        std::printf("  %-22s %-5s %5d jobs used, %3d wasted, %3d lost, %.3f s busy\n", w.address.c_str(),
+                    w.alive ? "up" : "gone", w.jobsDone, w.jobsWasted, w.jobsLost, w.busySeconds);
+    std::cout << "Wrote " << ppm << " and " << pfm << std::endl;
+    return 0;
+}
@@ -0,0 +1,55 @@
+// Render daemon: keeps a scene warm behind a Unix domain socket, or a TCP port
+// as a worker for rtcoord, until a client sends Shutdown or the process gets
+// SIGINT/SIGTERM.
+//
+//   make && ./tools/rtserver [socketPath | --tcp port] [threads]
+
+#include "render_server.hpp"
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+static RenderServer *activeServer = nullptr;
+
+static void onSignal(int){
+    if (activeServer)
+        activeServer->stop();
+}
+
+int main(int argc, char **argv){
+    int arg = 1;
+    std::string socketPath = RENDER_SOCKET_PATH;
+    int port = -1;
+    if (arg + 1 < argc && std::string(argv[arg]) == "--tcp"){
+        port = std::atoi(argv[arg + 1]);
+        arg += 2;
+    } else if (arg < argc){
+        socketPath = argv[arg++];
+    }
+    unsigned threadCount = arg < argc ? (unsigned)std::atoi(argv[arg]) : std::thread::hardware_concurrency();
+    threadCount = std::max(1u, threadCount);
+
+    std::unique_ptr<RenderServer> owned = port >= 0 ? std::make_unique<RenderServer>(listenTcp(port), threadCount)
+                                                    : std::make_unique<RenderServer>(socketPath, threadCount);
+    RenderServer &server = *owned;
+    std::string where = port >= 0 ? "TCP port " + std::to_string(port) : socketPath;
+    if (!server.isOpen()){
+        std::cerr << "Cannot listen on " << where << std::endl;
+        return 1;
+    }
+    activeServer = &server;
+    // No SA_RESTART, so a signal interrupts accept()
+    struct sigaction action{};
+    action.sa_handler = onSignal;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    std::cout << "Listening on " << where << " with " << threadCount << " render threads" << std::endl;
+    server.serve();
+    activeServer = nullptr;
+    std::cout << "Served " << server.getRendersServed() << " renders" << std::endl;
+    return 0;
+}
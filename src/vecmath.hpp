@@ -0,0 +1,32 @@
+#ifndef VECMATH_HPP
+#define VECMATH_HPP
+
+#include "glm/glm.hpp"
+
+// Vector type of the ray, sphere and camera math.
+//
+// GLM's SSE/NEON code (glm/simd, type_vec4_simd.inl, func_geometric_simd.inl)
+// is only written for aligned vec4, so glm::vec3 always takes the scalar path.
+// `make GLM_SIMD=1` defines GLM_FORCE_INTRINSICS for every file and rtVec3
+// becomes an aligned glm::vec4 with w = 0: arithmetic, dot and length are then
+// one SSE operation each. The default build keeps glm::vec3.
+#ifdef GLM_FORCE_INTRINSICS
+#include "glm/gtc/type_aligned.hpp"
+
+using rtVec3 = glm::aligned_vec4;
+
+inline rtVec3 toRtVec3(const glm::vec3 &v){ return rtVec3(v, 0.0f); }
+inline glm::vec3 toVec3(const rtVec3 &v){ return glm::vec3(v); }
+
+// GLM's SSE normalize multiplies by the 12-bit rsqrt estimate; the traversal
+// kernels take ray directions to be unit length, so divide by the exact length
+inline rtVec3 rtNormalize(const rtVec3 &v){ return v * (1.0f / glm::length(v)); }
+#else
+using rtVec3 = glm::vec3;
+
+inline const rtVec3 &toRtVec3(const glm::vec3 &v){ return v; }
+inline const glm::vec3 &toVec3(const rtVec3 &v){ return v; }
+inline rtVec3 rtNormalize(const rtVec3 &v){ return glm::normalize(v); }
+#endif
+
+#endif // VECMATH_HPP